@@ -344,6 +344,29 @@ int Connection::Start(const std::string &name) {
     return Impl->Rpc();
 }
 
+int Connection::StartRecursive(const std::string &name,
+                               const std::map<std::string, std::vector<std::string>> &after,
+                               std::vector<StartResult> &results) {
+    auto start = Impl->Req.mutable_start();
+
+    start->set_name(name);
+    start->set_recursive(true);
+    for (auto &it: after) {
+        auto dep = start->add_dependency();
+        dep->set_name(it.first);
+        for (auto &sibling: it.second)
+            dep->add_after(sibling);
+    }
+
+    int ret = Impl->Rpc();
+
+    results.clear();
+    for (auto &result: Impl->Rsp.start().result())
+        results.push_back({ result.name(), result.error(), result.errormsg() });
+
+    return ret;
+}
+
 int Connection::Stop(const std::string &name, int timeout) {
     auto stop = Impl->Req.mutable_stop();
 
@@ -361,6 +384,45 @@ int Connection::Kill(const std::string &name, int sig) {
     return Impl->Rpc();
 }
 
+int Connection::Exec(const std::string &name, const std::string &command,
+                     const std::map<std::string, std::string> &config,
+                     bool wait, int &pid, int &status) {
+    auto exec = Impl->Req.mutable_exec();
+    int ret;
+
+    exec->set_name(name);
+    exec->set_command(command);
+    for (auto &it: config) {
+        if (it.first == "env")
+            exec->set_env(it.second);
+        else if (it.first == "cwd")
+            exec->set_cwd(it.second);
+        else if (it.first == "stdin_path")
+            exec->set_stdin_path(it.second);
+        else if (it.first == "stdout_path")
+            exec->set_stdout_path(it.second);
+        else if (it.first == "stderr_path")
+            exec->set_stderr_path(it.second);
+    }
+    exec->set_wait(wait);
+
+    if (Impl->Fd < 0 && Connect())
+        return Impl->LastError;
+
+    /* command could run longer than request timeout */
+    if (wait && Impl->SetTimeout(2, 0))
+        return Impl->LastError;
+
+    ret = Impl->Rpc();
+
+    if (wait && Impl->Fd >= 0)
+        Impl->SetTimeout(2, Impl->Timeout);
+
+    pid = Impl->Rsp.exec().pid();
+    status = Impl->Rsp.exec().exit_status();
+    return ret;
+}
+
 int Connection::Pause(const std::string &name) {
     Impl->Req.mutable_pause()->set_name(name);
 
@@ -375,12 +437,22 @@ int Connection::Resume(const std::string &name) {
 
 int Connection::WaitContainers(const std::vector<std::string> &containers,
                                std::string &name, int timeout) {
+    std::string event;
+    return WaitContainers(containers, {}, name, event, timeout);
+}
+
+int Connection::WaitContainers(const std::vector<std::string> &containers,
+                               const std::vector<std::string> &events,
+                               std::string &name, std::string &event, int timeout) {
     auto wait = Impl->Req.mutable_wait();
     int ret, recv_timeout = 0;
 
     for (const auto &c : containers)
         wait->add_name(c);
 
+    for (const auto &e : events)
+        wait->add_events(e);
+
     if (timeout >= 0) {
         wait->set_timeout(timeout * 1000);
         recv_timeout = timeout + (Impl->Timeout ?: timeout);
@@ -398,6 +470,46 @@ int Connection::WaitContainers(const std::vector<std::string> &containers,
         Impl->SetTimeout(2, Impl->Timeout);
 
     name.assign(Impl->Rsp.wait().name());
+    event.assign(Impl->Rsp.wait().event());
+    return ret;
+}
+
+int Connection::ReadStream(const std::string &name, const std::string &stream,
+                           uint64_t &offset, uint64_t limit, int timeout,
+                           std::string &data, bool &eof) {
+    auto read = Impl->Req.mutable_readstream();
+    int ret, recv_timeout = 0;
+
+    read->set_name(name);
+    read->set_stream(stream);
+    read->set_offset(offset);
+    if (limit)
+        read->set_limit(limit);
+    read->set_follow(timeout != 0);
+
+    if (timeout > 0) {
+        read->set_timeout(timeout * 1000);
+        recv_timeout = timeout + (Impl->Timeout ?: timeout);
+    }
+
+    if (Impl->Fd < 0 && Connect())
+        return Impl->LastError;
+
+    if (timeout && Impl->SetTimeout(2, recv_timeout))
+        return Impl->LastError;
+
+    ret = Impl->Rpc();
+
+    if (timeout && Impl->Fd >= 0)
+        Impl->SetTimeout(2, Impl->Timeout);
+
+    data.clear();
+    eof = false;
+    if (!ret) {
+        data = Impl->Rsp.readstream().data();
+        offset = Impl->Rsp.readstream().offset() + data.size();
+        eof = Impl->Rsp.readstream().eof();
+    }
     return ret;
 }
 
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 namespace Porto {
 
@@ -24,6 +25,12 @@ struct GetResponse {
     std::string ErrorMsg;
 };
 
+struct StartResult {
+    std::string Name;
+    int Error;
+    std::string ErrorMsg;
+};
+
 class Connection {
     class ConnectionImpl;
 
@@ -48,13 +55,41 @@ public:
     int Destroy(const std::string &name);
 
     int Start(const std::string &name);
+    /* after: container -> siblings which must be started before it */
+    int StartRecursive(const std::string &name,
+                       const std::map<std::string, std::vector<std::string>> &after,
+                       std::vector<StartResult> &results);
     int Stop(const std::string &name, int timeout = -1);
     int Kill(const std::string &name, int sig);
+    /*
+     * Runs command in running container without creating new one.
+     * config: env, cwd, stdin_path, stdout_path, stderr_path.
+     * With wait returns after exit with its wait status.
+     */
+    int Exec(const std::string &name, const std::string &command,
+             const std::map<std::string, std::string> &config,
+             bool wait, int &pid, int &status);
     int Pause(const std::string &name);
     int Resume(const std::string &name);
 
     int WaitContainers(const std::vector<std::string> &containers,
                        std::string &name, int timeout);
+    /*
+     * Also wakes at events: memory_pressure, memory_threshold, exec,
+     * stdout, stderr. Event is empty if container changed state.
+     */
+    int WaitContainers(const std::vector<std::string> &containers,
+                       const std::vector<std::string> &events,
+                       std::string &name, std::string &event, int timeout);
+
+    /*
+     * Reads stdout or stderr from offset and moves offset after data.
+     * With timeout waits for new data: -1 forever, 0 - don't wait.
+     * Eof is set when container is dead and everything is read.
+     */
+    int ReadStream(const std::string &name, const std::string &stream,
+                   uint64_t &offset, uint64_t limit, int timeout,
+                   std::string &data, bool &eof);
 
     int List(std::vector<std::string> &clist);
     int Plist(std::vector<Property> &list);
@@ -288,9 +288,10 @@ class _RPC(object):
         request.dataList.CopyFrom(rpc_pb2.TContainerDataListRequest())
         return [item.name for item in self.call(request, self.timeout).dataList.list]
 
-    def Wait(self, containers, timeout=None):
+    def Wait(self, containers, timeout=None, events=[]):
         request = rpc_pb2.TContainerRequest()
         request.wait.name.extend(containers)
+        request.wait.events.extend(events)
         if timeout is not None and timeout >= 0:
             request.wait.timeout = timeout
 
@@ -561,8 +562,8 @@ class Connection(object):
     def Vlist(self):
         return [prop.name for prop in self.rpc.ListVolumeProperties()]
 
-    def Wait(self, containers, timeout=None):
-        return self.rpc.Wait(containers, timeout)
+    def Wait(self, containers, timeout=None, events=[]):
+        return self.rpc.Wait(containers, timeout, events)
 
     def CreateVolume(self, path=None, layers=[], **properties):
         if layers:
@@ -1,18 +1,24 @@
 #include <algorithm>
 #include <cmath>
 #include <csignal>
+#include <cstring>
 
 #include "cgroup.hpp"
+#include "reaper.hpp"
 #include "device.hpp"
 #include "config.hpp"
 #include "util/log.hpp"
 #include "util/string.hpp"
 #include "util/unix.hpp"
+#include "statistics.hpp"
 
 extern "C" {
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <limits.h>
 }
 
 TPath TCgroup::Path() const {
@@ -43,15 +49,21 @@ TError TCgroup::Create() const {
     if (Secondary())
         return TError(EError::Unknown, "Cannot create secondary cgroup " + Type());
 
+    error = CancelRemove();
+    if (error)
+        return error;
+
     L_ACT() << "Create cgroup " << *this << std::endl;
     error = Path().Mkdir(0755);
+    if (!error)
+        error = Subsystem->InitializeCgroup(*this);
     if (error)
         L_ERR() << "Cannot create cgroup " << *this << " : " << error << std::endl;
 
     return error;
 }
 
-TError TCgroup::Remove() const {
+TError TCgroup::Remove(bool defer) const {
     struct stat st;
     TError error;
 
@@ -61,9 +73,16 @@ TError TCgroup::Remove() const {
     L_ACT() << "Remove cgroup " << *this << std::endl;
     error = Path().Rmdir();
 
+    /* nested cgroups waiting in reaper keep this one busy too */
+    if (error && error.GetErrno() == EBUSY && defer &&
+            CgroupReaper.HasPendingChilds(*this) && CgroupReaper.Defer(*this))
+        return TError::Success();
+
     /* workaround for bad synchronization */
     if (error && error.GetErrno() == EBUSY &&
             !Path().StatStrict(st) && st.st_nlink == 2) {
+        if (defer && CgroupReaper.Defer(*this))
+            return TError::Success();
         uint64_t deadline = GetCurrentTimeMs() + config().daemon().cgroup_remove_timeout_s() * 1000;
         do {
             error = Path().Rmdir();
@@ -78,6 +97,26 @@ TError TCgroup::Remove() const {
     return error;
 }
 
+/* Previous incarnation might still wait for removal in reaper */
+TError TCgroup::CancelRemove() const {
+    std::vector<TCgroup> childs;
+    TError error;
+
+    if (!CgroupReaper.Cancel(*this))
+        return TError::Success();
+
+    /* leftovers are empty, remove them now, nested first */
+    error = ChildsAll(childs);
+    for (auto it = childs.rbegin(); !error && it != childs.rend(); it++)
+        error = it->Remove(false);
+    if (!error)
+        error = Remove(false);
+    if (error && error.GetErrno() == ENOENT)
+        error = TError::Success();
+
+    return error;
+}
+
 bool TCgroup::Has(const std::string &knob) const {
     if (!Subsystem)
         return false;
@@ -141,6 +180,156 @@ TError TCgroup::GetUintMap(const std::string &knob, TUintMap &value) const {
     return TError::Success();
 }
 
+void TCgroupKnobs::Close() {
+    for (auto &knob: Fds)
+        close(knob.Fd);
+    Fds.clear();
+}
+
+TError TCgroupKnobs::Read(const TCgroup &cg, const std::string &knob,
+                          const char *&data, size_t &len) {
+    if (!cg.Subsystem)
+        return TError(EError::Unknown, "Cannot get from null cgroup");
+
+    auto it = Fds.begin();
+    while (it != Fds.end() && (it->Subsystem != cg.Subsystem ||
+                               it->Knob != knob || it->Cgroup != cg.Name))
+        it++;
+
+    if (it != Fds.end() && Memoize && it->Generation == Generation) {
+        Statistics->CgroupReadsMemoized++;
+        data = Buffer.data() + it->Offset;
+        len = it->Length;
+        return TError::Success();
+    }
+
+    if (it == Fds.end()) {
+        int fd = open(cg.Knob(knob).c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+        if (fd < 0)
+            return TError(EError::Unknown, errno, "Cannot open knob " + knob);
+        it = Fds.insert(Fds.end(), { cg.Subsystem, cg.Name, knob, fd, 0, 0, 0 });
+    }
+
+    size_t offset = Memoize ? BufferUsed : 0;
+
+    if (Buffer.size() < offset + 4096)
+        Buffer.resize(offset + 4096);
+
+    while (1) {
+        Statistics->CgroupReads++;
+        ssize_t ret = pread(it->Fd, Buffer.data() + offset, Buffer.size() - offset, 0);
+        if (ret < 0) {
+            TError error(EError::Unknown, errno, "Cannot read knob " + knob);
+            close(it->Fd);
+            Fds.erase(it);
+            return error;
+        }
+        len = ret;
+        if (offset + len < Buffer.size())
+            break;
+        Buffer.resize(Buffer.size() * 2);
+    }
+
+    data = Buffer.data() + offset;
+
+    if (Memoize) {
+        it->Generation = Generation;
+        it->Offset = offset;
+        it->Length = len;
+        BufferUsed = offset + len;
+    }
+
+    return TError::Success();
+}
+
+TError TCgroupKnobs::GetUint64(const TCgroup &cg, const std::string &knob, uint64_t &value) {
+    const char *ptr;
+    size_t len;
+    TError error = Read(cg, knob, ptr, len);
+    if (error)
+        return error;
+
+    const char *end = ptr + len;
+    if (ptr == end || *ptr < '0' || *ptr > '9')
+        return TError(EError::Unknown, "Bad integer value in knob " + knob);
+
+    for (value = 0; ptr < end && *ptr >= '0' && *ptr <= '9'; ptr++)
+        value = value * 10 + (*ptr - '0');
+
+    return TError::Success();
+}
+
+TError TCgroupKnobs::GetFields(const TCgroup &cg, const std::string &knob,
+                               TUintField *fields, size_t count) {
+    const char *data;
+    size_t len;
+    TError error = Read(cg, knob, data, len);
+    if (!error)
+        ParseFields(data, len, fields, count);
+    return error;
+}
+
+TError TCgroupKnobs::GetBlkio(const TCgroup &cg, const std::string &knob,
+                              std::vector<BlkioStat> &stat) {
+    if (Memoize && BlkioGeneration == Generation && BlkioKnob == knob) {
+        stat = Blkio;
+        return TError::Success();
+    }
+
+    const char *data;
+    size_t len;
+    TError error = Read(cg, knob, data, len);
+    if (error)
+        return error;
+
+    std::vector<std::string> lines;
+    error = SplitString(std::string(data, len), '\n', lines);
+    if (!error)
+        error = BlkioSubsystem.ParseStatistics(lines, stat);
+    if (error)
+        return error;
+
+    if (Memoize) {
+        Blkio = stat;
+        BlkioKnob = knob;
+        BlkioGeneration = Generation;
+    }
+
+    return TError::Success();
+}
+
+/* Missing keys are reported as zero */
+void TCgroupKnobs::ParseFields(const char *data, size_t len,
+                               TUintField *fields, size_t count) {
+    const char *ptr = data, *end = data + len;
+
+    for (size_t i = 0; i < count; i++)
+        fields[i].Value = 0;
+
+    while (ptr < end) {
+        const char *key = ptr;
+        while (ptr < end && *ptr != ' ' && *ptr != '\n')
+            ptr++;
+        size_t keyLen = ptr - key;
+
+        while (ptr < end && *ptr == ' ')
+            ptr++;
+
+        uint64_t val = 0;
+        while (ptr < end && *ptr >= '0' && *ptr <= '9')
+            val = val * 10 + (*ptr++ - '0');
+
+        while (ptr < end && *ptr++ != '\n');
+
+        for (size_t i = 0; i < count; i++) {
+            if (!strncmp(fields[i].Key, key, keyLen) && !fields[i].Key[keyLen]) {
+                fields[i].Value = val;
+                break;
+            }
+        }
+    }
+}
+
 TError TCgroup::Attach(pid_t pid) const {
     if (Secondary())
         return TError(EError::Unknown, "Cannot attach to secondary cgroup " + Type());
@@ -241,6 +430,44 @@ TError TCgroup::KillAll(int signal) const {
     return error;
 }
 
+/*
+ * Kill tasks of this cgroup and given nested cgroups. Tasks cannot fork
+ * while frozen thus single pass kills everybody.
+ */
+TError TCgroup::KillFrozen(int signal, const std::vector<TCgroup> &subtree) const {
+    TError error;
+    bool frozen = true;
+    error = FreezerSubsystem.Freeze(*this);
+    if (error) {
+        L_WRN() << "Cannot freeze " << *this << " : " << error << std::endl;
+        frozen = false;
+    }
+
+    error = KillAll(signal);
+    for (auto &cg: subtree) {
+        TError error2 = cg.KillAll(signal);
+        if (!error)
+            error = error2;
+    }
+
+    TError error2 = FreezerSubsystem.Thaw(*this, false);
+    if (!error && frozen)
+        error = error2;
+
+    return error;
+}
+
+TError TCgroup::WaitEmpty(uint64_t deadline) const {
+    for (uint64_t wait = 1; !IsEmpty(); wait = std::min(wait * 2, (uint64_t)100))
+        if (WaitDeadline(deadline, wait))
+            return TError(EError::Busy, "Cgroup " + Name + " still populated");
+
+    return TError::Success();
+}
+
+TError TSubsystem::InitializeCgroup(const TCgroup &cg) const {
+    return TError::Success();
+}
 
 TCgroup TSubsystem::RootCgroup() const {
     return TCgroup(this, "/");
@@ -353,6 +580,23 @@ TError TMemorySubsystem::GetAnonUsage(TCgroup &cg, uint64_t &usage) const {
     return error;
 }
 
+TError TMemorySubsystem::GetAnonUsage(TCgroupKnobs &knobs, TCgroup &cg,
+                                      uint64_t &usage) const {
+    if (!knobs.GetUint64(cg, ANON_USAGE, usage))
+        return TError::Success();
+
+    TUintField stat[] = {
+        { "total_inactive_anon" },
+        { "total_active_anon" },
+        { "unevictable" },
+        { "total_swap" },
+    };
+    TError error = knobs.GetFields(cg, STAT, stat);
+    if (!error)
+        usage = stat[0].Value + stat[1].Value + stat[2].Value + stat[3].Value;
+    return error;
+}
+
 bool TMemorySubsystem::SupportAnonLimit() const {
     return Cgroup(PORTO_DAEMON_CGROUP).Has(ANON_LIMIT);
 }
@@ -402,46 +646,106 @@ TError TMemorySubsystem::SetupOOMEvent(TCgroup &cg, TFile &event) {
     return error;
 }
 
+/* Levels are "medium" and "critical" */
+TError TMemorySubsystem::SetupPressureEvent(TCgroup &cg, TFile &event,
+                                            const std::string &level) {
+    TError error;
+
+    event.Close();
+
+    if (!cg.Has(PRESSURE_LEVEL))
+        return TError(EError::NotSupported, "Memory pressure notifications not supported");
+
+    TFile knob;
+    error = knob.OpenRead(cg.Knob(PRESSURE_LEVEL));
+    if (error)
+        return error;
+
+    event.SetFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event.Fd < 0)
+        return TError(EError::Unknown, errno, "Cannot create eventfd");
+
+    error = cg.Set(EVENT_CONTROL, std::to_string(event.Fd) + " " +
+                   std::to_string(knob.Fd) + " " + level);
+    if (error)
+        event.Close();
+    return error;
+}
+
+/*
+ * One eventfd registered for each threshold of usage_in_bytes, kernel
+ * signals crossing in both directions.
+ */
+TError TMemorySubsystem::SetupThresholdEvent(TCgroup &cg, TFile &event,
+                                             const std::vector<uint64_t> &thresholds) {
+    TError error;
+
+    event.Close();
+
+    TFile knob;
+    error = knob.OpenRead(cg.Knob(USAGE));
+    if (error)
+        return error;
+
+    event.SetFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event.Fd < 0)
+        return TError(EError::Unknown, errno, "Cannot create eventfd");
+
+    for (auto threshold: thresholds) {
+        error = cg.Set(EVENT_CONTROL, std::to_string(event.Fd) + " " +
+                       std::to_string(knob.Fd) + " " + std::to_string(threshold));
+        if (error) {
+            event.Close();
+            break;
+        }
+    }
+
+    return error;
+}
+
 // Freezer
-TError TFreezerSubsystem::WaitState(TCgroup &cg, const std::string &state) const {
+TError TFreezerSubsystem::WaitState(const TCgroup &cg, const std::string &state) const {
     uint64_t deadline = GetCurrentTimeMs() + config().daemon().freezer_wait_timeout_s() * 1000;
     std::string cur;
     TError error;
 
-    do {
+    /* freezer has no notification, usually state changes immediately */
+    for (uint64_t wait = 1; ; wait = std::min(wait * 2, (uint64_t)100)) {
         error = cg.Get("freezer.state", cur);
         if (error || StringTrim(cur) == state)
             return error;
-    } while (!WaitDeadline(deadline));
+        if (WaitDeadline(deadline, wait))
+            break;
+    }
 
     return TError(EError::Unknown, "Freezer " + cg.Name + " timeout waiting " + state);
 }
 
-TError TFreezerSubsystem::Freeze(TCgroup &cg) const {
+TError TFreezerSubsystem::Freeze(const TCgroup &cg, bool wait) const {
     TError error = cg.Set("freezer.state", "FROZEN");
-    if (error)
+    if (error || !wait)
         return error;
     return WaitState(cg, "FROZEN");
 }
 
-TError TFreezerSubsystem::Thaw(TCgroup &cg, bool wait) const {
+TError TFreezerSubsystem::Thaw(const TCgroup &cg, bool wait) const {
     TError error = cg.Set("freezer.state", "THAWED");
     if (error || !wait)
         return error;
     return WaitState(cg, "THAWED");
 }
 
-bool TFreezerSubsystem::IsFrozen(TCgroup &cg) const {
+bool TFreezerSubsystem::IsFrozen(const TCgroup &cg) const {
     std::string state;
     return !cg.Get("freezer.state", state) && StringTrim(state) != "THAWED";
 }
 
-bool TFreezerSubsystem::IsSelfFreezing(TCgroup &cg) const {
+bool TFreezerSubsystem::IsSelfFreezing(const TCgroup &cg) const {
     bool val;
     return !cg.GetBool("freezer.self_freezing", val) && val;
 }
 
-bool TFreezerSubsystem::IsParentFreezing(TCgroup &cg) const {
+bool TFreezerSubsystem::IsParentFreezing(const TCgroup &cg) const {
     bool val;
     return !cg.GetBool("freezer.parent_freezing", val) && val;
 }
@@ -543,6 +847,165 @@ TError TCpuSubsystem::SetCpuPolicy(TCgroup &cg, const std::string &policy,
     return TError::Success();
 }
 
+// Cpuset
+void TCpusetSubsystem::InitializeSubsystem() {
+    TPath nodes("/sys/devices/system/node");
+    std::string text;
+    TBitMap online;
+
+    if (!nodes.Exists() || (nodes / "online").ReadAll(text) ||
+            StringToBitMap(text, online))
+        online = { true };
+
+    for (size_t node = 0; node < online.size(); node++) {
+        TBitMap cpus;
+
+        if (!online[node])
+            continue;
+
+        NodeCpus.resize(node + 1);
+        text = "";
+        if ((nodes / ("node" + std::to_string(node)) / "cpulist").ReadAll(text) ||
+                StringToBitMap(text, cpus)) {
+            /* no numa: one node with all cpus */
+            cpus.assign(GetNumCores(), true);
+        }
+        NodeCpus[node] = cpus;
+
+        L_SYS() << "NUMA node " << node << " cpus " << BitMapToString(cpus) << std::endl;
+    }
+
+    NodeGuarantee.assign(NodeCpus.size(), 0);
+
+    /* new cgroups start with parent's cpus and mems, otherwise they are empty */
+    TError error = RootCgroup().Set(CLONE_CHILDREN, "1");
+    if (error)
+        L_ERR() << "Cannot enable cpuset " << CLONE_CHILDREN << ": " << error << std::endl;
+}
+
+/* tasks cannot be attached while cpus or mems are empty */
+TError TCpusetSubsystem::InitializeCgroup(const TCgroup &cg) const {
+    TCgroup parent(this, TPath(cg.Name).DirName().ToString());
+    std::string cpus, mems;
+    TError error;
+
+    error = cg.Get(CPUS, cpus);
+    if (!error)
+        error = cg.Get(MEMS, mems);
+    if (error || (StringTrim(cpus) != "" && StringTrim(mems) != ""))
+        return error;
+
+    error = parent.Get(CPUS, cpus);
+    if (!error)
+        error = parent.Get(MEMS, mems);
+    if (!error)
+        error = cg.Set(CPUS, StringTrim(cpus));
+    if (!error)
+        error = cg.Set(MEMS, StringTrim(mems));
+    return error;
+}
+
+TError TCpusetSubsystem::GetCpus(const TCgroup &cg, TBitMap &cpus) const {
+    std::string text;
+    TError error = cg.Get(CPUS, text);
+    if (!error)
+        error = StringToBitMap(text, cpus);
+    return error;
+}
+
+TError TCpusetSubsystem::SetCpus(const TCgroup &cg, const TBitMap &cpus,
+                                 const std::string &mems) const {
+    TError error;
+
+    if (cg.Has(MEMORY_MIGRATE)) {
+        error = cg.Set(MEMORY_MIGRATE, "1");
+        if (error)
+            return error;
+    }
+
+    /* cpus cannot be empty, also kernel rejects cpus beyond parent */
+    error = cg.Set(CPUS, BitMapToString(cpus));
+    if (error)
+        return error;
+
+    return cg.Set(MEMS, mems);
+}
+
+int TCpusetSubsystem::FindNode(const TBitMap &cpus) const {
+    for (size_t node = 0; node < NodeCpus.size(); node++) {
+        TBitMap a = NodeCpus[node], b = cpus;
+        size_t size = std::max(a.size(), b.size());
+
+        a.resize(size, false);
+        b.resize(size, false);
+        if (a == b)
+            return node;
+    }
+    return -1;
+}
+
+std::string TCpusetSubsystem::NodesOf(const TBitMap &cpus) const {
+    TBitMap mems;
+
+    for (size_t node = 0; node < NodeCpus.size(); node++) {
+        for (size_t cpu = 0; cpu < NodeCpus[node].size() && cpu < cpus.size(); cpu++) {
+            if (NodeCpus[node][cpu] && cpus[cpu]) {
+                mems.resize(node + 1, false);
+                mems[node] = true;
+                break;
+            }
+        }
+    }
+
+    return BitMapToString(mems);
+}
+
+/*
+ * Best fit: node with least free cores which still fits guarantee,
+ * this keeps large nodes free for large containers.
+ */
+int TCpusetSubsystem::PlaceGuarantee(double guarantee, const TBitMap &allowed) {
+    std::lock_guard<std::mutex> guard(NodesMutex);
+    double best_free = 0;
+    int best = -1;
+
+    for (size_t node = 0; node < NodeCpus.size(); node++) {
+        double cores = 0;
+        bool inside = true;
+
+        for (size_t cpu = 0; cpu < NodeCpus[node].size(); cpu++) {
+            if (!NodeCpus[node][cpu])
+                continue;
+            if (cpu >= allowed.size() || !allowed[cpu])
+                inside = false;
+            cores++;
+        }
+
+        double free = cores - NodeGuarantee[node];
+        if (inside && free >= guarantee && (best < 0 || free < best_free)) {
+            best = node;
+            best_free = free;
+        }
+    }
+
+    if (best >= 0)
+        NodeGuarantee[best] += guarantee;
+
+    return best;
+}
+
+void TCpusetSubsystem::ReserveNode(int node, double guarantee) {
+    std::lock_guard<std::mutex> guard(NodesMutex);
+    if (node >= 0 && node < (int)NodeGuarantee.size())
+        NodeGuarantee[node] += guarantee;
+}
+
+void TCpusetSubsystem::ReleaseNode(int node, double guarantee) {
+    std::lock_guard<std::mutex> guard(NodesMutex);
+    if (node >= 0 && node < (int)NodeGuarantee.size())
+        NodeGuarantee[node] = std::max(0., NodeGuarantee[node] - guarantee);
+}
+
 // Cpuacct
 TError TCpuacctSubsystem::Usage(TCgroup &cg, uint64_t &value) const {
     std::string s;
@@ -561,6 +1024,15 @@ TError TCpuacctSubsystem::SystemUsage(TCgroup &cg, uint64_t &value) const {
     return TError::Success();
 }
 
+TError TCpuacctSubsystem::SystemUsage(TCgroupKnobs &knobs, TCgroup &cg, uint64_t &value) const {
+    TUintField stat[] = { { "system" } };
+    TError error = knobs.GetFields(cg, "cpuacct.stat", stat);
+    if (error)
+        return error;
+    value = stat[0].Value * (1000000000 / sysconf(_SC_CLK_TCK));
+    return TError::Success();
+}
+
 // Netcls
 
 // Blkio
@@ -597,6 +1069,13 @@ TError TBlkioSubsystem::Statistics(TCgroup &cg,
     if (error)
         return error;
 
+    return ParseStatistics(lines, stat);
+}
+
+TError TBlkioSubsystem::ParseStatistics(const std::vector<std::string> &lines,
+                                        std::vector<BlkioStat> &stat) const {
+    TError error;
+
     BlkioStat s;
     for (size_t i = 0; i < lines.size(); i += 5) {
         std::vector<std::string> tokens;
@@ -695,6 +1174,7 @@ TError TDevicesSubsystem::ApplyDevice(TCgroup &cg, const TDevice &device) {
 TMemorySubsystem    MemorySubsystem;
 TFreezerSubsystem   FreezerSubsystem;
 TCpuSubsystem       CpuSubsystem;
+TCpusetSubsystem    CpusetSubsystem;
 TCpuacctSubsystem   CpuacctSubsystem;
 TNetclsSubsystem    NetclsSubsystem;
 TBlkioSubsystem     BlkioSubsystem;
@@ -705,6 +1185,7 @@ std::vector<TSubsystem *> AllSubsystems = {
     { &MemorySubsystem   },
     { &CpuSubsystem      },
     { &CpuacctSubsystem  },
+    { &CpusetSubsystem   },
     { &NetclsSubsystem   },
     { &BlkioSubsystem    },
     { &DevicesSubsystem  },
@@ -763,12 +1244,21 @@ TError InitializeCgroups() {
 
             error = subsys->Root.Mount("cgroup", "cgroup", 0, {subsys->Type});
             if (error) {
-                L_ERR() << "Cannot mount cgroup: " << error << std::endl;
                 (void)subsys->Root.Rmdir();
+                subsys->Root = TPath();
+                if (subsys->Optional) {
+                    L_WRN() << "Cgroup subsystem " << subsys->Type
+                            << " is not supported: " << error << std::endl;
+                    error = TError::Success();
+                    continue;
+                }
+                L_ERR() << "Cannot mount cgroup: " << error << std::endl;
                 return error;
             }
         }
 
+        subsys->Supported = true;
+
         Subsystems.push_back(subsys);
 
         subsys->Hierarchy = subsys;
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <string>
+#include <mutex>
 
 #include "common.hpp"
 #include "util/path.hpp"
+#include "util/string.hpp"
 
 struct TDevice;
 class TCgroup;
@@ -13,10 +15,16 @@ public:
     const std::string Type;
     const TSubsystem *Hierarchy;
     TPath Root;
+    const bool Optional;        /* porto works without it */
+    bool Supported = false;
 
-    TSubsystem(const std::string &type) : Type(type) { }
+    TSubsystem(const std::string &type, bool optional = false) :
+        Type(type), Optional(optional) { }
     virtual void InitializeSubsystem() { }
 
+    /* called for each newly created cgroup */
+    virtual TError InitializeCgroup(const TCgroup &cg) const;
+
     TCgroup RootCgroup() const;
     TCgroup Cgroup(const std::string &name) const;
 
@@ -61,9 +69,12 @@ public:
     bool Exists() const;
 
     TError Create() const;
-    TError Remove() const;
+    TError Remove(bool defer = true) const;
+    TError CancelRemove() const;
 
     TError KillAll(int signal) const;
+    TError KillFrozen(int signal, const std::vector<TCgroup> &subtree = {}) const;
+    TError WaitEmpty(uint64_t deadline) const;
 
     TError GetProcesses(std::vector<pid_t> &pids) const {
         return GetPids("cgroup.procs", pids);
@@ -93,6 +104,80 @@ public:
     TError GetUintMap(const std::string &knob, TUintMap &value) const;
 };
 
+struct BlkioStat {
+    std::string Device;
+    uint64_t Read;
+    uint64_t Write;
+    uint64_t Sync;
+    uint64_t Async;
+};
+
+/* Key of "key value" line, value is filled by parser */
+struct TUintField {
+    const char *Key;
+    uint64_t Value;
+};
+
+/*
+ * Per-container cache of opened cgroup knobs: avoids path building and
+ * open/close for each monitoring request. Knobs are read with pread()
+ * into reusable buffer and parsed in place. Must be closed before the
+ * cgroups are removed.
+ *
+ * Between StartRequest() and FinishRequest() each knob is read only once,
+ * following reads return the same data.
+ */
+class TCgroupKnobs : public TNonCopyable {
+    struct TKnobFd {
+        const TSubsystem *Subsystem;
+        std::string Cgroup;
+        std::string Knob;
+        int Fd;
+        uint64_t Generation;
+        size_t Offset, Length;
+    };
+    std::vector<TKnobFd> Fds;
+    std::vector<char> Buffer;
+    size_t BufferUsed = 0;
+    bool Memoize = false;
+    uint64_t Generation = 1;
+
+    std::vector<BlkioStat> Blkio;
+    std::string BlkioKnob;
+    uint64_t BlkioGeneration = 0;
+
+    TError Read(const TCgroup &cg, const std::string &knob,
+                const char *&data, size_t &len);
+
+public:
+    ~TCgroupKnobs() { Close(); }
+    void Close();
+
+    void StartRequest() {
+        Memoize = true;
+        Generation++;
+        BufferUsed = 0;
+    }
+
+    void FinishRequest() {
+        Memoize = false;
+    }
+
+    TError GetUint64(const TCgroup &cg, const std::string &knob, uint64_t &value);
+    TError GetFields(const TCgroup &cg, const std::string &knob,
+                     TUintField *fields, size_t count);
+    TError GetBlkio(const TCgroup &cg, const std::string &knob,
+                    std::vector<BlkioStat> &stat);
+
+    template <size_t N>
+    TError GetFields(const TCgroup &cg, const std::string &knob, TUintField (&fields)[N]) {
+        return GetFields(cg, knob, fields, N);
+    }
+
+    static void ParseFields(const char *data, size_t len,
+                            TUintField *fields, size_t count);
+};
+
 class TMemorySubsystem : public TSubsystem {
 public:
     const std::string STAT = "memory.stat";
@@ -112,6 +197,7 @@ public:
     const std::string ANON_USAGE = "memory.anon.usage";
     const std::string ANON_LIMIT = "memory.anon.limit";
     const std::string FAIL_CNT = "memory.failcnt";
+    const std::string PRESSURE_LEVEL = "memory.pressure_level";
 
     TMemorySubsystem() : TSubsystem("memory") {}
 
@@ -164,6 +250,7 @@ public:
     }
 
     TError GetAnonUsage(TCgroup &cg, uint64_t &usage) const;
+    TError GetAnonUsage(TCgroupKnobs &knobs, TCgroup &cg, uint64_t &usage) const;
     bool SupportAnonLimit() const;
     TError SetAnonLimit(TCgroup &cg, uint64_t limit) const;
 
@@ -172,6 +259,9 @@ public:
     TError SetIopsLimit(TCgroup &cg, uint64_t limit);
     TError SetDirtyLimit(TCgroup &cg, uint64_t limit);
     TError SetupOOMEvent(TCgroup &cg, TFile &event);
+    TError SetupPressureEvent(TCgroup &cg, TFile &event, const std::string &level);
+    TError SetupThresholdEvent(TCgroup &cg, TFile &event,
+                               const std::vector<uint64_t> &thresholds);
 
     TError GetFailCnt(TCgroup &cg, uint64_t &cnt) {
         return cg.GetUint64(FAIL_CNT, cnt);
@@ -182,12 +272,12 @@ class TFreezerSubsystem : public TSubsystem {
 public:
     TFreezerSubsystem() : TSubsystem("freezer") {}
 
-    TError WaitState(TCgroup &cg, const std::string &state) const;
-    TError Freeze(TCgroup &cg) const;
-    TError Thaw(TCgroup &cg, bool wait = true) const;
-    bool IsFrozen(TCgroup &cg) const;
-    bool IsSelfFreezing(TCgroup &cg) const;
-    bool IsParentFreezing(TCgroup &cg) const;
+    TError WaitState(const TCgroup &cg, const std::string &state) const;
+    TError Freeze(const TCgroup &cg, bool wait = true) const;
+    TError Thaw(const TCgroup &cg, bool wait = true) const;
+    bool IsFrozen(const TCgroup &cg) const;
+    bool IsSelfFreezing(const TCgroup &cg) const;
+    bool IsParentFreezing(const TCgroup &cg) const;
 };
 
 class TCpuSubsystem : public TSubsystem {
@@ -200,11 +290,43 @@ public:
                         double guarantee, double limit);
 };
 
+class TCpusetSubsystem : public TSubsystem {
+    std::mutex NodesMutex;
+    std::vector<double> NodeGuarantee;  /* cores reserved by placed containers */
+public:
+    const std::string CPUS = "cpuset.cpus";
+    const std::string MEMS = "cpuset.mems";
+    const std::string MEMORY_MIGRATE = "cpuset.memory_migrate";
+    const std::string CLONE_CHILDREN = "cgroup.clone_children";
+
+    std::vector<TBitMap> NodeCpus;      /* NUMA topology, index is node */
+
+    TCpusetSubsystem() : TSubsystem("cpuset", true) {}
+    void InitializeSubsystem() override;
+    TError InitializeCgroup(const TCgroup &cg) const override;
+
+    TError GetCpus(const TCgroup &cg, TBitMap &cpus) const;
+    TError GetMems(const TCgroup &cg, std::string &mems) const {
+        TError error = cg.Get(MEMS, mems);
+        if (!error)
+            mems = StringTrim(mems);
+        return error;
+    }
+    TError SetCpus(const TCgroup &cg, const TBitMap &cpus, const std::string &mems) const;
+
+    int FindNode(const TBitMap &cpus) const;
+    std::string NodesOf(const TBitMap &cpus) const;
+    int PlaceGuarantee(double guarantee, const TBitMap &allowed);
+    void ReserveNode(int node, double guarantee);
+    void ReleaseNode(int node, double guarantee);
+};
+
 class TCpuacctSubsystem : public TSubsystem {
 public:
     TCpuacctSubsystem() : TSubsystem("cpuacct") {}
     TError Usage(TCgroup &cg, uint64_t &value) const;
     TError SystemUsage(TCgroup &cg, uint64_t &value) const;
+    TError SystemUsage(TCgroupKnobs &knobs, TCgroup &cg, uint64_t &value) const;
 };
 
 class TNetclsSubsystem : public TSubsystem {
@@ -212,14 +334,6 @@ public:
     TNetclsSubsystem() : TSubsystem("net_cls") {}
 };
 
-struct BlkioStat {
-    std::string Device;
-    uint64_t Read;
-    uint64_t Write;
-    uint64_t Sync;
-    uint64_t Async;
-};
-
 class TBlkioSubsystem : public TSubsystem {
     TError GetStatLine(const std::vector<std::string> &lines,
                        const size_t i,
@@ -232,6 +346,8 @@ public:
     TError Statistics(TCgroup &cg,
                       const std::string &file,
                       std::vector<BlkioStat> &stat) const;
+    TError ParseStatistics(const std::vector<std::string> &lines,
+                           std::vector<BlkioStat> &stat) const;
     TError SetIoPolicy(TCgroup &cg, const std::string &policy) const;
     bool SupportIoPolicy() const;
 };
@@ -246,6 +362,7 @@ public:
 extern TMemorySubsystem     MemorySubsystem;
 extern TFreezerSubsystem    FreezerSubsystem;
 extern TCpuSubsystem        CpuSubsystem;
+extern TCpusetSubsystem     CpusetSubsystem;
 extern TCpuacctSubsystem    CpuacctSubsystem;
 extern TNetclsSubsystem     NetclsSubsystem;
 extern TBlkioSubsystem      BlkioSubsystem;
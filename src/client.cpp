@@ -93,6 +93,7 @@ void TClient::CloseConnection() {
 
 void TClient::StartRequest() {
     RequestStartMs = GetCurrentTimeMs();
+    RequestContainerId = -1;
     PORTO_ASSERT(CurrentClient == nullptr);
     CurrentClient = this;
 }
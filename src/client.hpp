@@ -3,6 +3,7 @@
 #include <string>
 #include <mutex>
 #include <list>
+#include <map>
 
 #include "common.hpp"
 #include "epoll.hpp"
@@ -64,6 +65,9 @@ public:
 
     std::shared_ptr<TContainerWaiter> Waiter;
 
+    /* readStream position per "container:stream" */
+    std::map<std::string, uint64_t> StreamCursor;
+
     TError ReadRequest(rpc::TContainerRequest &request);
     bool ReadInterrupted();
 
@@ -72,6 +76,9 @@ public:
 
     std::list<std::weak_ptr<TContainer>> WeakContainers;
 
+    /* Container named in current request, for request log, -1 if none */
+    int RequestContainerId = -1;
+
 private:
     std::mutex Mutex;
     uint64_t ConnectionTime = 0;
@@ -67,6 +67,7 @@ constexpr uint64_t CONTAINER_PATH_MAX = 200;
 constexpr uint64_t CONTAINER_ID_MAX = 16384;
 constexpr uint64_t CONTAINER_LEVEL_MAX = 7;
 constexpr uint64_t RUN_SUBDIR_LIMIT = 100u;
+constexpr uint64_t EXEC_STATUS_MAX = 64; /* exit statuses kept per container */
 
 constexpr const char *PORTO_NAME_CHARS = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-@:.";
 
@@ -28,6 +28,12 @@ void TConfig::LoadDefaults() {
     config().mutable_master_log()->set_perm(0644);
 
     config().mutable_log()->set_verbose(false);
+    config().mutable_log()->set_requests(true);
+
+    config().mutable_request_log()->mutable_file()->set_path("/var/log/portod.requests");
+    config().mutable_request_log()->mutable_file()->set_perm(0640);
+    config().mutable_request_log()->set_sample(100);
+    config().mutable_request_log()->set_slow_ms(1000);
 
     config().mutable_keyval()->mutable_file()->set_path("/run/porto/kvs");
 
@@ -44,6 +50,15 @@ void TConfig::LoadDefaults() {
     config().mutable_daemon()->set_workers(4);
     config().mutable_daemon()->set_max_msg_len(32 * 1024 * 1024);
     config().mutable_daemon()->set_event_workers(1);
+    config().mutable_daemon()->set_stat_sample_interval_ms(0);
+    config().mutable_daemon()->set_stat_history_size(60);
+    config().mutable_daemon()->set_cgroup_reaper_timeout_s(60);
+    config().mutable_daemon()->set_teardown_workers(4);
+    config().mutable_daemon()->set_spawner(true);
+    config().mutable_daemon()->set_warm_cgroups(0);
+    config().mutable_daemon()->set_warm_netns(0);
+    config().mutable_daemon()->set_start_workers(4);
+    config().mutable_daemon()->set_log_queue(4096);
 
     config().mutable_container()->set_tmp_dir("/place/porto");
     config().mutable_container()->set_chroot_porto_dir("porto");
@@ -74,6 +89,7 @@ void TConfig::LoadDefaults() {
     config().mutable_volumes()->set_volume_dir("porto_volumes");
     config().mutable_volumes()->set_layers_dir("porto_layers");
     config().mutable_volumes()->set_enable_quota(true);
+    config().mutable_volumes()->set_native_tar(true);
 
     config().mutable_network()->set_device_qdisc("default: hfsc");
     config().mutable_network()->set_default_rate("default: 125000");    /* 1Mbit */
@@ -4,6 +4,9 @@
 #include <csignal>
 #include <cstdlib>
 #include <algorithm>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 
 #include "statistics.hpp"
 #include "container.hpp"
@@ -19,6 +22,7 @@
 #include "epoll.hpp"
 #include "kvalue.hpp"
 #include "volume.hpp"
+#include "pool.hpp"
 #include "util/log.hpp"
 #include "util/string.hpp"
 #include "util/cred.hpp"
@@ -35,10 +39,12 @@ extern "C" {
 #include <fcntl.h>
 #include <sys/fsuid.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 }
 
 std::mutex ContainersMutex;
-std::map<std::string, std::shared_ptr<TContainer>> Containers;
+std::unordered_map<std::string, std::shared_ptr<TContainer>> Containers;
+std::map<pid_t, std::weak_ptr<TContainer>> ExecPids;
 TPath ContainersKV;
 
 using std::string;
@@ -57,8 +63,9 @@ std::shared_ptr<TContainer> TContainer::Find(const std::string &name) {
 
 TError TContainer::Find(const std::string &name, std::shared_ptr<TContainer> &ct) {
     ct = Find(name);
-    if (ct)
+    if (ct && !ct->Dying)
         return TError::Success();
+    ct = nullptr;
     return TError(EError::ContainerDoesNotExist, "container " + name + " not found");
 }
 
@@ -251,19 +258,29 @@ void TContainer::RemoveKvs() {
 
     TPath path(ContainersKV / std::to_string(Id));
     TError error = path.Unlink();
-    if (error)
+    /* deferred destroy removes node before teardown */
+    if (error && error.GetErrno() != ENOENT)
         L_ERR() << "Can't remove key-value node " << path << ": " << error << std::endl;
 }
 
 void TContainer::Destroy(void) {
     L_ACT() << "Destroy " << GetName() << " " << Id << std::endl;
 
+    for (auto &it: ExecTasks) {
+        if (it.second.Reply)
+            it.second.Reply(TError(EError::ContainerDoesNotExist,
+                                   "Container " + GetName() + " destroyed"), -1);
+    }
+    ExecTasks.clear();
+
     while (!Volumes.empty()) {
         std::shared_ptr<TVolume> volume = Volumes.back();
         if (!volume->UnlinkContainer(*this) && volume->IsDying)
             volume->Destroy();
     }
 
+    ForgetStreamWatches();
+
     if (Net) {
         auto lock = Net->ScopedLock();
         Net = nullptr;
@@ -415,6 +432,14 @@ TError TContainer::ApplyDynamicProperties() {
         }
     }
 
+    if (TestClearPropDirty(EProperty::MEM_THRESHOLD) && !IsRoot() && !IsPortoRoot()) {
+        error = PrepareMemThreshold();
+        if (error) {
+            L_ERR() << "Can't set " << P_MEM_THRESHOLD << ": " << error << std::endl;
+            return error;
+        }
+    }
+
     if (TestClearPropDirty(EProperty::ANON_LIMIT)) {
         error = MemorySubsystem.SetAnonLimit(memcg, AnonMemLimit);
         if (error) {
@@ -464,6 +489,15 @@ TError TContainer::ApplyDynamicProperties() {
         }
     }
 
+    if (TestClearPropDirty(EProperty::CPU_SET) |
+            (CpuSetNode >= 0 && PropDirty[(int)EProperty::CPU_GUARANTEE])) {
+        error = ApplyCpuSet();
+        if (error) {
+            L_ERR() << "Can't set " << P_CPU_SET << ": " << error << std::endl;
+            return error;
+        }
+    }
+
     if (TestClearPropDirty(EProperty::CPU_POLICY) |
             TestClearPropDirty(EProperty::CPU_LIMIT) |
             TestClearPropDirty(EProperty::CPU_GUARANTEE)) {
@@ -525,6 +559,396 @@ TError TContainer::PrepareOomMonitor() {
     return error;
 }
 
+void TContainer::ShutdownMemPressure() {
+    for (auto &pressure: MemPressure)
+        if (pressure.Source)
+            Holder->EpollLoop->RemoveSource(pressure.Source->Fd);
+    MemPressure.clear();
+}
+
+/* Not fatal: kernel might have no pressure_level */
+void TContainer::PrepareMemPressure() {
+    TCgroup memoryCg = GetCgroup(MemorySubsystem);
+    TError error;
+
+    ShutdownMemPressure();
+    MemPressureCount.clear();
+
+    for (auto &level: { "medium", "critical" }) {
+        MemPressure.emplace_back();
+        auto &pressure = MemPressure.back();
+
+        pressure.Level = level;
+        error = MemorySubsystem.SetupPressureEvent(memoryCg, pressure.Event,
+                                                   pressure.Level);
+        if (!error) {
+            pressure.Source = std::make_shared<TEpollSource>(Holder->EpollLoop,
+                    pressure.Event.Fd, EPOLL_EVENT_MEM_PRESSURE, shared_from_this());
+            error = Holder->EpollLoop->AddSource(pressure.Source);
+            if (error)
+                pressure.Source = nullptr;
+        }
+
+        if (error) {
+            MemPressure.pop_back();
+            if (error.GetError() != EError::NotSupported)
+                L_WRN() << "Can't prepare " << level << " memory pressure monitoring: "
+                        << error << std::endl;
+            break;
+        }
+
+        MemPressureCount[pressure.Level] = 0;
+    }
+}
+
+void TContainer::DeliverMemPressure(int fd) {
+    for (auto &pressure: MemPressure) {
+        if (pressure.Event.Fd != fd)
+            continue;
+
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+
+        if (count) {
+            MemPressureCount[pressure.Level] += count;
+            Statistics->MemPressureEvents += count;
+            L_EVT() << "Memory pressure " << pressure.Level << " in "
+                    << GetName() << std::endl;
+            NotifyEvent("memory_pressure");
+        }
+
+        Holder->EpollLoop->StartInput(fd);
+        break;
+    }
+}
+
+/*
+ * Auto placement keeps node once chosen, after restore it is recognized
+ * by current cpus. Guaranteed cores are reserved at node for packing.
+ */
+TError TContainer::ApplyCpuSet() {
+    if (IsRoot() || IsPortoRoot() || State == EContainerState::Dead ||
+            !CpusetSubsystem.Supported)
+        return TError::Success();
+
+    TCgroup cg = GetCgroup(CpusetSubsystem);
+    TCgroup parentCg = Parent->GetCgroup(CpusetSubsystem);
+    TBitMap cpus, parentCpus;
+    std::string mems;
+    int node = -1;
+    TError error;
+
+    int lastNode = CpuSetNode;
+    ReleaseCpuSet();
+
+    error = CpusetSubsystem.GetCpus(parentCg, parentCpus);
+    if (error)
+        return error;
+
+    if (StringStartsWith(CpuSet, "node ")) {
+        error = StringToInt(CpuSet.substr(5), node);
+        if (error)
+            return error;
+    } else if (CpuSet == "auto" && CpuGuarantee > 0) {
+        node = lastNode;
+        if (node < 0 && !CpusetSubsystem.GetCpus(cg, cpus) && cpus != parentCpus)
+            node = CpusetSubsystem.FindNode(cpus);
+        if (node < 0) {
+            node = CpusetSubsystem.PlaceGuarantee(CpuGuarantee, parentCpus);
+            if (node < 0)
+                L() << "No NUMA node fits " << CpuGuarantee << " cores for "
+                    << GetName() << std::endl;
+            else
+                L_ACT() << "Place " << GetName() << " at NUMA node " << node << std::endl;
+        } else
+            CpusetSubsystem.ReserveNode(node, CpuGuarantee);
+        if (node >= 0)
+            CpuSetReserved = CpuGuarantee;
+    } else if (CpuSet != "" && CpuSet != "auto") {
+        error = StringToBitMap(CpuSet, cpus);
+        if (error)
+            return error;
+        mems = CpusetSubsystem.NodesOf(cpus);
+    }
+
+    if (node >= 0) {
+        if (node >= (int)CpusetSubsystem.NodeCpus.size())
+            return TError(EError::InvalidValue, "Unknown NUMA node " + std::to_string(node));
+        if (StringStartsWith(CpuSet, "node ")) {
+            CpusetSubsystem.ReserveNode(node, CpuGuarantee);
+            CpuSetReserved = CpuGuarantee;
+        }
+        CpuSetNode = node;
+        cpus = CpusetSubsystem.NodeCpus[node];
+        mems = std::to_string(node);
+    } else if (mems.empty()) {
+        cpus = parentCpus;
+        error = CpusetSubsystem.GetMems(parentCg, mems);
+        if (error)
+            return error;
+    }
+
+    return CpusetSubsystem.SetCpus(cg, cpus, mems);
+}
+
+void TContainer::ReleaseCpuSet() {
+    CpusetSubsystem.ReleaseNode(CpuSetNode, CpuSetReserved);
+    CpuSetNode = -1;
+    CpuSetReserved = 0;
+}
+
+void TContainer::ShutdownMemThreshold() {
+    if (MemThresholdSource)
+        Holder->EpollLoop->RemoveSource(MemThresholdSource->Fd);
+    MemThresholdSource = nullptr;
+    MemThresholdEvent.Close();
+}
+
+TError TContainer::PrepareMemThreshold() {
+    TCgroup memoryCg = GetCgroup(MemorySubsystem);
+    TError error;
+
+    ShutdownMemThreshold();
+
+    if (MemThresholds.empty())
+        return TError::Success();
+
+    error = MemorySubsystem.Usage(memoryCg, MemThresholdUsage);
+    if (error)
+        return error;
+
+    error = MemorySubsystem.SetupThresholdEvent(memoryCg, MemThresholdEvent,
+                                                MemThresholds);
+    if (error)
+        return error;
+
+    MemThresholdSource = std::make_shared<TEpollSource>(Holder->EpollLoop,
+            MemThresholdEvent.Fd, EPOLL_EVENT_MEM_THRESHOLD, shared_from_this());
+
+    error = Holder->EpollLoop->AddSource(MemThresholdSource);
+    if (error)
+        ShutdownMemThreshold();
+
+    return error;
+}
+
+void TContainer::DeliverMemThreshold(int fd) {
+    uint64_t count, usage, crossed = 0;
+
+    if (!MemThresholdSource || MemThresholdEvent.Fd != fd)
+        return;
+
+    /* eventfd counter is reset by read */
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+
+    TCgroup memoryCg = GetCgroup(MemorySubsystem);
+    if (count && !MemorySubsystem.Usage(memoryCg, usage)) {
+        for (auto threshold: MemThresholds)
+            if ((MemThresholdUsage < threshold) != (usage < threshold))
+                crossed++;
+
+        /* kernel saw crossing but usage came back before we looked */
+        if (!crossed)
+            crossed = 1;
+
+        MemThresholdUsage = usage;
+    }
+
+    if (crossed) {
+        Statistics->MemThresholdEvents += crossed;
+        L_EVT() << "Memory usage " << MemThresholdUsage << " crossed threshold in "
+                << GetName() << std::endl;
+        NotifyEvent("memory_threshold");
+    }
+
+    Holder->EpollLoop->StartInput(fd);
+}
+
+TError TContainer::PrepareStreams(bool restore) {
+    TError error;
+
+    for (auto stream: { &Stdout, &Stderr }) {
+        error = stream->StartCapture(*this, restore);
+        if (error || stream->Pipe.Fd < 0)
+            break;
+
+        stream->Source = std::make_shared<TEpollSource>(Holder->EpollLoop,
+                stream->Pipe.Fd, EPOLL_EVENT_STREAM, shared_from_this());
+
+        error = Holder->EpollLoop->AddSource(stream->Source);
+        if (error)
+            break;
+    }
+
+    if (error) {
+        L_ERR() << "Cannot capture streams of " << GetName() << ": " << error << std::endl;
+        Stdout.StopCapture(true);
+        Stderr.StopCapture(true);
+    }
+
+    return error;
+}
+
+void TContainer::DeliverStream(int fd) {
+    for (auto stream: { &Stdout, &Stderr }) {
+        if (!stream->Source || stream->Pipe.Fd != fd)
+            continue;
+
+        uint64_t written = stream->Written;
+
+        /* all writers are gone, rest is drained at exit */
+        bool alive = stream->Drain();
+
+        if (stream->Written != written)
+            NotifyEvent(stream->Stream == 1 ? D_STDOUT : D_STDERR);
+
+        if (alive)
+            Holder->EpollLoop->StartInput(fd);
+        break;
+    }
+}
+
+/* All followed stream files share one inotify, watch descriptor -> stream */
+struct TStreamWatchEntry {
+    std::weak_ptr<TContainer> Container;
+    int Stream;
+    int Users;
+    uint64_t Serial;        /* descriptors could be reused after removal */
+};
+
+static std::mutex StreamNotifyLock;
+static TFile StreamNotify;
+static std::shared_ptr<TEpollSource> StreamNotifySource;
+static std::map<int, TStreamWatchEntry> StreamWatches;
+static uint64_t StreamWatchSerial;
+
+TStreamWatch::~TStreamWatch() {
+    std::lock_guard<std::mutex> guard(StreamNotifyLock);
+
+    auto it = StreamWatches.find(Wd);
+    if (it == StreamWatches.end() || it->second.Serial != Serial)
+        return;
+
+    if (!--it->second.Users) {
+        (void)inotify_rm_watch(StreamNotify.Fd, Wd);
+        StreamWatches.erase(it);
+    }
+}
+
+void TContainer::ForgetStreamWatches() {
+    std::lock_guard<std::mutex> guard(StreamNotifyLock);
+
+    for (auto it = StreamWatches.begin(); it != StreamWatches.end(); ) {
+        auto ct = it->second.Container.lock();
+        if (!ct || ct.get() == this) {
+            (void)inotify_rm_watch(StreamNotify.Fd, it->first);
+            it = StreamWatches.erase(it);
+        } else
+            it++;
+    }
+}
+
+TError TContainer::WatchStream(const TStdStream &stream,
+                               std::shared_ptr<TStreamWatch> &watch) {
+    watch = nullptr;
+    if (stream.IsCaptured())
+        return TError::Success();
+
+    TPath path = stream.ResolveOutside(*this);
+    if (path.IsEmpty())
+        return TError(EError::InvalidData, "Data not available");
+
+    std::lock_guard<std::mutex> guard(StreamNotifyLock);
+
+    if (StreamNotify.Fd < 0) {
+        StreamNotify.SetFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (StreamNotify.Fd < 0)
+            return TError(EError::Unknown, errno, "inotify_init1()");
+
+        StreamNotifySource = std::make_shared<TEpollSource>(Holder->EpollLoop,
+                StreamNotify.Fd, EPOLL_EVENT_STREAM_NOTIFY, std::weak_ptr<TContainer>());
+
+        TError error = Holder->EpollLoop->AddSource(StreamNotifySource);
+        if (error) {
+            StreamNotifySource = nullptr;
+            StreamNotify.Close();
+            return error;
+        }
+    }
+
+    /* same inode gets same descriptor, followers share it */
+    int wd = inotify_add_watch(StreamNotify.Fd, path.c_str(),
+                               IN_MODIFY | IN_DONT_FOLLOW);
+    if (wd < 0)
+        return TError(EError::Unknown, errno, "inotify_add_watch(" + path.ToString() + ")");
+
+    auto it = StreamWatches.find(wd);
+    if (it == StreamWatches.end())
+        it = StreamWatches.emplace(wd, TStreamWatchEntry{ shared_from_this(),
+                    stream.Stream, 0, ++StreamWatchSerial }).first;
+    it->second.Users++;
+
+    watch = std::make_shared<TStreamWatch>(wd, it->second.Serial);
+
+    return TError::Success();
+}
+
+void TContainer::DeliverStreamNotify(TScopedLock &holder_lock) {
+    std::vector<std::pair<std::shared_ptr<TContainer>, int>> targets;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    std::unique_lock<std::mutex> guard(StreamNotifyLock);
+    ssize_t len;
+
+    if (StreamNotify.Fd < 0)
+        return;
+
+    while ((len = read(StreamNotify.Fd, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ) {
+            auto ev = (struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + ev->len;
+
+            /* events are lost: wake all followers, they will read again */
+            if (ev->mask & IN_Q_OVERFLOW) {
+                L_WRN() << "Stream notify queue overflow" << std::endl;
+                for (auto &it: StreamWatches) {
+                    auto target = std::make_pair(it.second.Container.lock(),
+                                                 it.second.Stream);
+                    if (target.first && std::find(targets.begin(), targets.end(),
+                                                  target) == targets.end())
+                        targets.push_back(target);
+                }
+                continue;
+            }
+
+            auto it = StreamWatches.find(ev->wd);
+            if (it == StreamWatches.end())
+                continue;
+
+            auto target = std::make_pair(it->second.Container.lock(),
+                                         it->second.Stream);
+            if (ev->mask & IN_IGNORED) {
+                StreamWatches.erase(it);
+            } else if (!target.first) {
+                (void)inotify_rm_watch(StreamNotify.Fd, ev->wd);
+                StreamWatches.erase(it);
+            } else if (std::find(targets.begin(), targets.end(),
+                                 target) == targets.end())
+                targets.push_back(target);
+        }
+    }
+
+    StreamNotifySource->EpollLoop->StartInput(StreamNotify.Fd);
+    guard.unlock();
+
+    for (auto &it: targets) {
+        TNestedScopedLock lock(*it.first, holder_lock);
+        if (it.first->IsValid())
+            it.first->NotifyEvent(it.second == 1 ? D_STDOUT : D_STDERR);
+    }
+}
+
 TError TContainer::ConfigureDevices(std::vector<TDevice> &devices) {
     auto cg = GetCgroup(DevicesSubsystem);
     TDevice device;
@@ -565,9 +989,17 @@ TError TContainer::PrepareCgroups() {
     for (auto hy: Hierarchies) {
         TCgroup cg = GetCgroup(*hy);
 
+        /* don't reuse directory which reaper is going to remove */
+        error = cg.CancelRemove();
+        if (error)
+            return error;
+
         if (cg.Exists()) //FIXME kludge for root and restore
             continue;
 
+        if (WarmPool.TakeCgroup(cg))
+            continue;
+
         error = cg.Create();
         if (error)
             return error;
@@ -585,6 +1017,20 @@ TError TContainer::PrepareCgroups() {
             L_ERR() << "Can't prepare OOM monitoring: " << error << std::endl;
             return error;
         }
+
+        PrepareMemPressure();
+
+        error = ApplyCpuSet();
+        if (error) {
+            L_ERR() << "Can't prepare cpuset: " << error << std::endl;
+            return error;
+        }
+
+        error = PrepareMemThreshold();
+        if (error) {
+            L_ERR() << "Can't prepare memory threshold monitoring: " << error << std::endl;
+            return error;
+        }
     }
 
     return TError::Success();
@@ -705,9 +1151,17 @@ TError TContainer::GetEnvironment(TEnv &env) {
     return TError::Success();
 }
 
+TError TContainer::GetTaskCred(TCred &cred) const {
+    if (VirtMode == VIRT_MODE_OS) {
+        cred = TCred(0, 0);
+        return TError::Success();
+    }
+    cred = OwnerCred;
+    return cred.LoadGroups(UserName(OwnerCred.Uid));
+}
+
 TError TContainer::PrepareTask(struct TTaskEnv *taskEnv,
                                struct TNetCfg *NetCfg) {
-    auto user = UserName(OwnerCred.Uid);
     auto parent = FindRunningParent();
     TError error;
 
@@ -731,15 +1185,9 @@ TError TContainer::PrepareTask(struct TTaskEnv *taskEnv,
 
     taskEnv->Mnt.OwnerCred = OwnerCred;
 
-    if (VirtMode == VIRT_MODE_OS) {
-        user = "root";
-        taskEnv->Cred = TCred(0, 0);
-    } else {
-        taskEnv->Cred = OwnerCred;
-        error = taskEnv->Cred.LoadGroups(user);
-        if (error)
-            return error;
-    }
+    error = GetTaskCred(taskEnv->Cred);
+    if (error)
+        return error;
 
     error = GetEnvironment(taskEnv->Env);
     if (error)
@@ -966,7 +1414,18 @@ TError TContainer::Start(bool meta) {
     StartTime = GetCurrentTimeMs();
     SetProp(EProperty::START_TIME);
 
+    uint64_t startUs = GetCurrentTimeUs(), phaseUs = startUs;
+    auto phase = [&] (const std::string &name) {
+        uint64_t now = GetCurrentTimeUs();
+        StartProfile[name] = now - phaseUs;
+        StartProfile["total"] = now - startUs;
+        phaseUs = now;
+    };
+
+    StartProfile.clear();
+
     error = PrepareResources();
+    phase("prepare_resources");
     if (error)
         return error;
 
@@ -978,11 +1437,13 @@ TError TContainer::Start(bool meta) {
         return error;
 
     error = PrepareNetwork(NetCfg);
+    phase("prepare_network");
     if (error)
         goto error;
 
     if (!IsRoot()) {
         error = ApplyDynamicProperties();
+        phase("apply_properties");
         if (error)
             return error;
     }
@@ -1003,10 +1464,14 @@ TError TContainer::Start(bool meta) {
     if (!meta || (meta && Isolate)) {
 
         error = PrepareTask(&TaskEnv, &NetCfg);
+        phase("prepare_task");
         if (error)
             goto error;
 
         error = TaskEnv.Start();
+        phase("task_start");
+        StartProfile["task_start"] -= TaskEnv.ReportWaitUs;
+        StartProfile["task_report"] = TaskEnv.ReportWaitUs;
 
         /* Always report OOM stuation if any */
         if (error && HasOomReceived()) {
@@ -1032,13 +1497,202 @@ TError TContainer::Start(bool meta) {
     if (error)
         L_ERR() << "Can't update meta soft limit: " << error << std::endl;
 
-    return Save();
+    error = Save();
+    phase("save");
+    return error;
 
 error:
     FreeResources();
     return error;
 }
 
+static TError StartSubtreeNode(std::shared_ptr<TContainer> ct, bool meta) {
+    auto holder_lock = LockContainers();
+    TNestedScopedLock lock(*ct, holder_lock);
+
+    if (!ct->IsValid())
+        return TError(EError::ContainerDoesNotExist,
+                      "Container " + ct->GetName() + " was destroyed");
+
+    if (ct->GetState() == EContainerState::Running ||
+            ct->GetState() == EContainerState::Meta)
+        return TError::Success();
+
+    TError error = CurrentClient ? CurrentClient->CanControl(*ct) : TError::Success();
+    if (error)
+        return error;
+
+    auto parent = ct->GetParent();
+    if (parent->GetState() != EContainerState::Running &&
+            parent->GetState() != EContainerState::Meta)
+        return TError(EError::InvalidState, "Parent container " +
+                      parent->GetName() + " is not running");
+
+    TScopedUnlock unlock(holder_lock);
+    return ct->Start(meta);
+}
+
+/*
+ * Validates start of descendants before anything is started: client
+ * must control each of them, "after" must name siblings without cycles.
+ * Container becomes ready when its parent and siblings listed in "after"
+ * are started.
+ */
+TError TContainer::PlanSubtree(TScopedLock &holder_lock,
+                               const std::map<std::string, std::vector<std::string>> &after,
+                               std::vector<TStartNode> &nodes) {
+    std::map<std::string, size_t> index;
+    TError error;
+
+    nodes.clear();
+    error = ApplyForTreePreorder(holder_lock, [&] (TScopedLock &holder_lock, TContainer &ct) {
+        if (ct.State == EContainerState::Stopped && CurrentClient) {
+            TError error = CurrentClient->CanControl(ct);
+            if (error)
+                return error;
+        }
+        index[ct.GetName()] = nodes.size();
+        nodes.push_back({ ct.shared_from_this(),
+                          ct.Command.empty() && !ct.GetChildren().empty(), 0, {} });
+        return TError::Success();
+    });
+    if (error)
+        return error;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        auto it = index.find(nodes[i].Container->Parent->GetName());
+        if (it != index.end()) {
+            nodes[it->second].Next.push_back(i);
+            nodes[i].Pending++;
+        }
+    }
+
+    for (auto &dep: after) {
+        auto it = index.find(dep.first);
+        if (it == index.end())
+            return TError(EError::InvalidValue, "Container " + dep.first +
+                          " isn't in subtree of " + GetName());
+        auto &node = nodes[it->second];
+
+        for (auto &name: dep.second) {
+            auto prev = index.find(name);
+            if (prev == index.end() ||
+                    nodes[prev->second].Container->Parent != node.Container->Parent)
+                return TError(EError::InvalidValue, "Container " + name +
+                              " isn't sibling of " + dep.first);
+            nodes[prev->second].Next.push_back(it->second);
+            node.Pending++;
+        }
+    }
+
+    std::deque<size_t> ready;
+    std::vector<int> pending;
+    size_t sorted = 0;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        pending.push_back(nodes[i].Pending);
+        if (!nodes[i].Pending)
+            ready.push_back(i);
+    }
+
+    while (!ready.empty()) {
+        size_t i = ready.front();
+        ready.pop_front();
+        sorted++;
+        for (auto next: nodes[i].Next)
+            if (!--pending[next])
+                ready.push_back(next);
+    }
+
+    if (sorted != nodes.size())
+        return TError(EError::InvalidValue, "Dependency cycle in start of " + GetName());
+
+    return TError::Success();
+}
+
+/*
+ * Starts planned descendants in start_workers threads. Failure of container
+ * fails only everything which depends on it, the rest is kept running.
+ */
+TError TContainer::StartSubtree(TScopedLock &holder_lock, std::vector<TStartNode> &nodes,
+                                std::vector<TStartResult> &results) {
+    std::deque<size_t> ready;
+    TError error;
+
+    for (size_t i = 0; i < nodes.size(); i++)
+        if (!nodes[i].Pending)
+            ready.push_back(i);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t remaining = nodes.size();
+
+    std::function<void(size_t, const TError &)> finish = [&] (size_t i, const TError &result) {
+        auto &node = nodes[i];
+
+        results.push_back({ node.Container->GetName(), result });
+        if (result && !error)
+            error = result;
+        remaining--;
+
+        for (auto next: node.Next) {
+            auto &dep = nodes[next];
+            if (dep.Pending < 0)
+                continue;
+            if (result) {
+                dep.Pending = -1;
+                finish(next, TError(EError::InvalidState, "Dependency " +
+                                    node.Container->GetName() + " failed to start"));
+            } else if (!--dep.Pending)
+                ready.push_back(next);
+        }
+    };
+
+    TClient *client = CurrentClient;
+
+    auto worker = [&] () {
+        CurrentClient = client;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (remaining) {
+            if (ready.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+
+            size_t i = ready.front();
+            ready.pop_front();
+
+            lock.unlock();
+            TError result = StartSubtreeNode(nodes[i].Container, nodes[i].Meta);
+            lock.lock();
+
+            finish(i, result);
+            cv.notify_all();
+        }
+
+        CurrentClient = nullptr;
+    };
+
+    size_t workers = std::min<size_t>(nodes.size(),
+                        std::max(config().daemon().start_workers(), 1u));
+
+    if (workers) {
+        TScopedUnlock unlock(holder_lock);
+        std::vector<std::thread> threads;
+
+        L_ACT() << "Start " << nodes.size() << " containers in " << GetName()
+                << " with " << workers << " workers" << std::endl;
+
+        for (size_t i = 0; i < workers; i++)
+            threads.emplace_back(worker);
+        for (auto &thread: threads)
+            thread.join();
+    }
+
+    return error;
+}
+
 TError TContainer::ApplyForTreePreorder(TScopedLock &holder_lock,
                                 std::function<TError (TScopedLock &holder_lock,
                                                       TContainer &container)> fn) {
@@ -1113,6 +1767,12 @@ TError TContainer::PrepareResources() {
         return error;
     }
 
+    error = PrepareStreams(false);
+    if (error) {
+        FreeResources();
+        return error;
+    }
+
     if (HasProp(EProperty::ROOT) && RootPath.IsRegularFollow()) {
         TStringMap cfg;
 
@@ -1139,11 +1799,20 @@ void TContainer::FreeResources() {
     TError error;
 
     ShutdownOom();
+    ShutdownMemPressure();
+    ShutdownMemThreshold();
+    ReleaseCpuSet();
+    Stdout.StopCapture(true);
+    Stderr.StopCapture(true);
+    Knobs.Close();
+    Sample.Time = 0;
+    HistoryCount = 0;
 
     if (!IsRoot()) {
         for (auto hy: Hierarchies) {
             auto cg = GetCgroup(*hy);
 
+            WarmPool.DropCgroups(cg);
             error = cg.Remove();
             (void)error; //Logged inside
         }
@@ -1255,6 +1924,88 @@ TError TContainer::Kill(int sig) {
     return Task.Kill(sig);
 }
 
+TError TContainer::Exec(const std::string &command, const std::string &env,
+                        const std::string &cwd, const std::string stdPath[3],
+                        pid_t &pid, pid_t &vpid) {
+    TTaskEnv taskEnv;
+    TError error;
+
+    if ((State != EContainerState::Running &&
+         State != EContainerState::Meta) || Task.Pid <= 0)
+        return TError(EError::InvalidState, "Container " + GetName() + " is not running");
+
+    if (command.empty())
+        return TError(EError::InvalidValue, "Empty command");
+
+    taskEnv.CT = shared_from_this();
+    taskEnv.Client = CurrentClient;
+
+    for (auto hy: Hierarchies)
+        taskEnv.Cgroups.push_back(GetCgroup(*hy));
+
+    taskEnv.Mnt.Cwd = cwd.empty() ? GetCwd() : TPath(cwd);
+
+    error = GetTaskCred(taskEnv.Cred);
+    if (error)
+        return error;
+
+    error = GetEnvironment(taskEnv.Env);
+    if (error)
+        return error;
+
+    if (!env.empty()) {
+        std::vector<std::string> cfg;
+        SplitEscapedString(env, cfg, ';');
+        error = taskEnv.Env.Parse(cfg, true);
+        if (error)
+            return error;
+    }
+
+    /* Same namespaces, root and cwd as main task */
+    error = taskEnv.ParentNs.Open(Task.Pid);
+    if (error)
+        return error;
+
+    error = taskEnv.Exec(command, stdPath, pid, vpid);
+    if (error) {
+        L_WRN() << "Cannot exec in " << GetName() << ": " << error << std::endl;
+        return error;
+    }
+
+    L_ACT() << "Exec " << pid << " in " << GetName() << " vpid " << vpid
+            << " command " << command << std::endl;
+
+    Statistics->ExecStarts++;
+    return TError::Success();
+}
+
+void TContainer::ExecExit(pid_t pid, int status) {
+    auto it = ExecTasks.find(pid);
+    if (it == ExecTasks.end())
+        return;
+
+    L_EVT() << "Exec " << pid << " in " << GetName() << " exited with "
+            << FormatExitStatus(status) << std::endl;
+
+    if (it->second.Reply)
+        it->second.Reply(TError::Success(), status);
+    ExecTasks.erase(it);
+
+    std::string key = std::to_string(pid);
+    if (!ExecStatus.count(key))
+        ExecExited.push_back(key);
+    ExecStatus[key] = status;
+    while (ExecExited.size() > EXEC_STATUS_MAX) {
+        ExecStatus.erase(ExecExited.front());
+        ExecExited.pop_front();
+    }
+
+    NotifyEvent("exec");
+}
+
+/* Time for tasks to exit after SIGKILL */
+static constexpr uint64_t KILL_SETTLE_MS = 1000;
+
 TError TContainer::Terminate(TScopedLock &holder_lock, uint64_t deadline) {
     auto cg = GetCgroup(FreezerSubsystem);
     TError error;
@@ -1275,27 +2026,26 @@ TError TContainer::Terminate(TScopedLock &holder_lock, uint64_t deadline) {
         if (!error) {
             TScopedUnlock unlock(holder_lock);
             L_ACT() << "Wait task " << Task.Pid << " after SIGTERM in " << GetName() << std::endl;
-            while (Task.Exists() && !Task.IsZombie() &&
-                    !WaitDeadline(deadline));
+            (void)Task.WaitExit(deadline);
         }
-    }
-
-    for (int pass = 0; pass < 3; pass++) {
         if (cg.IsEmpty())
             return TError::Success();
-        error = cg.KillAll(SIGKILL);
-        if (error)
-            return error;
     }
 
-    error = FreezerSubsystem.Freeze(cg);
+    TScopedUnlock unlock(holder_lock);
+
+    error = cg.KillFrozen(SIGKILL);
     if (error)
         return error;
-    error = cg.KillAll(SIGKILL);
-    if (!FreezerSubsystem.Thaw(cg) && !error) {
-        TScopedUnlock unlock(holder_lock);
-        while (!cg.IsEmpty() && !WaitDeadline(deadline));
-    }
+
+    /* without deadline killed tasks are left to exit on their own */
+    if (!deadline)
+        return TError::Success();
+
+    /* SIGKILL is delivered after thaw, SIGTERM grace might be already spent */
+    error = cg.WaitEmpty(std::max(deadline, GetCurrentTimeMs() + KILL_SETTLE_MS));
+    if (error)
+        L_WRN() << "Cannot terminate all tasks in " << GetName() << ": " << error << std::endl;
 
     return error;
 }
@@ -1336,7 +2086,8 @@ TError TContainer::StopOne(TScopedLock &holder_lock, uint64_t deadline) {
     return Save();
 }
 
-TError TContainer::Stop(TScopedLock &holder_lock, uint64_t timeout) {
+TError TContainer::Stop(TScopedLock &holder_lock, uint64_t timeout,
+                        std::vector<TStopResult> *results) {
     uint64_t deadline = timeout ? GetCurrentTimeMs() + timeout : 0;
     auto cg = GetCgroup(FreezerSubsystem);
     TError error;
@@ -1364,16 +2115,99 @@ TError TContainer::Stop(TScopedLock &holder_lock, uint64_t timeout) {
             return error;
     }
 
-    error = ApplyForTreePostorder(holder_lock, [&] (TScopedLock &holder_lock, TContainer &child) {
-        if (child.State != EContainerState::Stopped)
-            return child.StopOne(holder_lock, deadline);
+    /*
+     * Send SIGTERM to every task in subtree at once and wait all of them
+     * on one deadline, then kill survivors in single pass. Containers are
+     * stopped after that one by one without further waiting.
+     */
+    struct TStopTarget {
+        TCgroup Cgroup;
+        TTask Task;
+        bool Killed;
+    };
+    std::vector<TStopTarget> targets;
+
+    auto collect = [&] (TScopedLock &holder_lock, TContainer &ct) {
+        if (ct.State == EContainerState::Stopped || ct.IsRoot())
+            return TError::Success();
+        TStopTarget target = { ct.GetCgroup(FreezerSubsystem), ct.Task, false };
+
+        /* paused child cannot handle SIGTERM, kill it like paused container */
+        if (FreezerSubsystem.IsFrozen(target.Cgroup)) {
+            L_ACT() << "Kill paused " << ct.GetName() << std::endl;
+            TError error = target.Cgroup.KillAll(SIGKILL);
+            if (error)
+                L_WRN() << "Cannot kill paused " << ct.GetName() << ": " << error << std::endl;
+            (void)FreezerSubsystem.Thaw(target.Cgroup, false);
+            target.Task.Pid = 0;
+        } else if (target.Task.Pid && deadline && ct.State != EContainerState::Meta &&
+                !target.Cgroup.IsEmpty()) {
+            L_ACT() << "Terminate " << ct.GetName() << " pid " << ct.Task.Pid << std::endl;
+            if (target.Task.Kill(SIGTERM))
+                target.Task.Pid = 0;
+        } else
+            target.Task.Pid = 0;
+        targets.push_back(target);
+        return TError::Success();
+    };
+
+    (void)ApplyForTreePostorder(holder_lock, collect);
+    (void)collect(holder_lock, *this);
+
+    if (!targets.empty()) {
+        TScopedUnlock unlock(holder_lock);
+        std::vector<TCgroup> survivors;
+
+        for (auto &target: targets)
+            if (target.Task.Pid)
+                (void)target.Task.WaitExit(deadline);
+
+        for (auto &target: targets) {
+            target.Killed = !target.Cgroup.IsEmpty();
+            if (target.Killed && target.Cgroup != cg)
+                survivors.push_back(target.Cgroup);
+        }
+
+        if (!survivors.empty() || !cg.IsEmpty()) {
+            L_ACT() << "Kill " << survivors.size() << " nested cgroups in " << GetName() << std::endl;
+            error = cg.KillFrozen(SIGKILL, survivors);
+            if (error)
+                L_WRN() << "Cannot kill tasks in " << GetName() << ": " << error << std::endl;
+
+            uint64_t killDeadline = GetCurrentTimeMs() +
+                config().daemon().cgroup_remove_timeout_s() * 1000;
+            for (auto &target: targets)
+                if (target.Killed)
+                    (void)target.Cgroup.WaitEmpty(killDeadline);
+        }
+    }
+
+    auto killed = [&] (TContainer &ct) {
+        auto cg = ct.GetCgroup(FreezerSubsystem);
+        for (auto &target: targets)
+            if (target.Cgroup == cg)
+                return target.Killed;
+        return false;
+    };
+
+    TError childError;
+    ApplyForTreePostorder(holder_lock, [&] (TScopedLock &holder_lock, TContainer &child) {
+        if (child.State != EContainerState::Stopped) {
+            TError error = child.StopOne(holder_lock, 0);
+            if (results)
+                results->push_back({ child.GetName(), error, killed(child) });
+            if (error && !childError)
+                childError = error;
+        }
         return TError::Success();
     });
 
-    if (error)
-        return error;
+    if (childError)
+        return childError;
 
-    error = StopOne(holder_lock, deadline);
+    error = StopOne(holder_lock, 0);
+    if (results)
+        results->push_back({ GetName(), error, killed(*this) });
     if (error)
         return error;
 
@@ -1392,6 +2226,13 @@ void TContainer::Reap(TScopedLock &holder_lock, bool oomKilled) {
         L_WRN() << "Cannot terminate container " << GetName() << " : " << error << std::endl;
 
     ShutdownOom();
+    ShutdownMemPressure();
+    ShutdownMemThreshold();
+    ReleaseCpuSet();
+
+    /* keep captured output of dead container */
+    Stdout.StopCapture(false);
+    Stderr.StopCapture(false);
 
     DeathTime = GetCurrentTimeMs();
     SetProp(EProperty::DEATH_TIME);
@@ -1465,10 +2306,17 @@ TError TContainer::Pause(TScopedLock &holder_lock) {
     if (error)
         return error;
 
+    /* freezer is hierarchical: whole subtree freezes with this cgroup */
     auto cg = GetCgroup(FreezerSubsystem);
-    error = FreezerSubsystem.Freeze(cg);
-    if (error)
+    error = FreezerSubsystem.Freeze(cg, false);
+    if (!error) {
+        TScopedUnlock unlock(holder_lock);
+        error = FreezerSubsystem.WaitState(cg, "FROZEN");
+    }
+    if (error) {
+        (void)FreezerSubsystem.Thaw(cg, false);
         return error;
+    }
 
     SetState(EContainerState::Paused);
     ApplyForTreePreorder(holder_lock, [&] (TScopedLock &holder_lock,
@@ -1491,9 +2339,35 @@ TError TContainer::Resume(TScopedLock &holder_lock) {
     if (!FreezerSubsystem.IsSelfFreezing(cg))
         return TError(EError::InvalidState, "Container not paused");
 
-    TError error = FreezerSubsystem.Thaw(cg);
+    /* thaw whole subtree first, then wait all states at once */
+    std::vector<TCgroup> thawed;
+    TError error = FreezerSubsystem.Thaw(cg, false);
     if (error)
         return error;
+    thawed.push_back(cg);
+
+    ApplyForTreePreorder(holder_lock, [&] (TScopedLock &holder_lock,
+                                           TContainer &child) {
+        auto cg = child.GetCgroup(FreezerSubsystem);
+        if (FreezerSubsystem.IsSelfFreezing(cg) && !FreezerSubsystem.Thaw(cg, false))
+            thawed.push_back(cg);
+        return TError::Success();
+    });
+
+    {
+        TScopedUnlock unlock(holder_lock);
+        for (auto &cg: thawed) {
+            error = FreezerSubsystem.WaitState(cg, "THAWED");
+            if (error && &cg == &thawed.front()) {
+                /* children are already thawing: freeze back to match Paused */
+                for (auto &other: thawed)
+                    (void)FreezerSubsystem.Freeze(other, false);
+                return error;
+            }
+            if (error)
+                L_WRN() << "Cannot thaw " << cg.Name << ": " << error << std::endl;
+        }
+    }
 
     if (State == EContainerState::Paused)
         SetState(Command.size() ? EContainerState::Running :
@@ -1501,9 +2375,6 @@ TError TContainer::Resume(TScopedLock &holder_lock) {
 
     ApplyForTreePreorder(holder_lock, [&] (TScopedLock &holder_lock,
                                            TContainer &child) {
-        auto cg = child.GetCgroup(FreezerSubsystem);
-        if (FreezerSubsystem.IsSelfFreezing(cg))
-            FreezerSubsystem.Thaw(cg);
         if (child.State == EContainerState::Paused)
             child.SetState(child.Command.size() ? EContainerState::Running :
                                                   EContainerState::Meta);
@@ -1523,7 +2394,8 @@ void TContainer::ParsePropertyName(std::string &name, std::string &idx) {
     idx = StringTrim(tokens[1], " \t\n]");
 }
 
-TError TContainer::GetProperty(const string &origProperty, string &value) const {
+TError TContainer::GetProperty(const string &origProperty, string &value,
+                               uint64_t maxAgeMs) const {
     std::string property = origProperty;
     auto dot = property.find('.');
     TError error;
@@ -1546,25 +2418,221 @@ TError TContainer::GetProperty(const string &origProperty, string &value) const
     }
 
     std::string idx;
-    ParsePropertyName(property, idx);
+    auto bracket = property.find('[');
+    if (bracket != string::npos)
+        idx = StringTrim(property.substr(bracket + 1), " \t\n]");
+    else
+        bracket = property.size();
 
-    auto it = ContainerProperties.find(property);
-    if (it == ContainerProperties.end())
+    auto prop = PropertyIndex.Find(property.data(), bracket);
+    if (!prop)
         return TError(EError::InvalidProperty,
                               "Unknown container property: " + property);
-    auto prop = it->second;
 
-    if (!prop->IsSupported)
-        return TError(EError::NotSupported, "Not supported: " + property);
+    return GetProperty(*prop, idx, value, maxAgeMs);
+}
+
+TError TContainer::GetProperty(TProperty &prop, const std::string &idx,
+                               std::string &value, uint64_t maxAgeMs) const {
+    if (!prop.IsSupported)
+        return TError(EError::NotSupported, "Not supported: " + prop.Name);
+
+    if (maxAgeMs && prop.SampleIndex >= 0 && idx.empty() && Sample.Time &&
+            Sample.Time + maxAgeMs >= GetCurrentTimeMs()) {
+        Statistics->StatSampleHits++;
+        value = Sample.Values[prop.SampleIndex];
+        return Sample.Errors[prop.SampleIndex];
+    }
 
-    CurrentContainer = const_cast<TContainer *>(this);
+    if (prop.CounterIndex >= 0 && (idx == "rate" || idx == "history" ||
+                StringStartsWith(idx, "rate:") || StringStartsWith(idx, "history:")))
+        return GetCounterHistory(prop, idx, value);
+
+    auto &ct = const_cast<TContainer &>(*this);
     if (idx.length())
-        error = prop->GetIndexed(idx, value);
-    else
-        error = prop->Get(value);
-    CurrentContainer = nullptr;
+        return prop.GetIndexed(ct, idx, value);
+    return prop.Get(ct, value);
+}
 
-    return error;
+void TContainer::SampleStatistics(TScopedLock &holder_lock) {
+    if (State != EContainerState::Running &&
+            State != EContainerState::Meta &&
+            State != EContainerState::Paused) {
+        Sample.Time = 0;
+        return;
+    }
+
+    TScopedUnlock unlock(holder_lock);
+
+    Sample.Values.resize(SampledProperties.size());
+    Sample.Errors.resize(SampledProperties.size());
+
+    Knobs.StartRequest();
+    for (auto prop: SampledProperties) {
+        Sample.Values[prop->SampleIndex].clear();
+        Sample.Errors[prop->SampleIndex] = prop->Get(*this, Sample.Values[prop->SampleIndex]);
+    }
+    Knobs.FinishRequest();
+
+    Sample.Time = GetCurrentTimeMs();
+
+    RecordHistory();
+}
+
+void TContainer::RecordHistory() {
+    size_t size = config().daemon().stat_history_size();
+    if (!size || CounterProperties.empty())
+        return;
+
+    if (History.size() != size) {
+        History.resize(size);
+        HistoryHead = HistoryCount = 0;
+    }
+
+    auto &sample = History[HistoryHead];
+    sample.Time = Sample.Time;
+    sample.Values.resize(CounterProperties.size());
+    sample.Valid.resize(CounterProperties.size());
+
+    for (auto prop: CounterProperties) {
+        auto &map = sample.Values[prop->CounterIndex];
+        auto &str = Sample.Values[prop->SampleIndex];
+        uint64_t val;
+        TError error = Sample.Errors[prop->SampleIndex];
+
+        map.clear();
+        if (!error) {
+            if (!StringToUint64(str, val))
+                map[""] = val;
+            else
+                error = StringToUintMap(str, map);
+        }
+        sample.Valid[prop->CounterIndex] = !error;
+    }
+
+    HistoryHead = (HistoryHead + 1) % size;
+    if (HistoryCount < size)
+        HistoryCount++;
+}
+
+/* 10s, 500ms, 5m, 1h, unit is required: plain number could be key */
+static TError ParseHistoryPeriod(const std::string &str, uint64_t &ms) {
+    static const std::vector<std::pair<std::string, uint64_t>> units = {
+        { "ms", 1 }, { "s", 1000 }, { "m", 60000 }, { "h", 3600000 },
+    };
+
+    for (auto &unit: units) {
+        if (!StringEndsWith(str, unit.first))
+            continue;
+        std::string num = str.substr(0, str.size() - unit.first.size());
+        if (num.empty() || !StringOnlyDigits(num))
+            continue;
+        TError error = StringToUint64(num, ms);
+        if (!error)
+            ms *= unit.second;
+        return error;
+    }
+
+    return TError(EError::InvalidValue, "Invalid period: " + str);
+}
+
+/*
+ * rate[:period][:key]      - per-second increase over period
+ * history[:period][:key]   - samples as "<age ms>: <value>; ..."
+ *
+ * Period is whole history by default, key selects element of map counter.
+ */
+TError TContainer::GetCounterHistory(const TProperty &prop, const std::string &idx,
+                                     std::string &value) const {
+    std::vector<std::string> tokens;
+    uint64_t period = UINT64_MAX;
+    std::string key;
+    TError error;
+
+    error = SplitString(idx, ':', tokens, 3);
+    if (error)
+        return error;
+
+    if (tokens.size() > 1 && ParseHistoryPeriod(tokens[1], period)) {
+        if (tokens.size() > 2)
+            return TError(EError::InvalidValue, "Invalid period: " + tokens[1]);
+        key = tokens[1];
+    } else if (tokens.size() > 2) {
+        key = tokens[2];
+    }
+
+    if (!config().daemon().stat_sample_interval_ms())
+        return TError(EError::NotSupported, "Statistics sampler is disabled");
+
+    size_t size = History.size();
+    size_t index = prop.CounterIndex;
+
+    /* collect valid samples within period, oldest first */
+    std::vector<const TCounterSample *> samples;
+    for (size_t i = 0; i < HistoryCount; i++) {
+        auto &sample = History[(HistoryHead + size - HistoryCount + i) % size];
+        if (sample.Valid[index])
+            samples.push_back(&sample);
+    }
+
+    if (!samples.empty()) {
+        uint64_t newest = samples.back()->Time;
+        auto first = samples.begin();
+        while (newest - (*first)->Time > period)
+            first++;
+        samples.erase(samples.begin(), first);
+    }
+
+    bool scalar = samples.empty() || samples.back()->Values[index].count("");
+
+    if (!samples.empty() && scalar && !key.empty())
+        return TError(EError::InvalidValue, prop.Name + " has no keys, period requires unit: " + key);
+
+    if (tokens[0] == "history") {
+        auto now = GetCurrentTimeMs();
+
+        if (!scalar && key.empty())
+            return TError(EError::InvalidValue, "Key required for history of " + prop.Name);
+
+        value.clear();
+        for (auto sample: samples) {
+            auto &map = sample->Values[index];
+            auto it = map.find(scalar ? "" : key);
+            if (it == map.end())
+                continue;
+            if (value.size())
+                value += "; ";
+            value += std::to_string(now - sample->Time) + ": " + std::to_string(it->second);
+        }
+        return TError::Success();
+    }
+
+    if (samples.size() < 2 || samples.front()->Time == samples.back()->Time)
+        return TError(EError::InvalidState, "Not enough samples for rate of " + prop.Name);
+
+    auto &from = *samples.front();
+    auto &to = *samples.back();
+    uint64_t ms = to.Time - from.Time;
+    TUintMap rate;
+
+    for (auto &kv: to.Values[index]) {
+        auto it = from.Values[index].find(kv.first);
+        if (it == from.Values[index].end() || (!key.empty() && kv.first != key))
+            continue;
+        rate[kv.first] = kv.second > it->second ?
+                         (kv.second - it->second) * 1000 / ms : 0;
+    }
+
+    if (rate.count(""))
+        value = std::to_string(rate[""]);
+    else if (!key.empty()) {
+        if (!rate.count(key))
+            return TError(EError::InvalidValue, "Invalid key: " + key);
+        value = std::to_string(rate[key]);
+    } else
+        return UintMapToString(rate, value);
+
+    return TError::Success();
 }
 
 TError TContainer::SetProperty(const string &origProperty,
@@ -1578,24 +2646,21 @@ TError TContainer::SetProperty(const string &origProperty,
     std::string value = StringTrim(origValue);
     TError error;
 
-    auto it = ContainerProperties.find(property);
-    if (it == ContainerProperties.end())
+    auto prop = PropertyIndex.Find(property);
+    if (!prop)
         return TError(EError::Unknown, "Invalid property " + property);
-    auto prop = it->second;
 
     if (!prop->IsSupported)
         return TError(EError::NotSupported, property + " is not supported");
 
-    CurrentContainer = this;
-
     std::string oldValue;
-    error = prop->Get(oldValue);
+    error = prop->Get(*this, oldValue);
 
     if (!error) {
         if (idx.length())
-            error = prop->SetIndexed(idx, value);
+            error = prop->SetIndexed(*this, idx, value);
         else
-            error = prop->Set(value);
+            error = prop->Set(*this, value);
     }
 
     if (!error && (State == EContainerState::Running ||
@@ -1603,13 +2668,11 @@ TError TContainer::SetProperty(const string &origProperty,
                    State == EContainerState::Paused)) {
         error = ApplyDynamicProperties();
         if (error) {
-            (void)prop->Set(oldValue);
+            (void)prop->Set(*this, oldValue);
             (void)TestClearPropDirty(prop->Prop);
         }
     }
 
-    CurrentContainer = nullptr;
-
     if (!error)
         error = Save();
 
@@ -1658,8 +2721,6 @@ TError TContainer::Save(void) {
     node.Set(P_RAW_ID, std::to_string(Id));
     node.Set(P_RAW_NAME, GetName());
 
-    CurrentContainer = this;
-
     for (auto knob : ContainerProperties) {
         std::string value;
 
@@ -1667,15 +2728,13 @@ TError TContainer::Save(void) {
         if (knob.second->Prop == EProperty::NONE || !HasProp(knob.second->Prop))
             continue;
 
-        error = knob.second->GetToSave(value);
+        error = knob.second->GetToSave(*this, value);
         if (error)
             break;
 
         node.Set(knob.first, value);
     }
 
-    CurrentContainer = nullptr;
-
     if (error)
         return error;
 
@@ -1686,8 +2745,6 @@ TError TContainer::Load(const TKeyValue &node) {
     std::string container_state;
     TError error;
 
-    CurrentContainer = this;
-
     for (auto &kv: node.Data) {
         std::string key = kv.first;
         std::string value = kv.second;
@@ -1704,14 +2761,13 @@ TError TContainer::Load(const TKeyValue &node) {
         if (key == P_RAW_ID || key == P_RAW_NAME)
             continue;
 
-        auto it = ContainerProperties.find(key);
-        if (it == ContainerProperties.end()) {
+        auto prop = PropertyIndex.Find(key);
+        if (!prop) {
             L_WRN() << "Unknown property: " << key << ", skipped" << std::endl;
             continue;
         }
-        auto prop = it->second;
 
-        error = prop->SetFromRestore(value);
+        error = prop->SetFromRestore(*this, value);
         if (error) {
             L_ERR() << "Cannot load " << key << ", skipped" << std::endl;
             continue;
@@ -1721,13 +2777,11 @@ TError TContainer::Load(const TKeyValue &node) {
     }
 
     if (container_state.size()) {
-        error = ContainerProperties[D_STATE]->SetFromRestore(container_state);
+        error = ContainerProperties[D_STATE]->SetFromRestore(*this, container_state);
         SetProp(EProperty::STATE);
     } else
         error = TError(EError::Unknown, "Container has no state");
 
-    CurrentContainer = nullptr;
-
     return error;
 }
 
@@ -1813,6 +2867,9 @@ TError TContainer::Restore(TScopedLock &holder_lock, const TKeyValue &node) {
             L_WRN() << "Cannot restore network: " << error << std::endl;
             goto out;
         }
+
+        /* captured output is lost, fifo is reopened */
+        (void)PrepareStreams(true);
     }
 
     if (MayRespawn())
@@ -1953,6 +3010,15 @@ void TContainer::DeliverEvent(TScopedLock &holder_lock, const TEvent &event) {
         case EEventType::OOM:
             Exit(holder_lock, SIGKILL, true);
             break;
+        case EEventType::MemPressure:
+            DeliverMemPressure(event.MemPressure.Fd);
+            break;
+        case EEventType::MemThreshold:
+            DeliverMemThreshold(event.MemThreshold.Fd);
+            break;
+        case EEventType::StreamData:
+            DeliverStream(event.StreamData.Fd);
+            break;
         default:
             break;
     }
@@ -1981,6 +3047,18 @@ void TContainer::NotifyWaiters() {
         TContainerWaiter::WakeupWildcard(this);
 }
 
+/* Wakes only waiters subscribed for this event */
+void TContainer::NotifyEvent(const std::string &event) {
+    CleanupWaiters();
+    for (auto &w : Waiters) {
+        auto waiter = w.lock();
+        if (waiter)
+            waiter->WakeupWaiter(this, false, event);
+    }
+    if (!IsRoot() && !IsPortoRoot())
+        TContainerWaiter::WakeupWildcard(this, event);
+}
+
 void TContainer::CleanupWaiters() {
     for (auto iter = Waiters.begin(); iter != Waiters.end();) {
         if (iter->expired()) {
@@ -2032,12 +3110,15 @@ TError TContainer::UpdateTrafficClasses() {
 }
 
 TContainerWaiter::TContainerWaiter(std::shared_ptr<TClient> client,
-                                   std::function<void (std::shared_ptr<TClient>,
-                                                       TError, std::string)> callback) :
+                                   std::function<void (std::shared_ptr<TClient>, TError,
+                                                       std::string, std::string)> callback) :
     Client(client), Callback(callback) {
 }
 
-void TContainerWaiter::WakeupWaiter(const TContainer *who, bool wildcard) {
+void TContainerWaiter::WakeupWaiter(const TContainer *who, bool wildcard,
+                                    const std::string &event) {
+    if (!event.empty() && std::find(Events.begin(), Events.end(), event) == Events.end())
+        return;
     std::shared_ptr<TClient> client = Client.lock();
     if (client) {
         std::string name;
@@ -2046,7 +3127,7 @@ void TContainerWaiter::WakeupWaiter(const TContainer *who, bool wildcard) {
             err = client->ComposeRelativeName(who->GetName(), name);
         if (wildcard && (err || !MatchWildcard(name)))
             return;
-        Callback(client, err, name);
+        Callback(client, err, name, event);
         Client.reset();
         client->Waiter = nullptr;
     }
@@ -2055,12 +3136,12 @@ void TContainerWaiter::WakeupWaiter(const TContainer *who, bool wildcard) {
 std::mutex TContainerWaiter::WildcardLock;
 std::list<std::weak_ptr<TContainerWaiter>> TContainerWaiter::WildcardWaiters;
 
-void TContainerWaiter::WakeupWildcard(const TContainer *who) {
+void TContainerWaiter::WakeupWildcard(const TContainer *who, const std::string &event) {
     WildcardLock.lock();
     for (auto &w : WildcardWaiters) {
         auto waiter = w.lock();
         if (waiter)
-            waiter->WakeupWaiter(who, true);
+            waiter->WakeupWaiter(who, true, event);
     }
     WildcardLock.unlock();
 }
@@ -4,6 +4,10 @@
 #include <vector>
 #include <list>
 #include <memory>
+#include <unordered_map>
+#include <map>
+#include <atomic>
+#include <functional>
 
 #include "util/unix.hpp"
 #include "util/locks.hpp"
@@ -24,6 +28,7 @@ class TNetwork;
 class TNamespaceFd;
 class TNlLink;
 class TContainerWaiter;
+class TStreamWatch;
 class TClient;
 class TVolume;
 class TKeyValue;
@@ -42,6 +47,56 @@ enum class EContainerState {
 
 class TProperty;
 
+/* Statistics refreshed by TStatSampler, indexed by TProperty::SampleIndex */
+struct TStatSample {
+    uint64_t Time = 0;
+    std::vector<std::string> Values;
+    std::vector<TError> Errors;
+};
+
+/* Memory pressure notification registered in epoll loop */
+struct TMemPressure {
+    std::string Level;
+    TFile Event;
+    std::shared_ptr<TEpollSource> Source;
+};
+
+/* Outcome of start for each container in subtree */
+struct TStartResult {
+    std::string Name;
+    TError Error;
+};
+
+class TContainer;
+
+/* Container in recursive start plan, see TContainer::PlanSubtree() */
+struct TStartNode {
+    std::shared_ptr<TContainer> Container;
+    bool Meta;
+    int Pending;            /* -1 if failed by dependency */
+    std::vector<size_t> Next;
+};
+
+/* Outcome of stop for each container in subtree */
+struct TStopResult {
+    std::string Name;
+    TError Error;
+    bool Killed;            /* tasks survived SIGTERM */
+};
+
+/* Process started by exec request inside running container */
+struct TExecTask {
+    pid_t VPid = 0;
+    std::function<void (const TError &, int)> Reply;    /* client waits exit */
+};
+
+/* Counters parsed from sample, indexed by TProperty::CounterIndex */
+struct TCounterSample {
+    uint64_t Time = 0;
+    std::vector<TUintMap> Values;   /* scalar counter is stored with key "" */
+    std::vector<bool> Valid;
+};
+
 class TContainer : public std::enable_shared_from_this<TContainer>,
                    public TNonCopyable,
                    public TLockable {
@@ -52,7 +107,10 @@ class TContainer : public std::enable_shared_from_this<TContainer>,
     int Acquired = 0;
     int Id;
     TFile OomEvent;
-    size_t RunningChildren = 0; // changed under holder lock
+    std::list<TMemPressure> MemPressure;
+    TFile MemThresholdEvent;
+    std::shared_ptr<TEpollSource> MemThresholdSource;
+    std::atomic<size_t> RunningChildren{0}; // siblings are started in parallel
     std::list<std::weak_ptr<TContainerWaiter>> Waiters;
 
     std::shared_ptr<TEpollSource> Source;
@@ -68,13 +126,23 @@ class TContainer : public std::enable_shared_from_this<TContainer>,
     TError RestoreNetwork();
     TError PrepareOomMonitor();
     void ShutdownOom();
+    void PrepareMemPressure();
+    void ShutdownMemPressure();
+    void DeliverMemPressure(int fd);
+    TError ApplyCpuSet();
+    void ReleaseCpuSet();
+    TError PrepareMemThreshold();
+    void ShutdownMemThreshold();
+    void DeliverMemThreshold(int fd);
+    TError PrepareStreams(bool restore);
+    void DeliverStream(int fd);
     TError PrepareCgroups();
     TError ConfigureDevices(std::vector<TDevice> &devices);
     TError ParseNetConfig(struct TNetCfg &NetCfg);
     TError PrepareNetwork(struct TNetCfg &NetCfg);
+    TError GetTaskCred(TCred &cred) const;
     TError PrepareTask(struct TTaskEnv *TaskEnv,
                        struct TNetCfg *NetCfg);
-    void RemoveKvs();
 
     const std::string StripParentName(const std::string &name) const;
     void ScheduleRespawn();
@@ -88,6 +156,7 @@ class TContainer : public std::enable_shared_from_this<TContainer>,
 
     void CleanupWaiters();
     void NotifyWaiters();
+    void NotifyEvent(const std::string &event);
 
     // fn called for parent first then for all children (from top container to the leafs)
     TError ApplyForTreePreorder(TScopedLock &holder_lock,
@@ -100,12 +169,19 @@ class TContainer : public std::enable_shared_from_this<TContainer>,
 
 public:
     const std::shared_ptr<TContainer> Parent;
+    bool Dying = false;         /* waits for teardown, changed under holder lock */
+    int DyingChildren = 0;
+    bool Unlinked = false;      /* id released, changed under holder lock */
     bool PropSet[(int)EProperty::NR_PROPERTIES];
     bool PropDirty[(int)EProperty::NR_PROPERTIES];
     TCred OwnerCred;
     std::string Command;
     std::string Cwd;
     TStdStream Stdin, Stdout, Stderr;
+    TCgroupKnobs Knobs;         /* cached statistics knobs */
+    TStatSample Sample;
+    std::vector<TCounterSample> History;    /* ring buffer */
+    size_t HistoryHead = 0, HistoryCount = 0;
     std::string Root;
     bool RootRo;
     mode_t Umask;
@@ -136,6 +212,13 @@ public:
     uint64_t NewMemGuarantee = 0;
     uint64_t AnonMemLimit = 0;
     uint64_t DirtyMemLimit = 0;
+    std::vector<uint64_t> MemThresholds;
+    uint64_t MemThresholdUsage = 0;     /* usage at last notification */
+    TUintMap MemPressureCount;          /* events since start per level */
+    TUintMap StartProfile;              /* last start: phase -> microseconds */
+    std::map<pid_t, TExecTask> ExecTasks;
+    TUintMap ExecStatus;                /* exited exec: pid -> exit status */
+    std::list<std::string> ExecExited;  /* ExecStatus keys, oldest first */
 
     bool RechargeOnPgfault = false;
 
@@ -146,6 +229,9 @@ public:
     std::string CpuPolicy;
     double CpuLimit;
     double CpuGuarantee;
+    std::string CpuSet;             /* "" - parent, "auto", "node N" or list */
+    int CpuSetNode = -1;            /* numa node where guarantee is reserved */
+    double CpuSetReserved = 0;
 
     TUintMap NetGuarantee;
     TUintMap NetLimit;
@@ -242,10 +328,17 @@ public:
     void AddChild(std::shared_ptr<TContainer> child);
     TError Create(const TCred &cred);
     void Destroy(void);
+    void RemoveKvs();
     void DestroyWeak();
     TError Start(bool meta);
     TError StopOne(TScopedLock &holder_lock, uint64_t deadline);
-    TError Stop(TScopedLock &holder_lock, uint64_t timeout);
+    TError Stop(TScopedLock &holder_lock, uint64_t timeout,
+                std::vector<TStopResult> *results = nullptr);
+    TError PlanSubtree(TScopedLock &holder_lock,
+                       const std::map<std::string, std::vector<std::string>> &after,
+                       std::vector<TStartNode> &nodes);
+    TError StartSubtree(TScopedLock &holder_lock, std::vector<TStartNode> &nodes,
+                        std::vector<TStartResult> &results);
     TError CheckAcquiredChild(TScopedLock &holder_lock);
 
     TError Pause(TScopedLock &holder_lock);
@@ -253,8 +346,19 @@ public:
 
     TError Terminate(TScopedLock &holder_lock, uint64_t deadline);
     TError Kill(int sig);
-
-    TError GetProperty(const std::string &property, std::string &value) const;
+    TError Exec(const std::string &command, const std::string &env,
+                const std::string &cwd, const std::string stdPath[3],
+                pid_t &pid, pid_t &vpid);
+    void ExecExit(pid_t pid, int status);
+
+    TError GetProperty(const std::string &property, std::string &value,
+                       uint64_t maxAgeMs = 0) const;
+    TError GetProperty(TProperty &prop, const std::string &idx, std::string &value,
+                       uint64_t maxAgeMs = 0) const;
+    void SampleStatistics(TScopedLock &holder_lock);
+    void RecordHistory();
+    TError GetCounterHistory(const TProperty &prop, const std::string &idx,
+                             std::string &value) const;
     TError SetProperty(const std::string &property, const std::string &value);
 
     TError Restore(TScopedLock &holder_lock, const TKeyValue &node);
@@ -266,6 +370,12 @@ public:
     TCgroup GetCgroup(const TSubsystem &subsystem) const;
     bool CanRemoveDead() const;
     std::vector<std::string> GetChildren();
+
+    template <typename F> void ForEachChild(F fn) const {
+        for (auto &weakChild : Children)
+            if (auto child = weakChild.lock())
+                fn(child);
+    }
     std::shared_ptr<TContainer> FindRunningParent() const;
     void DeliverEvent(TScopedLock &holder_lock, const TEvent &event);
 
@@ -274,6 +384,14 @@ public:
 
     void AddWaiter(std::shared_ptr<TContainerWaiter> waiter);
 
+    /*
+     * Followers of file stream are woken by inotify, captured - by drain.
+     * Watch lives while follower holds handle or until container destroy.
+     */
+    TError WatchStream(const TStdStream &stream, std::shared_ptr<TStreamWatch> &watch);
+    void ForgetStreamWatches();
+    static void DeliverStreamNotify(TScopedLock &holder_lock);
+
     void CleanupExpiredChildren();
     TError UpdateTrafficClasses();
 
@@ -309,25 +427,38 @@ public:
     bool IsAcquired() { return Acquired; }
 };
 
+/* Follower's reference to inotify watch of stream file */
+class TStreamWatch : public TNonCopyable {
+    int Wd;
+    uint64_t Serial;
+public:
+    TStreamWatch(int wd, uint64_t serial) : Wd(wd), Serial(serial) {}
+    ~TStreamWatch();
+};
+
 class TContainerWaiter {
 private:
     static std::mutex WildcardLock;
     static std::list<std::weak_ptr<TContainerWaiter>> WildcardWaiters;
     std::weak_ptr<TClient> Client;
-    std::function<void (std::shared_ptr<TClient>, TError, std::string)> Callback;
+    std::function<void (std::shared_ptr<TClient>, TError, std::string, std::string)> Callback;
 public:
     TContainerWaiter(std::shared_ptr<TClient> client,
-                     std::function<void (std::shared_ptr<TClient>, TError, std::string)> callback);
-    void WakeupWaiter(const TContainer *who, bool wildcard = false);
-    static void WakeupWildcard(const TContainer *who);
+                     std::function<void (std::shared_ptr<TClient>, TError,
+                                         std::string, std::string)> callback);
+    void WakeupWaiter(const TContainer *who, bool wildcard = false,
+                      const std::string &event = "");
+    static void WakeupWildcard(const TContainer *who, const std::string &event = "");
     static void AddWildcard(std::shared_ptr<TContainerWaiter> &waiter);
 
     std::vector<std::string> Wildcards;
+    std::vector<std::string> Events;    /* also wakeup at these events */
     bool MatchWildcard(const std::string &name);
 };
 
 extern std::mutex ContainersMutex;
-extern std::map<std::string, std::shared_ptr<TContainer>> Containers;
+extern std::unordered_map<std::string, std::shared_ptr<TContainer>> Containers;
+extern std::map<pid_t, std::weak_ptr<TContainer>> ExecPids;   /* exec pid -> container */
 extern TPath ContainersKV;
 
 static inline std::unique_lock<std::mutex> LockContainers() {
@@ -4,6 +4,7 @@
 #include "cgroup.hpp"
 #include "event.hpp"
 #include "holder.hpp"
+#include "sampler.hpp"
 #include "volume.hpp"
 #include "client.hpp"
 #include "container.hpp"
@@ -15,6 +16,7 @@ TContext::TContext() {
     Cholder = std::make_shared<TContainerHolder>(EpollLoop);
     Queue = std::make_shared<TEventQueue>(Cholder);
     Cholder->Queue = Queue;
+    Sampler = std::make_shared<TStatSampler>(Cholder);
 }
 
 TError TContext::Initialize() {
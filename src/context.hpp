@@ -9,12 +9,14 @@ class TCgroup;
 class TSubsystem;
 class TEventQueue;
 class TContainerHolder;
+class TStatSampler;
 
 class TContext : public TNonCopyable {
 public:
     std::shared_ptr<TEventQueue> Queue;
     std::shared_ptr<TContainerHolder> Cholder;
     std::shared_ptr<TEpollLoop> EpollLoop;
+    std::shared_ptr<TStatSampler> Sampler;
 
     TContext();
     TError Initialize();
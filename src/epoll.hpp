@@ -7,6 +7,10 @@
 #include "util/locks.hpp"
 
 constexpr int EPOLL_EVENT_OOM = 1;
+constexpr int EPOLL_EVENT_MEM_PRESSURE = 2;
+constexpr int EPOLL_EVENT_MEM_THRESHOLD = 8;
+constexpr int EPOLL_EVENT_STREAM = 16;
+constexpr int EPOLL_EVENT_STREAM_NOTIFY = 32;
 
 class TContainer;
 class TEpollLoop;
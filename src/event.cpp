@@ -61,6 +61,14 @@ std::string TEvent::GetMsg() const {
             return "update network";
         case EEventType::DestroyWeak:
             return "destroy weak";
+        case EEventType::MemPressure:
+            return "memory pressure with fd " + std::to_string(MemPressure.Fd);
+        case EEventType::MemThreshold:
+            return "memory threshold with fd " + std::to_string(MemThreshold.Fd);
+        case EEventType::StreamData:
+            return "stream data with fd " + std::to_string(StreamData.Fd);
+        case EEventType::StreamNotify:
+            return "stream notify";
         default:
             return "unknown event";
     }
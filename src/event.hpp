@@ -17,6 +17,10 @@ enum class EEventType {
     WaitTimeout,
     UpdateNetwork,
     DestroyWeak,
+    MemPressure,
+    MemThreshold,
+    StreamData,
+    StreamNotify,
 };
 
 class TEventWorker;
@@ -35,6 +39,18 @@ public:
         int Fd;
     } OOM;
 
+    struct {
+        int Fd;
+    } MemPressure;
+
+    struct {
+        int Fd;
+    } MemThreshold;
+
+    struct {
+        int Fd;
+    } StreamData;
+
     struct {
         std::weak_ptr<TContainerWaiter> Waiter;
     } WaitTimeout;
@@ -73,6 +73,14 @@ TError TContainerHolder::CreatePortoRoot(TScopedLock &holder_lock) {
     Statistics->RemoveDead = 0;
     Statistics->Rotated = 0;
     Statistics->Started = 0;
+    Statistics->TeardownQueued = 0;
+    Statistics->SpawnerStarts = 0;
+    Statistics->WarmCgroupHits = 0;
+    Statistics->WarmCgroupMisses = 0;
+    Statistics->WarmNetnsHits = 0;
+    Statistics->WarmNetnsMisses = 0;
+    Statistics->ExecStarts = 0;
+    Statistics->LogLinesLost = 0;
 
     return TError::Success();
 }
@@ -126,24 +134,17 @@ TError TContainerHolder::ValidName(const std::string &name) const {
 }
 
 std::shared_ptr<TContainer> TContainerHolder::GetParent(const std::string &name) const {
-    std::shared_ptr<TContainer> parent;
-
     if (name == ROOT_CONTAINER)
         return nullptr;
-    else if (name == PORTO_ROOT_CONTAINER)
-        return Containers.at(ROOT_CONTAINER);
 
     std::string::size_type n = name.rfind('/');
-    if (n == std::string::npos) {
-        return Containers.at(PORTO_ROOT_CONTAINER);
-    } else {
-        std::string parentName = name.substr(0, n);
-
-        if (Containers.find(parentName) == Containers.end())
-            return nullptr;
+    auto it = Containers.find(name == PORTO_ROOT_CONTAINER ? ROOT_CONTAINER :
+                              n == std::string::npos ? PORTO_ROOT_CONTAINER :
+                              name.substr(0, n));
+    if (it == Containers.end())
+        return nullptr;
 
-        return Containers.at(parentName);
-    }
+    return it->second;
 }
 
 TError TContainerHolder::Create(TScopedLock &holder_lock, const std::string &name, std::shared_ptr<TContainer> &container) {
@@ -153,8 +154,12 @@ TError TContainerHolder::Create(TScopedLock &holder_lock, const std::string &nam
     if (error)
         return error;
 
-    if (Containers.find(name) != Containers.end())
+    auto it = Containers.find(name);
+    if (it != Containers.end()) {
+        if (it->second->Dying)
+            return TError(EError::Busy, "container " + name + " is being destroyed");
         return TError(EError::ContainerAlreadyExists, "container " + name + " already exists");
+    }
 
     if (Containers.size() + 1 > config().container().max_total())
         return TError(EError::ResourceNotAvailable, "number of created containers exceeds limit");
@@ -182,7 +187,7 @@ TError TContainerHolder::Create(TScopedLock &holder_lock, const std::string &nam
     if (error)
         return error;
 
-    Containers[name] = c;
+    Containers.emplace(name, c);
     Statistics->Created++;
 
     if (parent)
@@ -223,6 +228,9 @@ TError TContainerHolder::GetLocked(TScopedLock &holder_lock,
     if (!c->IsValid())
         return TError(EError::ContainerDoesNotExist, "container doesn't exist");
 
+    if (client && client == CurrentClient)
+        CurrentClient->RequestContainerId = c->GetId();
+
     // check permissions
     if (CurrentClient && checkPerm) {
         error = CurrentClient->CanControl(*c);
@@ -264,33 +272,174 @@ TError TContainerHolder::Destroy(TScopedLock &holder_lock, std::shared_ptr<TCont
     return TError::Success();
 }
 
-void TContainerHolder::Unlink(TScopedLock &holder_lock, std::shared_ptr<TContainer> c) {
-    for (auto name: c->GetChildren()) {
-        std::shared_ptr<TContainer> child;
-        if (TContainer::Find(name, child))
-            continue;
+/*
+ * Logical phase of destroy: subtree becomes invisible and stays acquired,
+ * teardown workers stop and unlink containers starting from leaves.
+ */
+TError TContainerHolder::DestroyDeferred(TScopedLock &holder_lock, std::shared_ptr<TContainer> c) {
+    if (c->Dying || c->Unlinked)
+        return TError::Success();
+
+    if (!TeardownRunning)
+        return Destroy(holder_lock, c);
+
+    /* children scheduled earlier are waited too, they report to parent */
+    std::function<void(std::shared_ptr<TContainer>)> mark =
+            [&] (std::shared_ptr<TContainer> ct) {
+        ct->Dying = true;
+        /* Dying isn't saved: don't restore container after restart */
+        ct->RemoveKvs();
+        ct->DyingChildren = 0;
+        ct->ForEachChild([&](std::shared_ptr<TContainer> &child) {
+            if (Containers.count(child->GetName()) && !child->Unlinked) {
+                ct->DyingChildren++;
+                if (!child->Dying)
+                    mark(child);
+            }
+        });
+        if (!ct->DyingChildren)
+            TeardownQueue.push_back(ct);
+        Statistics->TeardownQueued++;
+    };
 
-        Unlink(holder_lock, child);
+    L_ACT() << "Schedule destroy " << c->GetName() << std::endl;
+
+    c->AcquireForced();
+    mark(c);
+    TeardownCv.notify_all();
+
+    return TError::Success();
+}
+
+/* Physical phase of destroy for one container without children */
+void TContainerHolder::Teardown(TScopedLock &holder_lock, std::shared_ptr<TContainer> c) {
+    auto parent = c->GetParent();
+    TError error;
+
+    /* already unlinked together with parent by synchronous destroy */
+    if (!c->Unlinked) {
+        TNestedScopedLock lock(*c, holder_lock);
+
+        /* Stop drops holder lock while it kills and waits tasks */
+        if (c->GetState() != EContainerState::Stopped) {
+            error = c->Stop(holder_lock, 0);
+            if (error)
+                L_ERR() << "Cannot stop " << c->GetName() << " : " << error << std::endl;
+        }
+
+        /* Container is hidden by Dying, children are already gone */
+        c->Unlinked = true;
+        {
+            TScopedUnlock unlock(holder_lock);
+            c->Destroy();
+        }
+        Forget(c);
     }
 
+    Statistics->TeardownQueued--;
+    TeardownCv.notify_all();
+
+    if (parent && parent->Dying) {
+        if (!--parent->DyingChildren)
+            TeardownQueue.push_back(parent);
+    } else if (parent) {
+        TNestedScopedLock lock(*parent, holder_lock);
+        parent->CleanupExpiredChildren();
+    }
+}
+
+void TContainerHolder::TeardownWorker() {
+    SetProcessName("portod-teardown");
+
+    auto holder_lock = LockContainers();
+    while (1) {
+        while (TeardownQueue.empty() && TeardownRunning)
+            TeardownCv.wait(holder_lock);
+
+        if (TeardownQueue.empty())
+            break;
+
+        auto c = TeardownQueue.front();
+        TeardownQueue.pop_front();
+        Teardown(holder_lock, c);
+    }
+}
+
+/* Name of destroyed container becomes free after teardown */
+void TContainerHolder::WaitTeardown(TScopedLock &holder_lock, const std::string &name) {
+    while (1) {
+        auto it = Containers.find(name);
+        if (it == Containers.end() || !it->second->Dying)
+            break;
+        TeardownCv.wait(holder_lock);
+    }
+}
+
+void TContainerHolder::StartTeardown() {
+    int workers = config().daemon().teardown_workers();
+
+    auto holder_lock = LockContainers();
+    if (TeardownRunning || !workers)
+        return;
+
+    TeardownRunning = true;
+    for (int i = 0; i < workers; i++)
+        TeardownThreads.emplace_back(&TContainerHolder::TeardownWorker, this);
+}
+
+/* Pending destroys are finished before return */
+void TContainerHolder::StopTeardown() {
+    auto holder_lock = LockContainers();
+    TeardownRunning = false;
+    TeardownCv.notify_all();
+    holder_lock.unlock();
+
+    for (auto &thread: TeardownThreads)
+        thread.join();
+    TeardownThreads.clear();
+}
+
+/* Container is unlinked only once, teardown may find it already gone */
+void TContainerHolder::Unlink(TScopedLock &holder_lock, std::shared_ptr<TContainer> c) {
+    if (c->Unlinked)
+        return;
+    c->Unlinked = true;
+
+    c->ForEachChild([&](std::shared_ptr<TContainer> &child) {
+        if (Containers.count(child->GetName()))
+            Unlink(holder_lock, child);
+    });
+
     c->Destroy();
+    Forget(c);
+}
 
+/* Id and name become free for new containers */
+void TContainerHolder::Forget(std::shared_ptr<TContainer> c) {
     TError error = IdMap.Put(c->GetId());
     PORTO_ASSERT(!error);
     Containers.erase(c->GetName());
     Statistics->Created--;
 }
 
+/* Returns snapshot ordered by level: parents always go before children */
 std::vector<std::shared_ptr<TContainer> > TContainerHolder::List(bool all) const {
     std::vector<std::shared_ptr<TContainer> > ret;
 
-    for (auto c : Containers) {
+    ret.reserve(Containers.size());
+    for (auto &c : Containers) {
         PORTO_ASSERT(c.first == c.second->GetName());
         if (!all && c.second->IsPortoRoot())
             continue;
         ret.push_back(c.second);
     }
 
+    std::stable_sort(ret.begin(), ret.end(),
+            [](const std::shared_ptr<TContainer> &a,
+               const std::shared_ptr<TContainer> &b) {
+                return a->GetLevel() < b->GetLevel();
+            });
+
     return ret;
 }
 
@@ -360,7 +509,7 @@ TError TContainerHolder::Restore(TScopedLock &holder_lock, TKeyValue &node) {
         return error;
     }
 
-    Containers[node.Name] = c;
+    Containers.emplace(node.Name, c);
     Statistics->Created++;
     return TError::Success();
 }
@@ -404,6 +553,21 @@ void TContainerHolder::RemoveLeftovers() {
     }
 }
 
+void TContainerHolder::SampleStatistics() {
+    auto holder_lock = LockContainers();
+
+    for (auto &target : List()) {
+        if (target->IsAcquired())
+            continue;
+
+        TNestedScopedLock lock(*target, holder_lock);
+        if (target->IsValid() && !target->IsAcquired())
+            target->SampleStatistics(holder_lock);
+    }
+
+    Statistics->StatSamples++;
+}
+
 void TContainerHolder::ScheduleLogRotatation() {
     TEvent e(EEventType::RotateLogs);
     Queue->Add(config().daemon().rotate_logs_timeout_s() * 1000, e);
@@ -439,6 +603,23 @@ bool TContainerHolder::DeliverEvent(const TEvent &event) {
         }
         break;
     }
+    case EEventType::MemPressure:
+    case EEventType::MemThreshold:
+    case EEventType::StreamData:
+    {
+        std::shared_ptr<TContainer> target = event.Container.lock();
+        if (target) {
+            TNestedScopedLock lock(*target, holder_lock);
+            if (target->IsValid())
+                target->DeliverEvent(holder_lock, event);
+        }
+        delivered = true;
+        break;
+    }
+    case EEventType::StreamNotify:
+        TContainer::DeliverStreamNotify(holder_lock);
+        delivered = true;
+        break;
     case EEventType::Respawn:
     {
         std::shared_ptr<TContainer> target = event.Container.lock();
@@ -458,21 +639,35 @@ bool TContainerHolder::DeliverEvent(const TEvent &event) {
     }
     case EEventType::Exit:
     {
-        auto list = List();
-        for (auto &target : list) {
-            // check whether container can exit under holder lock,
-            // assume container state is not changed when only holding
-            // container lock
-            if (target->WaitTask.Pid == event.Exit.Pid) {
+        // check whether container can exit under holder lock,
+        // assume container state is not changed when only holding
+        // container lock
+        std::shared_ptr<TContainer> target;
+        for (auto &it : Containers) {
+            if (it.second->WaitTask.Pid == event.Exit.Pid) {
+                target = it.second;
+                break;
+            }
+        }
+        if (target) {
+            TNestedScopedLock lock(*target, holder_lock);
+            if (target->IsValid() && target->WaitTask.Pid == event.Exit.Pid) {
+                // we don't want any concurrent stop/start/pause/etc and
+                // don't care whether parent acquired or not
+                target->AcquireForced();
+                target->DeliverEvent(holder_lock, event);
+                target->Release();
+            }
+        } else {
+            auto it = ExecPids.find(event.Exit.Pid);
+            if (it != ExecPids.end()) {
+                target = it->second.lock();
+                ExecPids.erase(it);
+            }
+            if (target) {
                 TNestedScopedLock lock(*target, holder_lock);
-                if (target->IsValid() && target->WaitTask.Pid == event.Exit.Pid) {
-                    // we don't want any concurrent stop/start/pause/etc and
-                    // don't care whether parent acquired or not
-                    target->AcquireForced();
-                    target->DeliverEvent(holder_lock, event);
-                    target->Release();
-                    break;
-                }
+                if (target->IsValid())
+                    target->ExecExit(event.Exit.Pid, event.Exit.Status);
             }
         }
         AckExitStatus(event.Exit.Pid);
@@ -493,18 +688,18 @@ bool TContainerHolder::DeliverEvent(const TEvent &event) {
         if (container) {
             TNestedScopedLock lock(*container, holder_lock);
             L_ACT() << "Destroy weak container " << container->GetName() << std::endl;
-            Destroy(holder_lock, container);
+            DestroyDeferred(holder_lock, container);
         }
     }
     case EEventType::RotateLogs:
     {
         { /* gc */
             std::vector<std::string> remove;
-            for (auto target : List())
+            for (auto &it : Containers)
                 // don't lock container here, we don't care if we race, we
                 // make real check under lock later
-                if (target->CanRemoveDead())
-                    remove.push_back(target->GetName());
+                if (!it.second->Dying && it.second->CanRemoveDead())
+                    remove.push_back(it.first);
 
             for (auto name : remove) {
                 std::shared_ptr<TContainer> container;
@@ -515,6 +710,7 @@ bool TContainerHolder::DeliverEvent(const TEvent &event) {
                 TNestedScopedLock lock(*container, holder_lock, std::try_to_lock);
                 if (!lock.IsLocked() ||
                     !container->IsValid() ||
+                    container->Dying ||
                     !container->CanRemoveDead())
                     continue;
 
@@ -524,7 +720,7 @@ bool TContainerHolder::DeliverEvent(const TEvent &event) {
 
                 L_ACT() << "Remove old dead " << name << std::endl;
 
-                error = Destroy(holder_lock, container);
+                error = DestroyDeferred(holder_lock, container);
                 if (error)
                     L_ERR() << "Can't destroy " << name << ": " << error << std::endl;
                 else
@@ -4,6 +4,9 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 #include <unordered_map>
 
 #include "common.hpp"
@@ -24,8 +27,17 @@ class TNetwork;
 class TContainerHolder : public std::enable_shared_from_this<TContainerHolder> {
     TIdMap IdMap;
 
+    /* deferred destroy, protected by holder lock */
+    std::vector<std::thread> TeardownThreads;
+    std::deque<std::shared_ptr<TContainer>> TeardownQueue;
+    std::condition_variable TeardownCv;
+    bool TeardownRunning = false;
+
     void ScheduleLogRotatation();
     void Unlink(TScopedLock &holder_lock, std::shared_ptr<TContainer> c);
+    void Forget(std::shared_ptr<TContainer> c);
+    void Teardown(TScopedLock &holder_lock, std::shared_ptr<TContainer> c);
+    void TeardownWorker();
 
 public:
     std::shared_ptr<TEventQueue> Queue = nullptr;
@@ -51,9 +63,14 @@ public:
     bool RestoreFromStorage();
     void RemoveLeftovers();
     TError Destroy(TScopedLock &holder_lock, std::shared_ptr<TContainer> c);
+    TError DestroyDeferred(TScopedLock &holder_lock, std::shared_ptr<TContainer> c);
+    void WaitTeardown(TScopedLock &holder_lock, const std::string &name);
+    void StartTeardown();
+    void StopTeardown();
     void DestroyRoot(TScopedLock &holder_lock);
 
     std::vector<std::shared_ptr<TContainer> > List(bool all = false) const;
 
     bool DeliverEvent(const TEvent &event);
+    void SampleStatistics();
 };
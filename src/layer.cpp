@@ -3,9 +3,16 @@
 #include <volume.hpp>
 #include <config.hpp>
 #include <util/unix.hpp>
+#include <util/tar.hpp>
+#include <util/log.hpp>
+#include <util/string.hpp>
 
 extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/xattr.h>
+#include <sys/sysmacros.h>
 }
 
 TError CheckPlace(const TPath &place, bool init) {
@@ -75,12 +82,368 @@ bool LayerInUse(const std::string &name, const TPath &place) {
     return false;
 }
 
+/*
+ * Extracts tar stream into layer directory. Every entry is created
+ * relative to its parent directory opened without following symlinks,
+ * thus archive cannot write outside. Aufs whiteouts are converted into
+ * overlayfs ones as they come, like SanitizeLayer() does afterwards.
+ */
+class TLayerUnpacker {
+    TPath Root;
+    TFile RootDir;
+    bool Merge;
+    std::string ParentPath;     /* cached parent of previous entry */
+    TFile Parent;
+    std::vector<std::pair<std::string, uint64_t>> DirTimes;
+    std::vector<char> Buffer;
+
+    static TError SplitPath(const std::string &path, std::vector<std::string> &names);
+    TError OpenDir(const std::vector<std::string> &names, size_t count,
+                   bool create, TFile &dir);
+    TError OpenParent(const std::vector<std::string> &names);
+    TError Remove(const std::string &parent, const std::string &name);
+    TError SetAttrs(int fd, const TTarEntry &entry);
+    TError Whiteout(const std::string &parent, const std::string &name);
+    TError Extract(TTarReader &reader, const TTarEntry &entry);
+
+public:
+    uint64_t Entries = 0;
+    uint64_t Bytes = 0;
+
+    TLayerUnpacker(const TPath &root, bool merge) : Root(root), Merge(merge) {}
+    TError Unpack(TTarReader &reader);
+};
+
+TError TLayerUnpacker::SplitPath(const std::string &path, std::vector<std::string> &names) {
+    std::vector<std::string> tokens;
+
+    names.clear();
+    (void)SplitString(path, '/', tokens);
+    for (auto &name: tokens) {
+        if (name == "" || name == ".")
+            continue;
+        if (name == "..")
+            return TError(EError::InvalidData, "Path with .. in archive: " + path);
+        names.push_back(name);
+    }
+    return TError::Success();
+}
+
+TError TLayerUnpacker::OpenDir(const std::vector<std::string> &names, size_t count,
+                               bool create, TFile &dir) {
+    int fd = dup(RootDir.Fd);
+
+    for (size_t i = 0; i < count && fd >= 0; i++) {
+        const char *name = names[i].c_str();
+        int next = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        /* archives may omit directories */
+        if (next < 0 && errno == ENOENT && create &&
+                (!mkdirat(fd, name, 0755) || errno == EEXIST))
+            next = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (next < 0) {
+            TError error(EError::InvalidData, errno, "Cannot open directory " +
+                         names[i] + " in layer");
+            close(fd);
+            return error;
+        }
+
+        close(fd);
+        fd = next;
+    }
+
+    if (fd < 0)
+        return TError(EError::Unknown, errno, "dup()");
+
+    dir.Close();
+    dir.SetFd = fd;
+    return TError::Success();
+}
+
+TError TLayerUnpacker::OpenParent(const std::vector<std::string> &names) {
+    std::string path;
+
+    for (size_t i = 0; i + 1 < names.size(); i++)
+        path += names[i] + "/";
+
+    if (Parent.Fd >= 0 && path == ParentPath)
+        return TError::Success();
+
+    ParentPath = path;
+    TError error = OpenDir(names, names.size() - 1, true, Parent);
+    if (error)
+        ParentPath = "";
+    return error;
+}
+
+/* Removes existing entry in parent directory, if any */
+TError TLayerUnpacker::Remove(const std::string &parent, const std::string &name) {
+    if (!unlinkat(Parent.Fd, name.c_str(), 0) || errno == ENOENT)
+        return TError::Success();
+    if (errno == EISDIR && !unlinkat(Parent.Fd, name.c_str(), AT_REMOVEDIR))
+        return TError::Success();
+    if (errno == EISDIR || errno == ENOTEMPTY || errno == EEXIST)
+        return (Root / parent / name).RemoveAll();
+    return TError(EError::Unknown, errno, "Cannot remove " + parent + name);
+}
+
+TError TLayerUnpacker::SetAttrs(int fd, const TTarEntry &entry) {
+    struct timespec ts[2];
+
+    if (fchown(fd, entry.Uid, entry.Gid))
+        return TError(EError::Unknown, errno, "Cannot chown " + entry.Path);
+
+    /* after chown which drops suid */
+    if (fchmod(fd, entry.Mode))
+        return TError(EError::Unknown, errno, "Cannot chmod " + entry.Path);
+
+    /*
+     * Only user namespace: security.capability, trusted.overlay.* and
+     * others would be set with our privileges. Whiteouts are .wh. entries.
+     */
+    for (auto &it: entry.Xattrs) {
+        if (!StringStartsWith(it.first, "user."))
+            continue;
+        if (fsetxattr(fd, it.first.c_str(), it.second.data(), it.second.size(), 0))
+            return TError(EError::Unknown, errno, "Cannot set xattr " +
+                          it.first + " for " + entry.Path);
+    }
+
+    ts[0].tv_sec = ts[1].tv_sec = entry.Mtime;
+    ts[0].tv_nsec = ts[1].tv_nsec = 0;
+    if (futimens(fd, ts))
+        return TError(EError::Unknown, errno, "Cannot set mtime " + entry.Path);
+
+    return TError::Success();
+}
+
+TError TLayerUnpacker::Whiteout(const std::string &parent, const std::string &name) {
+    /* Opaque directory - hide entries in lower layers */
+    if (name == ".wh..wh..opq") {
+        if (fsetxattr(Parent.Fd, "trusted.overlay.opaque", "y", 1, 0))
+            return TError(EError::Unknown, errno, "Cannot make opaque " + parent);
+        return TError::Success();
+    }
+
+    /* Other aufs metadata */
+    if (name.compare(0, 8, ".wh..wh.") == 0)
+        return TError::Success();
+
+    /* Remove whiteouted entry and convert into overlayfs whiteout */
+    TError error = Remove(parent, name.substr(4));
+    if (error)
+        return error;
+
+    if (!Merge && mknodat(Parent.Fd, name.substr(4).c_str(), S_IFCHR, 0))
+        return TError(EError::Unknown, errno, "Cannot create whiteout " + parent + name);
+
+    return TError::Success();
+}
+
+TError TLayerUnpacker::Extract(TTarReader &reader, const TTarEntry &entry) {
+    std::vector<std::string> names;
+    struct timespec ts[2];
+    TError error;
+    TFile file;
+
+    error = SplitPath(entry.Path, names);
+    if (error || names.empty())
+        return error;
+
+    error = OpenParent(names);
+    if (error)
+        return error;
+
+    const std::string &name = names.back();
+    const char *cname = name.c_str();
+
+    if (name.compare(0, 4, ".wh.") == 0)
+        return Whiteout(ParentPath, name);
+
+    if (entry.Type == '5') {
+        struct stat st;
+
+        if (!fstatat(Parent.Fd, cname, &st, AT_SYMLINK_NOFOLLOW) &&
+                !S_ISDIR(st.st_mode)) {
+            error = Remove(ParentPath, name);
+            if (error)
+                return error;
+        }
+        if (mkdirat(Parent.Fd, cname, 0700) && errno != EEXIST)
+            return TError(EError::Unknown, errno, "Cannot create " + entry.Path);
+
+        file.SetFd = openat(Parent.Fd, cname, O_RDONLY | O_DIRECTORY |
+                                              O_NOFOLLOW | O_CLOEXEC);
+        if (file.Fd < 0)
+            return TError(EError::Unknown, errno, "Cannot open " + entry.Path);
+
+        /* directory mtime changes while it's filled, set it at the end */
+        DirTimes.emplace_back(ParentPath + name, entry.Mtime);
+
+        return SetAttrs(file.Fd, entry);
+    }
+
+    error = Remove(ParentPath, name);
+    if (error)
+        return error;
+
+    switch (entry.Type) {
+    case '0':
+    {
+        file.SetFd = openat(Parent.Fd, cname, O_WRONLY | O_CREAT | O_EXCL |
+                                              O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (file.Fd < 0)
+            return TError(EError::Unknown, errno, "Cannot create " + entry.Path);
+
+        while (true) {
+            size_t len;
+
+            error = reader.Read(Buffer.data(), Buffer.size(), len);
+            if (error || !len)
+                break;
+
+            for (size_t off = 0; off < len; ) {
+                ssize_t ret = write(file.Fd, Buffer.data() + off, len - off);
+                if (ret < 0)
+                    return TError(EError::Unknown, errno, "Cannot write " + entry.Path);
+                off += ret;
+            }
+            Bytes += len;
+        }
+        if (error)
+            return error;
+
+        return SetAttrs(file.Fd, entry);
+    }
+    case '1':
+    {
+        std::vector<std::string> target;
+        TFile dir;
+
+        error = SplitPath(entry.Link, target);
+        if (!error && target.empty())
+            error = TError(EError::InvalidData, "Bad hardlink " + entry.Path);
+        if (!error)
+            error = OpenDir(target, target.size() - 1, false, dir);
+        if (error)
+            return error;
+
+        if (linkat(dir.Fd, target.back().c_str(), Parent.Fd, cname, 0))
+            return TError(EError::Unknown, errno, "Cannot link " + entry.Path +
+                          " to " + entry.Link);
+        return TError::Success();
+    }
+    case '2':
+        if (symlinkat(entry.Link.c_str(), Parent.Fd, cname))
+            return TError(EError::Unknown, errno, "Cannot create symlink " + entry.Path);
+        break;
+    case '3':
+    case '4':
+    case '6':
+    {
+        mode_t type = entry.Type == '3' ? S_IFCHR :
+                      entry.Type == '4' ? S_IFBLK : S_IFIFO;
+
+        if (mknodat(Parent.Fd, cname, type | entry.Mode,
+                    makedev(entry.DevMajor, entry.DevMinor)))
+            return TError(EError::Unknown, errno, "Cannot create node " + entry.Path);
+        break;
+    }
+    default:
+        return TError(EError::NotSupported, "Unsupported tar entry " + entry.Path);
+    }
+
+    /* symlinks and nodes cannot be opened, chmod goes before chown for them */
+    if (entry.Type != '2' && fchmodat(Parent.Fd, cname, entry.Mode, 0))
+        return TError(EError::Unknown, errno, "Cannot chmod " + entry.Path);
+
+    if (fchownat(Parent.Fd, cname, entry.Uid, entry.Gid, AT_SYMLINK_NOFOLLOW))
+        return TError(EError::Unknown, errno, "Cannot chown " + entry.Path);
+
+    ts[0].tv_sec = ts[1].tv_sec = entry.Mtime;
+    ts[0].tv_nsec = ts[1].tv_nsec = 0;
+    if (utimensat(Parent.Fd, cname, ts, AT_SYMLINK_NOFOLLOW))
+        return TError(EError::Unknown, errno, "Cannot set mtime " + entry.Path);
+
+    return TError::Success();
+}
+
+TError TLayerUnpacker::Unpack(TTarReader &reader) {
+    TError error;
+    TTarEntry entry;
+    bool eof;
+
+    error = RootDir.Open(Root, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (error)
+        return error;
+
+    Buffer.resize(1 << 20);
+
+    while (true) {
+        error = reader.Next(entry, eof);
+        if (error || eof)
+            break;
+
+        error = Extract(reader, entry);
+        if (error)
+            break;
+
+        Entries++;
+    }
+
+    if (error)
+        return error;
+
+    for (auto it = DirTimes.rbegin(); it != DirTimes.rend(); it++) {
+        std::vector<std::string> names;
+        struct timespec ts[2];
+        TFile dir;
+
+        ts[0].tv_sec = ts[1].tv_sec = it->second;
+        ts[0].tv_nsec = ts[1].tv_nsec = 0;
+
+        if (!SplitPath(it->first, names) &&
+                !OpenDir(names, names.size(), false, dir))
+            (void)futimens(dir.Fd, ts);
+    }
+
+    return TError::Success();
+}
+
+static TError UnpackLayer(const TPath &tarball, const TPath &layer, bool merge) {
+    uint64_t start = GetCurrentTimeMs();
+    TLayerUnpacker unpacker(layer, merge);
+    TTarReader reader;
+    TError error;
+
+    error = reader.Open(tarball);
+    if (!error)
+        error = unpacker.Unpack(reader);
+
+    /* decompressor failure explains broken stream better */
+    TError error2 = reader.Close(bool(error));
+    if (error2 && error.GetError() != EError::NotSupported)
+        error = error2;
+    if (error)
+        return error;
+
+    uint64_t ms = GetCurrentTimeMs() - start;
+    L_ACT() << "Unpacked " << tarball << " " << reader.GetCompression() << " "
+            << unpacker.Entries << " entries " << (unpacker.Bytes >> 20)
+            << "M in " << ms << " ms, " << (ms ? (unpacker.Bytes >> 10) * 1000 / ms >> 10 : 0)
+            << " MB/s" << std::endl;
+
+    return TError::Success();
+}
+
 TError ImportLayer(const std::string &name, const TPath &place,
                    const TPath &tarball, bool merge) {
     TPath layers = place / config().volumes().layers_dir();
     TPath layers_tmp = layers / "_tmp_";
     TPath layer = layers / name;
     TPath layer_tmp = layers_tmp / name;
+    bool native = config().volumes().native_tar();
     TError error;
 
     error = ValidateLayerName(name);
@@ -103,13 +466,28 @@ TError ImportLayer(const std::string &name, const TPath &place,
     }
     volumes_lock.unlock();
 
-    error = UnpackTarball(tarball, layer_tmp);
-    if (error)
-        goto err;
+    if (native) {
+        error = UnpackLayer(tarball, layer_tmp, merge);
+        if (error.GetError() == EError::NotSupported) {
+            /* tar rewrites everything above partially unpacked layer */
+            L_WRN() << "Cannot unpack " << tarball << " natively: " << error
+                    << ", fallback to tar" << std::endl;
+            if (!merge)
+                (void)layer_tmp.ClearDirectory();
+            native = false;
+        } else if (error)
+            goto err;
+    }
 
-    error = SanitizeLayer(layer_tmp, merge);
-    if (error)
-        goto err;
+    if (!native) {
+        error = UnpackTarball(tarball, layer_tmp);
+        if (error)
+            goto err;
+
+        error = SanitizeLayer(layer_tmp, merge);
+        if (error)
+            goto err;
+    }
 
     error = layer_tmp.Rename(layer);
     if (error)
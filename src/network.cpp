@@ -8,6 +8,7 @@
 #include "holder.hpp"
 #include "config.hpp"
 #include "client.hpp"
+#include "pool.hpp"
 #include "util/log.hpp"
 #include "util/string.hpp"
 #include "util/crc32.hpp"
@@ -1171,14 +1172,33 @@ std::string TNetCfg::GenerateHw(const std::string &name) {
 
 TError TNetCfg::ConfigureVeth(TVethNetCfg &veth) {
     auto parentNl = ParentNet->GetNl();
-    TNlLink peer(parentNl, ParentNet->NewDeviceName("portove-"));
+    std::string peerName;
     TError error;
 
     std::string hw = veth.Hw;
     if (hw.empty() && !Hostname.empty())
         hw = GenerateHw(veth.Name + veth.Peer);
 
-    error = peer.AddVeth(veth.Name, hw, veth.Mtu, NetNs.GetFd());
+    if (!WarmVeth.empty()) {
+        /* pooled pair: inner end is still down and could be renamed */
+        peerName = WarmVeth;
+        WarmVeth.clear();
+
+        TNlLink link(Net->GetNl(), WARM_VETH_NAME);
+        error = link.Load();
+        if (!error)
+            error = link.Change(veth.Name, hw, veth.Mtu);
+        if (!error && veth.Mtu > 0) {
+            TNlLink peer(parentNl, peerName);
+            error = peer.Load();
+            if (!error)
+                error = peer.Change("", "", veth.Mtu);
+        }
+    } else {
+        TNlLink peer(parentNl, ParentNet->NewDeviceName("portove-"));
+        peerName = peer.GetName();
+        error = peer.AddVeth(veth.Name, hw, veth.Mtu, NetNs.GetFd());
+    }
     if (error)
         return error;
 
@@ -1188,7 +1208,7 @@ TError TNetCfg::ConfigureVeth(TVethNetCfg &veth) {
         if (error)
             return error;
 
-        error = bridge.Enslave(peer.GetName());
+        error = bridge.Enslave(peerName);
         if (error)
             return error;
     }
@@ -1330,6 +1350,14 @@ TError TNetCfg::ConfigureInterfaces() {
         links.emplace_back(mvlan.Name);
     }
 
+    /* pooled veth pair is used for first veth into host */
+    if (!WarmVeth.empty() && (Veth.empty() || ParentNet != HostNetwork)) {
+        TNlLink warm(target_nl, WARM_VETH_NAME);
+        if (!warm.Load())
+            (void)warm.Remove();
+        WarmVeth.clear();
+    }
+
     for (auto &veth : Veth) {
         error = ConfigureVeth(veth);
         if (error)
@@ -1415,10 +1443,12 @@ TError TNetCfg::PrepareNetwork() {
     TError error;
 
     if (NewNetNs) {
-        Net = std::make_shared<TNetwork>();
-        error = Net->ConnectNew(NetNs);
-        if (error)
-            return error;
+        if (!WarmPool.TakeNetns(Net, NetNs, WarmVeth)) {
+            Net = std::make_shared<TNetwork>();
+            error = Net->ConnectNew(NetNs);
+            if (error)
+                return error;
+        }
 
         error = ConfigureInterfaces();
         if (error) {
@@ -180,6 +180,7 @@ struct TNetCfg {
     std::vector<TGwVec> GwVec;
     std::vector<TIpVec> IpVec;
     std::vector<std::string> Autoconf;
+    std::string WarmVeth;   /* host end of veth pair from warm pool */
 
     TNamespaceFd NetNs;
 
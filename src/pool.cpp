@@ -0,0 +1,198 @@
+#include "pool.hpp"
+#include "network.hpp"
+#include "reaper.hpp"
+#include "config.hpp"
+#include "statistics.hpp"
+#include "util/log.hpp"
+#include "util/unix.hpp"
+#include "util/string.hpp"
+#include "util/netlink.hpp"
+
+TWarmPool WarmPool;
+
+void TWarmPool::Start() {
+    if (Valid)
+        return;
+
+    CgroupsSize = config().daemon().warm_cgroups();
+    NetnsSize = config().daemon().warm_netns();
+    if (!CgroupsSize && !NetnsSize)
+        return;
+
+    L_SYS() << "Start warm pool, cgroups " << CgroupsSize
+            << " network namespaces " << NetnsSize << std::endl;
+
+    for (auto hy: Hierarchies)
+        Cgroups[{hy, PORTO_ROOT_CGROUP}];
+
+    Valid = true;
+    Thread = std::thread(&TWarmPool::PoolFn, this);
+}
+
+void TWarmPool::Stop() {
+    if (!Valid)
+        return;
+
+    auto lock = ScopedLock();
+    Valid = false;
+    Cv.notify_all();
+    lock.unlock();
+
+    Thread.join();
+
+    lock.lock();
+    for (auto &it: Cgroups)
+        for (auto &cg: it.second)
+            (void)cg.Remove();
+    Cgroups.clear();
+    Netns.clear();
+}
+
+/* Returns false if something cannot be created, lock is released meanwhile */
+bool TWarmPool::Refill(TScopedLock &lock) {
+    TError error;
+
+    for (auto it = Cgroups.begin(); Valid && it != Cgroups.end(); ) {
+        auto key = it->first;
+
+        if (it->second.size() >= CgroupsSize) {
+            it++;
+            continue;
+        }
+
+        TCgroup cg = key.first->Cgroup(key.second + "/%warm-" +
+                                       std::to_string(Sequence++));
+        lock.unlock();
+        error = cg.Create();
+        lock.lock();
+        if (error)
+            return false;
+
+        /* parent could be dropped meanwhile */
+        it = Cgroups.find(key);
+        if (it == Cgroups.end()) {
+            (void)cg.Remove();
+            it = Cgroups.upper_bound(key);
+        } else
+            it->second.push_back(cg);
+    }
+
+    while (Valid && Netns.size() < NetnsSize) {
+        std::unique_ptr<TWarmNetns> warm(new TWarmNetns);
+
+        lock.unlock();
+        warm->Net = std::make_shared<TNetwork>();
+        error = warm->Net->ConnectNew(warm->NetNs);
+        if (!error && HostNetwork) {
+            auto net_lock = HostNetwork->ScopedLock();
+            TNlLink peer(HostNetwork->GetNl(), HostNetwork->NewDeviceName("portove-"));
+            error = peer.AddVeth(WARM_VETH_NAME, "", 0, warm->NetNs.GetFd());
+            if (!error)
+                warm->VethPeer = peer.GetName();
+        }
+        lock.lock();
+        if (error) {
+            L_ERR() << "Cannot create warm network namespace: " << error << std::endl;
+            return false;
+        }
+        Netns.push_back(std::move(warm));
+    }
+
+    return true;
+}
+
+void TWarmPool::PoolFn() {
+    SetProcessName("portod-pool");
+
+    auto lock = ScopedLock();
+    while (Valid) {
+        bool full = Refill(lock);
+
+        /* retry failed creation later, otherwise sleep until taken */
+        if (Valid && full)
+            Cv.wait(lock);
+        else if (Valid)
+            Cv.wait_for(lock, std::chrono::milliseconds(1000));
+    }
+}
+
+bool TWarmPool::TakeCgroup(const TCgroup &cg) {
+    std::string prefix = std::string(PORTO_ROOT_CGROUP) + "/";
+    TError error;
+
+    if (!StringStartsWith(cg.Name, prefix))
+        return false;
+
+    auto lock = ScopedLock();
+
+    if (!Valid || !CgroupsSize)
+        return false;
+
+    /* cgroups cannot be moved between parents, miss starts pool here */
+    auto &pool = Cgroups[{cg.Subsystem, cg.Name.substr(0, cg.Name.rfind('/'))}];
+    if (pool.empty()) {
+        Statistics->WarmCgroupMisses++;
+        Cv.notify_all();
+        return false;
+    }
+
+    TCgroup warm = pool.front();
+    pool.pop_front();
+    Cv.notify_all();
+    lock.unlock();
+
+    error = cg.CancelRemove();
+    if (!error)
+        error = warm.Path().Rename(cg.Path());
+
+    if (error) {
+        L_WRN() << "Cannot use warm cgroup " << warm << " : " << error << std::endl;
+        (void)warm.Remove();
+        Statistics->WarmCgroupMisses++;
+        return false;
+    }
+
+    L_ACT() << "Use warm cgroup " << warm << " as " << cg << std::endl;
+    Statistics->WarmCgroupHits++;
+    return true;
+}
+
+void TWarmPool::DropCgroups(const TCgroup &cg) {
+    std::list<TCgroup> drop;
+
+    auto lock = ScopedLock();
+    auto it = Cgroups.find({cg.Subsystem, cg.Name});
+    if (it == Cgroups.end())
+        return;
+    drop.swap(it->second);
+    Cgroups.erase(it);
+    lock.unlock();
+
+    for (auto &warm: drop)
+        (void)warm.Remove();
+}
+
+bool TWarmPool::TakeNetns(std::shared_ptr<TNetwork> &net, TNamespaceFd &netns,
+                          std::string &vethPeer) {
+    auto lock = ScopedLock();
+
+    if (!Valid || !NetnsSize)
+        return false;
+
+    if (Netns.empty()) {
+        Statistics->WarmNetnsMisses++;
+        Cv.notify_all();
+        return false;
+    }
+
+    auto warm = std::move(Netns.front());
+    Netns.pop_front();
+    Cv.notify_all();
+    lock.unlock();
+
+    net = warm->Net;
+    netns.EatFd(warm->NetNs);
+    vethPeer = warm->VethPeer;
+    Statistics->WarmNetnsHits++;
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+
+#include "cgroup.hpp"
+#include "util/locks.hpp"
+#include "util/namespace.hpp"
+
+class TNetwork;
+
+/* Inner end of pooled veth pair until handout */
+#define WARM_VETH_NAME "portowarm0"
+
+/*
+ * Keeps cgroups and network namespaces created ahead of container start
+ * and refills them in background. Cgroups are created as "%warm-N" in
+ * parent cgroup and renamed into place, '%' is forbidden in container
+ * names. Cgroups cannot be moved between parents: pool for nested parent
+ * is started by first miss and dropped before parent cgroup is removed.
+ * Network namespaces come with veth pair into host:
+ * inner end is renamed and readdressed at start for first veth of config
+ * or removed if it isn't needed. Addresses and routes are configured at
+ * start as usual.
+ */
+class TWarmPool : public TLockable, public TNonCopyable {
+    struct TWarmNetns {
+        std::shared_ptr<TNetwork> Net;
+        TNamespaceFd NetNs;
+        std::string VethPeer;
+    };
+
+    /* hierarchy and parent cgroup name -> pooled children */
+    std::map<std::pair<const TSubsystem *, std::string>, std::list<TCgroup>> Cgroups;
+    std::list<std::unique_ptr<TWarmNetns>> Netns;
+    std::condition_variable Cv;
+    std::thread Thread;
+    bool Valid = false;
+    uint64_t Sequence = 0;
+    size_t CgroupsSize = 0;
+    size_t NetnsSize = 0;
+
+    bool Refill(TScopedLock &lock);
+    void PoolFn();
+
+public:
+    void Start();
+    void Stop();
+
+    /* true if pooled cgroup is renamed into cg */
+    bool TakeCgroup(const TCgroup &cg);
+
+    /* removes pooled children, called before removing cg */
+    void DropCgroups(const TCgroup &cg);
+
+    /* true if net and netns are taken from pool, vethPeer is host end */
+    bool TakeNetns(std::shared_ptr<TNetwork> &net, TNamespaceFd &netns,
+                   std::string &vethPeer);
+};
+
+extern TWarmPool WarmPool;
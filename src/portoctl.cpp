@@ -1,5 +1,6 @@
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <csignal>
@@ -8,6 +9,7 @@
 #include "libporto.hpp"
 #include "cli.hpp"
 #include "volume.hpp"
+#include "reqlog.hpp"
 #include "util/string.hpp"
 #include "util/signal.hpp"
 #include "util/unix.hpp"
@@ -306,13 +308,14 @@ public:
             return TError(EError::Unknown, errno, "cannot fork");
 
         if (!pid) {
+            /* output is bulk, input is keystrokes checked for escape below */
+            TFdForwarder output(MasterPty, STDOUT_FILENO);
+
             while (1) {
-                if ((nread = read(MasterPty, &buf, sizeof buf)) <= 0) {
-                    if (errno == EINTR || errno == EAGAIN)
-                        continue;
-                    break;
-                }
-                if (write(STDOUT_FILENO, &buf, nread) < 0)
+                ssize_t len = output.Forward();
+                if (len < 0 && (errno == EINTR || errno == EAGAIN))
+                    continue;
+                if (len <= 0)
                     break;
             }
             exit(0);
@@ -731,11 +734,38 @@ public:
 
 class TStartCmd final : public ICmd {
 public:
-    TStartCmd(Porto::Connection *api) : ICmd(api, "start", 1, "<container1> [container2...]", "start container") {}
+    TStartCmd(Porto::Connection *api) : ICmd(api, "start", 1, "[-r] [-a <name>:<after>[,<after>...]] <container1> [container2...]", "start container",
+             "    -r                          start whole subtree\n"
+             "    -a <name>:<after>[,...]     start name after its siblings (with -r)\n") {}
 
     int Execute(TCommandEnviroment *env) final override {
-        for (const auto &arg : env->GetArgs()) {
-            int ret = Api->Start(arg);
+        std::map<std::string, std::vector<std::string>> after;
+        bool recursive = false;
+
+        const auto &containers = env->GetOpts({
+            { 'r', false, [&](const char *arg) { recursive = true; } },
+            { 'a', true, [&](const char *arg) {
+                std::vector<std::string> dep;
+                (void)SplitString(arg, ':', dep, 2);
+                if (dep.size() == 2)
+                    (void)SplitString(dep[1], ',', after[dep[0]]);
+            } },
+        });
+
+        for (const auto &arg : containers) {
+            int ret;
+
+            if (recursive) {
+                std::vector<Porto::StartResult> results;
+
+                ret = Api->StartRecursive(arg, after, results);
+                for (auto &result: results)
+                    if (result.Error)
+                        std::cerr << result.Name << ": " << ErrorName(result.Error)
+                                  << " " << result.ErrorMsg << std::endl;
+            } else
+                ret = Api->Start(arg);
+
             if (ret) {
                 PrintError("Can't start container");
                 return ret;
@@ -1028,13 +1058,48 @@ public:
 class TExecCmd final : public ICmd {
 public:
     TExecCmd(Porto::Connection *api) : ICmd(api, "exec", 2,
-        "[-C] [-T] [-L layer]... <container> command=<command> [properties]",
+        "[-C] [-T] [-E] [-L layer]... <container> command=<command> [properties]",
         "Execute command in container, forward terminal, destroy container at the end",
         "    -L layer|dir|tarball        add lower layer (-L top ... -L bottom)\n"
+        "    -E                          run in existing running container, without terminal\n"
+        "                                properties: env, cwd, stdin_path, stdout_path, stderr_path\n"
         ) { }
 
+    /* Fast path: exec request into running container */
+    int ExecuteInside(const std::vector<std::string> &args) {
+        std::map<std::string, std::string> config;
+        std::string command;
+        int pid, status;
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            auto sep = args[i].find('=');
+            if (sep == std::string::npos) {
+                std::cerr << "Invalid property: " << args[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (args[i].substr(0, sep) == "command")
+                command = args[i].substr(sep + 1);
+            else
+                config[args[i].substr(0, sep)] = args[i].substr(sep + 1);
+        }
+
+        int ret = Api->Exec(args[0], command, config, true, pid, status);
+        if (ret) {
+            PrintError("Cannot exec in container");
+            return EXIT_FAILURE;
+        }
+
+        if (WIFSIGNALED(status)) {
+            std::cerr << "Killed by signal " << WTERMSIG(status) << std::endl;
+            return 128 + WTERMSIG(status);
+        }
+
+        return WEXITSTATUS(status);
+    }
+
     int Execute(TCommandEnviroment *environment) final override {
         TLauncher launcher(Api);
+        bool inside = false;
         TError error;
 
         launcher.WeakContainer = true;
@@ -1045,9 +1110,13 @@ public:
         const auto &args = environment->GetOpts({
             { 'C', false, [&](const char *arg) { launcher.WeakContainer = false; } },
             { 'T', false, [&](const char *arg) { launcher.ForwardTerminal = false; } },
+            { 'E', false, [&](const char *arg) { inside = true; } },
             { 'L', true, [&](const char *arg) { launcher.Layers.push_back(arg); launcher.NeedVolume = true; } },
         });
 
+        if (inside)
+            return ExecuteInside(args);
+
         launcher.Container = args[0];
         for (size_t i = 1; i < args.size(); ++i) {
             error = launcher.SetProperty(args[i]);
@@ -1255,16 +1324,19 @@ public:
 class TWaitCmd final : public ICmd {
 public:
     TWaitCmd(Porto::Connection *api) : ICmd(api, "wait", 0,
-             "[-T <seconds>] <container|wildcard> ...",
+             "[-T <seconds>] [-E <event>]... <container|wildcard> ...",
              "Wait for any listed container change state to dead or meta without running children",
              "    -T <seconds>  timeout\n"
+             "    -E <event>    also wake at event: memory_pressure, memory_threshold, exec, stdout, stderr\n"
              ) {}
 
     int Execute(TCommandEnviroment *env) final override {
+        std::vector<std::string> events;
         int timeout = -1;
         const auto &containers = env->GetOpts({
             { 't', true, [&](const char *arg) { timeout = (std::stoi(arg) + 999) / 1000; } },
             { 'T', true, [&](const char *arg) { timeout = std::stoi(arg); } },
+            { 'E', true, [&](const char *arg) { events.push_back(arg); } },
         });
 
         if (containers.empty()) {
@@ -1272,8 +1344,8 @@ public:
             return EXIT_FAILURE;
         }
 
-        std::string name;
-        int ret = Api->WaitContainers(containers, name, timeout);
+        std::string name, event;
+        int ret = Api->WaitContainers(containers, events, name, event, timeout);
         if (ret) {
             PrintError("Can't wait for containers");
             return ret;
@@ -1281,8 +1353,52 @@ public:
 
         if (name.empty())
             std::cerr << "timeout" << std::endl;
-        else
+        else if (event.empty())
             std::cout << name << std::endl;
+        else
+            std::cout << name << " " << event << std::endl;
+
+        return 0;
+    }
+};
+
+class TLogsCmd final : public ICmd {
+public:
+    TLogsCmd(Porto::Connection *api) : ICmd(api, "logs", 1,
+             "[-f] [-e] [-o <offset>] <container>",
+             "Print container stdout or stderr",
+             "    -f            follow output until container dies\n"
+             "    -e            stderr instead of stdout\n"
+             "    -o <offset>   start from offset, default is oldest kept\n"
+             ) {}
+
+    int Execute(TCommandEnviroment *env) final override {
+        std::string stream = "stdout";
+        uint64_t offset = 0;
+        bool follow = false;
+        const auto &args = env->GetOpts({
+            { 'f', false, [&](const char *arg) { follow = true; } },
+            { 'e', false, [&](const char *arg) { stream = "stderr"; } },
+            { 'o', true, [&](const char *arg) { offset = std::stoull(arg); } },
+        });
+
+        while (true) {
+            std::string data;
+            bool eof;
+
+            int ret = Api->ReadStream(args[0], stream, offset, 0,
+                                      follow ? -1 : 0, data, eof);
+            if (ret) {
+                PrintError("Can't read " + stream);
+                return ret;
+            }
+
+            std::cout.write(data.data(), data.size());
+            std::cout.flush();
+
+            if (eof || (!follow && data.empty()))
+                break;
+        }
 
         return 0;
     }
@@ -2147,6 +2263,67 @@ err:
     }
 };
 
+class TRequestLogCmd final : public ICmd {
+public:
+    TRequestLogCmd(Porto::Connection *api) : ICmd(api, "reqlog", 1,
+             "[-e] [-s <ms>] [-m <request>] <file>",
+             "Decode binary request log",
+             "    -e            only errors\n"
+             "    -s <ms>       only requests slower than ms\n"
+             "    -m <request>  only requests of this type, like create or start\n"
+             ) {}
+
+    int Execute(TCommandEnviroment *env) final override {
+        bool errors = false;
+        uint64_t slowUs = 0;
+        std::string method;
+        const auto &args = env->GetOpts({
+            { 'e', false, [&](const char *arg) { errors = true; } },
+            { 's', true, [&](const char *arg) { slowUs = std::stoull(arg) * 1000; } },
+            { 'm', true, [&](const char *arg) { method = arg; } },
+        });
+
+        std::ifstream in(args[0], std::ios::binary);
+        char magic[sizeof(REQUEST_LOG_MAGIC)];
+
+        if (!in.read(magic, sizeof(magic)) ||
+                memcmp(magic, REQUEST_LOG_MAGIC, sizeof(magic))) {
+            std::cerr << "Not a request log: " << args[0] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        TRequestRecord rec;
+        while (in.read((char *)&rec, sizeof(rec))) {
+            auto field = rpc::TContainerRequest::descriptor()->FindFieldByNumber(rec.Method);
+            std::string name = field ? field->name() : std::to_string(rec.Method);
+
+            if ((errors && !(rec.Flags & REQUEST_LOG_ERROR)) ||
+                    rec.Duration < slowUs ||
+                    (!method.empty() && method != name))
+                continue;
+
+            time_t sec = rec.Time / 1000000;
+            struct tm tm;
+            char date[64];
+            localtime_r(&sec, &tm);
+            strftime(date, sizeof(date), "%F %T", &tm);
+
+            std::cout << date << "." << std::setw(6) << std::setfill('0')
+                      << rec.Time % 1000000 << std::setfill(' ') << " " << name
+                      << " ct=" << (rec.ContainerId < 0 ? "-" : std::to_string(rec.ContainerId))
+                      << " pid=" << rec.ClientPid << " " << rec.Duration << "us"
+                      << " req=" << rec.RequestSize << " rsp=" << rec.ResponseSize
+                      << " " << rpc::EError_Name((rpc::EError)rec.Error)
+                      << (rec.Flags & REQUEST_LOG_QUEUED ? " queued" : "")
+                      << (rec.Flags & REQUEST_LOG_SLOW ? " slow" : "")
+                      << (rec.Flags & REQUEST_LOG_SAMPLED ? " sampled" : "")
+                      << "\n";
+        }
+
+        return 0;
+    }
+};
+
 class TConvertPathCmd final : public ICmd {
 
 public:
@@ -2200,6 +2377,7 @@ int main(int argc, char *argv[]) {
     handler.RegisterCommand<TGcCmd>();
     handler.RegisterCommand<TFindCmd>();
     handler.RegisterCommand<TWaitCmd>();
+    handler.RegisterCommand<TLogsCmd>();
 
     handler.RegisterCommand<TCreateVolumeCmd>();
     handler.RegisterCommand<TLinkVolumeCmd>();
@@ -2211,6 +2389,7 @@ int main(int argc, char *argv[]) {
     handler.RegisterCommand<TBuildCmd>();
 
     handler.RegisterCommand<TConvertPathCmd>();
+    handler.RegisterCommand<TRequestLogCmd>();
 
     TLogger::DisableLog();
 
@@ -14,11 +14,16 @@
 #include "event.hpp"
 #include "network.hpp"
 #include "context.hpp"
+#include "sampler.hpp"
+#include "reaper.hpp"
+#include "spawner.hpp"
+#include "pool.hpp"
 #include "client.hpp"
 #include "epoll.hpp"
 #include "container.hpp"
 #include "volume.hpp"
 #include "protobuf.hpp"
+#include "reqlog.hpp"
 #include "util/log.hpp"
 #include "util/signal.hpp"
 #include "util/unix.hpp"
@@ -108,6 +113,7 @@ static void DaemonShutdown(bool master, int ret) {
 
     L_SYS() << "Stopped " << ret << std::endl;
 
+    TLogger::StopWriter();
     TLogger::CloseLog();
     (void)pidFile.Unlink();
 
@@ -270,9 +276,17 @@ retry:
 static void StartWorkers(TContext &context, TRpcWorker &worker) {
     worker.Start();
     context.Queue->Start();
+    context.Sampler->Start();
+    CgroupReaper.Start();
+    WarmPool.Start();
+    context.Cholder->StartTeardown();
 }
 
 static void StopWorkers(TContext &context, TRpcWorker &worker) {
+    context.Cholder->StopTeardown();
+    WarmPool.Stop();
+    CgroupReaper.Stop();
+    context.Sampler->Stop();
     context.Queue->Stop();
     worker.Stop();
 }
@@ -364,6 +378,7 @@ static int SlaveRpc(TContext &context, TRpcWorker &worker) {
                         goto exit;
                     case SIGUSR1:
                         DaemonOpenLog(false);
+                        RequestLog.Open();
                         break;
                     case SIGUSR2:
                         DumpMallocInfo();
@@ -405,6 +420,42 @@ static int SlaveRpc(TContext &context, TRpcWorker &worker) {
                     context.Queue->Add(0, e);
                 }
 
+            } else if (source->Flags & (EPOLL_EVENT_MEM_PRESSURE |
+                                        EPOLL_EVENT_MEM_THRESHOLD)) {
+                auto container = source->Container.lock();
+
+                // re-armed by container after event delivery
+                context.EpollLoop->StopInput(source->Fd);
+
+                if (container && (source->Flags & EPOLL_EVENT_MEM_PRESSURE)) {
+                    TEvent e(EEventType::MemPressure, container);
+                    e.MemPressure.Fd = source->Fd;
+                    context.Queue->Add(0, e);
+                } else if (container) {
+                    TEvent e(EEventType::MemThreshold, container);
+                    e.MemThreshold.Fd = source->Fd;
+                    context.Queue->Add(0, e);
+                }
+
+            } else if (source->Flags & EPOLL_EVENT_STREAM) {
+                auto container = source->Container.lock();
+
+                // re-armed by container after draining
+                context.EpollLoop->StopInput(source->Fd);
+
+                if (container) {
+                    TEvent e(EEventType::StreamData, container);
+                    e.StreamData.Fd = source->Fd;
+                    context.Queue->Add(0, e);
+                }
+
+            } else if (source->Flags & EPOLL_EVENT_STREAM_NOTIFY) {
+                // re-armed after reading inotify events
+                context.EpollLoop->StopInput(source->Fd);
+
+                TEvent e(EEventType::StreamNotify);
+                context.Queue->Add(0, e);
+
             } else if (clients.find(source->Fd) != clients.end()) {
                 auto client = clients[source->Fd];
 
@@ -506,6 +557,8 @@ static int SlaveMain() {
 
     L_SYS() << "Previous version: " << PreviousVersion << std::endl;
 
+    RequestLog.Open();
+
     TRpcWorker worker(config().daemon().workers());
 
     ret = TuneLimits();
@@ -557,8 +610,23 @@ static int SlaveMain() {
             return EXIT_FAILURE;
     }
 
+    /* Fork zygote while slave has no threads and little memory */
+    if (config().daemon().spawner()) {
+        error = Spawner.Start();
+        if (error)
+            L_ERR() << "Cannot start spawner: " << error << std::endl;
+    }
+
+    /* Threads are allowed from here */
+    TLogger::StartWriter(config().daemon().log_queue());
+
     TNetwork::InitializeConfig();
-    InitContainerProperties();
+
+    error = InitContainerProperties();
+    if (error) {
+        L_ERR() << "Cannot initialize properties: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
 
     ContainersKV = TPath(config().keyval().file().path());
     error = TKeyValue::Mount(ContainersKV);
@@ -610,6 +678,8 @@ static int SlaveMain() {
 
         ret = SlaveRpc(context, worker);
         L_SYS() << "Shutting down..." << std::endl;
+        Spawner.Stop();
+        RequestLog.Close();
     } catch (string s) {
         L_ERR() << "EXCEPTION: " << s << std::endl;
         Crash();
@@ -11,44 +11,149 @@
 #include "util/unix.hpp"
 #include "util/cred.hpp"
 #include <sstream>
+#include <algorithm>
 
 extern "C" {
 #include <sys/sysinfo.h>
 }
 
-__thread TContainer *CurrentContainer = nullptr;
 std::map<std::string, TProperty*> ContainerProperties;
+TPropertyIndex PropertyIndex;
+std::vector<TProperty *> SampledProperties;
+std::vector<TProperty *> CounterProperties;
 
 TProperty::TProperty(std::string name, EProperty prop, std::string desc) {
     Name = name;
     Prop = prop;
+    Id = TPropertyIndex::Hash(name);
     Desc = desc;
     ContainerProperties[name] = this;
 }
 
-TError TProperty::Set(const std::string &value) {
+/* FNV-1a */
+uint32_t TPropertyIndex::Hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline uint32_t MixHash(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t TPropertyIndex::Slot(uint32_t id) const {
+    return MixHash(id ^ Displace[id & BucketMask]) & SlotMask;
+}
+
+TError TPropertyIndex::Build(const std::map<std::string, TProperty *> &props) {
+    std::map<uint32_t, TProperty *> ids;
+
+    for (auto &it: props) {
+        auto dup = ids.emplace(it.second->Id, it.second);
+        if (!dup.second)
+            return TError(EError::ResourceNotAvailable, "Properties " +
+                          dup.first->second->Name + " and " + it.first +
+                          " have the same id");
+    }
+
+    /* sparser table needs less displacement probes */
+    for (uint32_t scale = 2; scale <= MAX_SCALE; scale *= 2)
+        if (TryBuild(props, scale))
+            return TError::Success();
+
+    Displace.clear();
+    Slots.clear();
+    return TError(EError::ResourceNotAvailable, "Cannot build property index");
+}
+
+bool TPropertyIndex::TryBuild(const std::map<std::string, TProperty *> &props, uint32_t scale) {
+    uint32_t buckets = 1, slots = 1;
+
+    while (buckets < props.size() / 2)
+        buckets <<= 1;
+    while (slots < props.size() * scale)
+        slots <<= 1;
+
+    BucketMask = buckets - 1;
+    SlotMask = slots - 1;
+    Displace.assign(buckets, 0);
+    Slots.assign(slots, nullptr);
+
+    std::vector<std::vector<TProperty *>> bucket(buckets);
+    for (auto &it: props)
+        bucket[it.second->Id & BucketMask].push_back(it.second);
+
+    /* place crowded buckets first, while table is empty */
+    std::vector<uint32_t> order(buckets);
+    for (uint32_t b = 0; b < buckets; b++)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucket[a].size() > bucket[b].size();
+    });
+
+    for (auto b: order) {
+        std::vector<uint32_t> taken;
+        uint32_t disp;
+
+        for (disp = 1; disp <= MAX_DISPLACE; disp++) {
+            Displace[b] = disp;
+            taken.clear();
+
+            for (auto prop: bucket[b]) {
+                uint32_t slot = Slot(prop->Id);
+                if (Slots[slot] || std::find(taken.begin(), taken.end(), slot) != taken.end())
+                    break;
+                taken.push_back(slot);
+            }
+
+            if (taken.size() == bucket[b].size())
+                break;
+        }
+
+        if (disp > MAX_DISPLACE)
+            return false;
+
+        for (auto prop: bucket[b])
+            Slots[Slot(prop->Id)] = prop;
+    }
+
+    for (auto &it: props)
+        PORTO_ASSERT(Find(it.first) == it.second);
+
+    return true;
+}
+
+TError TProperty::Set(TContainer &ct, const std::string &value) {
     if (IsReadOnly)
         return TError(EError::InvalidValue, "Read-only value: " + Name);
     return TError(EError::NotSupported, "Not implemented: " + Name);
 }
 
-TError TProperty::GetIndexed(const std::string &index, std::string &value) {
+TError TProperty::GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
     return TError(EError::InvalidValue, "Invalid subscript for property");
 }
 
-TError TProperty::SetIndexed(const std::string &index, const std::string &value) {
+TError TProperty::SetIndexed(TContainer &ct, const std::string &index, const std::string &value) {
     return TError(EError::InvalidValue, "Invalid subscript for property");
 }
 
-TError TProperty::GetToSave(std::string &value) {
+TError TProperty::GetToSave(TContainer &ct, std::string &value) {
     if (Prop != EProperty::NONE)
-        return Get(value);
+        return Get(ct, value);
     return TError(EError::Unknown, "Trying to save non-serializable value");
 }
 
-TError TProperty::SetFromRestore(const std::string &value) {
+TError TProperty::SetFromRestore(TContainer &ct, const std::string &value) {
     if (Prop != EProperty::NONE)
-        return Set(value);
+        return Set(ct, value);
     return TError(EError::Unknown, "Trying to restore non-serializable value");
 }
 
@@ -60,8 +165,8 @@ TError TProperty::SetFromRestore(const std::string &value) {
  * Of course, some properties can be read-only
  */
 
-TError TProperty::IsAliveAndStopped(void) {
-    auto state = CurrentContainer->GetState();
+TError TProperty::IsAliveAndStopped(TContainer &ct) {
+    auto state = ct.GetState();
 
     if (state == EContainerState::Dead)
         return TError(EError::InvalidState,
@@ -75,8 +180,8 @@ TError TProperty::IsAliveAndStopped(void) {
     return TError::Success();
 }
 
-TError TProperty::IsAlive(void) {
-    auto state = CurrentContainer->GetState();
+TError TProperty::IsAlive(TContainer &ct) {
+    auto state = ct.GetState();
 
     if (state == EContainerState::Dead)
         return TError(EError::InvalidState,
@@ -85,8 +190,8 @@ TError TProperty::IsAlive(void) {
     return TError::Success();
 }
 
-TError TProperty::IsDead(void) {
-    auto state = CurrentContainer->GetState();
+TError TProperty::IsDead(TContainer &ct) {
+    auto state = ct.GetState();
 
     if (state != EContainerState::Dead)
         return TError(EError::InvalidState,
@@ -95,8 +200,8 @@ TError TProperty::IsDead(void) {
     return TError::Success();
 }
 
-TError TProperty::IsRunning(void) {
-    auto state = CurrentContainer->GetState();
+TError TProperty::IsRunning(TContainer &ct) {
+    auto state = ct.GetState();
 
     /*
      * This snippet is taken from TContainer::GetProperty.
@@ -116,8 +221,8 @@ public:
     TCapLimit() : TProperty(P_CAPABILITIES, EProperty::CAPABILITIES,
             "Limit capabilities in container: SYS_ADMIN;NET_ADMIN;... see man capabilities") {}
 
-    TError CommitLimit(TCapabilities &limit) {
-        TError error = IsAliveAndStopped();
+    TError CommitLimit(TContainer &ct, TCapabilities &limit) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
 
@@ -130,15 +235,15 @@ public:
         TCapabilities bound;
         if (CurrentClient->IsSuperUser())
             bound = AllCapabilities;
-        else if (CurrentContainer->VirtMode == VIRT_MODE_OS)
+        else if (ct.VirtMode == VIRT_MODE_OS)
             bound = OsModeCapabilities;
         else
             bound = SuidCapabilities;
 
         /* root user can allow any capabilities in own containers */
         if (!CurrentClient->IsSuperUser() ||
-                !CurrentContainer->OwnerCred.IsRootUser()) {
-            for (auto p = CurrentContainer->GetParent(); p; p = p->GetParent())
+                !ct.OwnerCred.IsRootUser()) {
+            for (auto p = ct.GetParent(); p; p = p->GetParent())
                 bound.Permitted &= p->CapLimit.Permitted;
         }
 
@@ -149,36 +254,36 @@ public:
                           ", you can set only: " + bound.Format());
         }
 
-        CurrentContainer->CapLimit = limit;
-        CurrentContainer->SetProp(EProperty::CAPABILITIES);
-        CurrentContainer->SanitizeCapabilities();
+        ct.CapLimit = limit;
+        ct.SetProp(EProperty::CAPABILITIES);
+        ct.SanitizeCapabilities();
         return TError::Success();
     }
 
-    TError Get(std::string &value) {
-        value = CurrentContainer->CapLimit.Format();
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.CapLimit.Format();
         return TError::Success();
     }
 
-    TError Set(const std::string &value) {
+    TError Set(TContainer &ct, const std::string &value) {
         TCapabilities caps;
         TError error = caps.Parse(value);
         if (error)
             return error;
-        return CommitLimit(caps);
+        return CommitLimit(ct, caps);
     }
 
-    TError GetIndexed(const std::string &index, std::string &value) {
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
         TCapabilities caps;
         TError error = caps.Parse(index);
         if (error)
             return error;
-        value = BoolToString((CurrentContainer->CapLimit.Permitted &
+        value = BoolToString((ct.CapLimit.Permitted &
                               caps.Permitted) == caps.Permitted);
         return TError::Success();
     }
 
-    TError SetIndexed(const std::string &index, const std::string &value) {
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &value) {
         TCapabilities caps;
         bool val;
 
@@ -188,10 +293,10 @@ public:
         if (error)
             return error;
         if (val)
-            caps.Permitted = CurrentContainer->CapLimit.Permitted | caps.Permitted;
+            caps.Permitted = ct.CapLimit.Permitted | caps.Permitted;
         else
-            caps.Permitted = CurrentContainer->CapLimit.Permitted & ~caps.Permitted;
-        return CommitLimit(caps);
+            caps.Permitted = ct.CapLimit.Permitted & ~caps.Permitted;
+        return CommitLimit(ct, caps);
     }
 } static Capabilities;
 
@@ -204,8 +309,8 @@ public:
         IsSupported = HasAmbientCapabilities;
     }
 
-    TError CommitAmbient(TCapabilities &ambient) {
-        TError error = IsAliveAndStopped();
+    TError CommitAmbient(TContainer &ct, TCapabilities &ambient) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
 
@@ -216,7 +321,7 @@ public:
         }
 
         /* check allowed ambient capabilities */
-        TCapabilities limit = CurrentContainer->CapAllowed;
+        TCapabilities limit = ct.CapAllowed;
         if (ambient.Permitted & ~limit.Permitted &&
                 !CurrentClient->IsSuperUser()) {
             ambient.Permitted &= ~limit.Permitted;
@@ -226,44 +331,44 @@ public:
         }
 
         /* try to raise capabilities limit if required */
-        limit = CurrentContainer->CapLimit;
+        limit = ct.CapLimit;
         if (ambient.Permitted & ~limit.Permitted) {
             limit.Permitted |= ambient.Permitted;
-            error = Capabilities.CommitLimit(limit);
+            error = Capabilities.CommitLimit(ct, limit);
             if (error)
                 return error;
         }
 
-        CurrentContainer->CapAmbient = ambient;
-        CurrentContainer->SetProp(EProperty::CAPABILITIES_AMBIENT);
-        CurrentContainer->SanitizeCapabilities();
+        ct.CapAmbient = ambient;
+        ct.SetProp(EProperty::CAPABILITIES_AMBIENT);
+        ct.SanitizeCapabilities();
         return TError::Success();
     }
 
-    TError Get(std::string &value) {
-        value = CurrentContainer->CapAmbient.Format();
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.CapAmbient.Format();
         return TError::Success();
     }
 
-    TError Set(const std::string &value) {
+    TError Set(TContainer &ct, const std::string &value) {
         TCapabilities caps;
         TError error = caps.Parse(value);
         if (error)
             return error;
-        return CommitAmbient(caps);
+        return CommitAmbient(ct, caps);
     }
 
-    TError GetIndexed(const std::string &index, std::string &value) {
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
         TCapabilities caps;
         TError error = caps.Parse(index);
         if (error)
             return error;
-        value = BoolToString((CurrentContainer->CapAmbient.Permitted &
+        value = BoolToString((ct.CapAmbient.Permitted &
                               caps.Permitted) == caps.Permitted);
         return TError::Success();
     }
 
-    TError SetIndexed(const std::string &index, const std::string &value) {
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &value) {
         TCapabilities caps;
         bool val;
 
@@ -273,26 +378,26 @@ public:
         if (error)
             return error;
         if (val)
-            caps.Permitted = CurrentContainer->CapAmbient.Permitted | caps.Permitted;
+            caps.Permitted = ct.CapAmbient.Permitted | caps.Permitted;
         else
-            caps.Permitted = CurrentContainer->CapAmbient.Permitted & ~caps.Permitted;
-        return CommitAmbient(caps);
+            caps.Permitted = ct.CapAmbient.Permitted & ~caps.Permitted;
+        return CommitAmbient(ct, caps);
     }
 } static CapabilitiesAmbient;
 
 class TCwd : public TProperty {
 public:
     TCwd() : TProperty(P_CWD, EProperty::CWD, "Container working directory") {}
-    TError Get(std::string &value) {
-        value = CurrentContainer->GetCwd();
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.GetCwd();
         return TError::Success();
     }
-    TError Set(const std::string &cwd) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &cwd) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
-        CurrentContainer->Cwd = cwd;
-        CurrentContainer->SetProp(EProperty::CWD);
+        ct.Cwd = cwd;
+        ct.SetProp(EProperty::CWD);
         return TError::Success();
     }
 } static Cwd;
@@ -317,15 +422,15 @@ class TUlimit : public TProperty {
         { "stack", RLIMIT_STACK },
     };
 public:
-    TError Set(const std::string &ulimit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &ulimit);
+    TError Get(TContainer &ct, std::string &value);
     TUlimit() : TProperty(P_ULIMIT, EProperty::ULIMIT,
                           "Container resource limits: "
                           "<type> <soft> <hard>; ... (man 2 getrlimit)") {}
 } static Ulimit;
 
-TError TUlimit::Set(const std::string &ulimit_str) {
-    TError error = IsAliveAndStopped();
+TError TUlimit::Set(TContainer &ct, const std::string &ulimit_str) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -376,19 +481,19 @@ TError TUlimit::Set(const std::string &ulimit_str) {
         new_limit[idx].rlim_max = hard;
     }
 
-    CurrentContainer->Rlimit = new_limit;
-    CurrentContainer->SetProp(EProperty::ULIMIT);
+    ct.Rlimit = new_limit;
+    ct.SetProp(EProperty::ULIMIT);
 
     return TError::Success();
 }
 
-TError TUlimit::Get(std::string &value) {
+TError TUlimit::Get(TContainer &ct, std::string &value) {
     std::stringstream str;
     bool first = true;
 
     for (auto limit_elem : nameToIdx) {
-        auto value = CurrentContainer->Rlimit.find(limit_elem.second);
-        if (value == CurrentContainer->Rlimit.end())
+        auto value = ct.Rlimit.find(limit_elem.second);
+        if (value == ct.Rlimit.end())
             continue;
 
         if (first)
@@ -408,38 +513,38 @@ TError TUlimit::Get(std::string &value) {
 
 class TCpuPolicy : public TProperty {
 public:
-    TError Set(const std::string &policy);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &policy);
+    TError Get(TContainer &ct, std::string &value);
     TCpuPolicy() : TProperty(P_CPU_POLICY, EProperty::CPU_POLICY,
                              "CPU policy: rt, normal, idle (dynamic)" ) {}
 } static CpuPolicy;
 
-TError TCpuPolicy::Set(const std::string &policy) {
-    TError error = IsAlive();
+TError TCpuPolicy::Set(TContainer &ct, const std::string &policy) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
     if (policy != "normal" && policy != "rt" && policy != "idle")
         return TError(EError::InvalidValue, "invalid policy: " + policy);
 
-    if (CurrentContainer->CpuPolicy != policy) {
-        CurrentContainer->CpuPolicy = policy;
-        CurrentContainer->SetProp(EProperty::CPU_POLICY);
+    if (ct.CpuPolicy != policy) {
+        ct.CpuPolicy = policy;
+        ct.SetProp(EProperty::CPU_POLICY);
     }
 
     return TError::Success();
 }
 
-TError TCpuPolicy::Get(std::string &value) {
-    value = CurrentContainer->CpuPolicy;
+TError TCpuPolicy::Get(TContainer &ct, std::string &value) {
+    value = ct.CpuPolicy;
 
     return TError::Success();
 }
 
 class TIoPolicy : public TProperty {
 public:
-    TError Set(const std::string &policy);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &policy);
+    TError Get(TContainer &ct, std::string &value);
     TIoPolicy() : TProperty(P_IO_POLICY, EProperty::IO_POLICY,
                             "IO policy: normal | batch (dynamic)") {}
     void Init(void) {
@@ -447,24 +552,24 @@ public:
     }
 } static IoPolicy;
 
-TError TIoPolicy::Set(const std::string &policy) {
-    TError error = IsAlive();
+TError TIoPolicy::Set(TContainer &ct, const std::string &policy) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
     if (policy != "normal" && policy != "batch")
         return TError(EError::InvalidValue, "invalid policy: " + policy);
 
-    if (CurrentContainer->IoPolicy != policy) {
-        CurrentContainer->IoPolicy = policy;
-        CurrentContainer->SetProp(EProperty::IO_POLICY);
+    if (ct.IoPolicy != policy) {
+        ct.IoPolicy = policy;
+        ct.SetProp(EProperty::IO_POLICY);
     }
 
     return TError::Success();
 }
 
-TError TIoPolicy::Get(std::string &value) {
-    value = CurrentContainer->IoPolicy;
+TError TIoPolicy::Get(TContainer &ct, std::string &value) {
+    value = ct.IoPolicy;
 
     return TError::Success();
 }
@@ -473,18 +578,18 @@ class TUser : public TProperty {
 public:
     TUser() : TProperty(P_USER, EProperty::USER, "Start command with given user") {}
 
-    TError Get(std::string &value) {
-        value = UserName(CurrentContainer->OwnerCred.Uid);
+    TError Get(TContainer &ct, std::string &value) {
+        value = UserName(ct.OwnerCred.Uid);
         return TError::Success();
     }
 
-    TError Set(const std::string &username) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &username) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
 
         TCred newCred;
-        gid_t oldGid = CurrentContainer->OwnerCred.Gid;
+        gid_t oldGid = ct.OwnerCred.Gid;
         error = newCred.Load(username);
         if (error) {
             /* super user can set any numeric id */
@@ -506,9 +611,9 @@ public:
         if (error)
             return error;
 
-        CurrentContainer->OwnerCred = newCred;
-        CurrentContainer->SetProp(EProperty::USER);
-        CurrentContainer->SanitizeCapabilities();
+        ct.OwnerCred = newCred;
+        ct.SetProp(EProperty::USER);
+        ct.SanitizeCapabilities();
         return TError::Success();
     }
 } static User;
@@ -517,13 +622,13 @@ class TGroup : public TProperty {
 public:
     TGroup() : TProperty(P_GROUP, EProperty::GROUP, "Start command with given group") {}
 
-    TError Get(std::string &value) {
-        value = GroupName(CurrentContainer->OwnerCred.Gid);
+    TError Get(TContainer &ct, std::string &value) {
+        value = GroupName(ct.OwnerCred.Gid);
         return TError::Success();
     }
 
-    TError Set(const std::string &groupname) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &groupname) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
 
@@ -532,22 +637,22 @@ public:
         if (error)
             return error;
 
-        if (!CurrentContainer->OwnerCred.IsMemberOf(newGid) &&
+        if (!ct.OwnerCred.IsMemberOf(newGid) &&
                 !CurrentClient->Cred.IsMemberOf(newGid) &&
                 !CurrentClient->IsSuperUser())
             return TError(EError::Permission, "Desired group : " + groupname +
                     " isn't in current user supplementary group list");
 
-        CurrentContainer->OwnerCred.Gid = newGid;
-        CurrentContainer->SetProp(EProperty::GROUP);
+        ct.OwnerCred.Gid = newGid;
+        ct.SetProp(EProperty::GROUP);
         return TError::Success();
     }
 } static Group;
 
 class TMemoryGuarantee : public TProperty {
 public:
-    TError Set(const std::string &mem_guarantee);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &mem_guarantee);
+    TError Get(TContainer &ct, std::string &value);
     TMemoryGuarantee() : TProperty(P_MEM_GUARANTEE, EProperty::MEM_GUARANTEE,
                                     "Guaranteed amount of memory "
                                     "[bytes] (dynamic)") {}
@@ -556,8 +661,8 @@ public:
     }
 } static MemoryGuarantee;
 
-TError TMemoryGuarantee::Set(const std::string &mem_guarantee) {
-    TError error = IsAlive();
+TError TMemoryGuarantee::Set(TContainer &ct, const std::string &mem_guarantee) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -566,28 +671,28 @@ TError TMemoryGuarantee::Set(const std::string &mem_guarantee) {
     if (error)
         return error;
 
-    CurrentContainer->NewMemGuarantee = new_val;
+    ct.NewMemGuarantee = new_val;
 
     uint64_t total = GetTotalMemory();
-    uint64_t usage = CurrentContainer->GetRoot()->GetTotalMemGuarantee();
+    uint64_t usage = ct.GetRoot()->GetTotalMemGuarantee();
     uint64_t reserve = config().daemon().memory_guarantee_reserve();
 
     if (usage + reserve > total) {
-        CurrentContainer->NewMemGuarantee = CurrentContainer->MemGuarantee;
-        int64_t left = total - reserve - CurrentContainer->GetRoot()->GetTotalMemGuarantee();
+        ct.NewMemGuarantee = ct.MemGuarantee;
+        int64_t left = total - reserve - ct.GetRoot()->GetTotalMemGuarantee();
         return TError(EError::ResourceNotAvailable, "Only " + std::to_string(left) + " bytes left");
     }
 
-    if (CurrentContainer->MemGuarantee != new_val) {
-        CurrentContainer->MemGuarantee = new_val;
-        CurrentContainer->SetProp(EProperty::MEM_GUARANTEE);
+    if (ct.MemGuarantee != new_val) {
+        ct.MemGuarantee = new_val;
+        ct.SetProp(EProperty::MEM_GUARANTEE);
     }
 
     return TError::Success();
 }
 
-TError TMemoryGuarantee::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->MemGuarantee);
+TError TMemoryGuarantee::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.MemGuarantee);
 
     return TError::Success();
 }
@@ -603,69 +708,69 @@ public:
     void Init(void) {
         IsSupported = MemorySubsystem.SupportGuarantee();
     }
-    TError Get(std::string &value) {
-        value = std::to_string(CurrentContainer->GetTotalMemGuarantee());
+    TError Get(TContainer &ct, std::string &value) {
+        value = std::to_string(ct.GetTotalMemGuarantee());
         return TError::Success();
     }
 } static MemTotalGuarantee;
 
 class TCommand : public TProperty {
 public:
-    TError Set(const std::string &command);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &command);
+    TError Get(TContainer &ct, std::string &value);
     TCommand() : TProperty(P_COMMAND, EProperty::COMMAND,
                            "Command executed upon container start") {}
 } static Command;
 
-TError TCommand::Set(const std::string &command) {
-    TError error = IsAliveAndStopped();
+TError TCommand::Set(TContainer &ct, const std::string &command) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
-    CurrentContainer->Command = command;
-    CurrentContainer->SetProp(EProperty::COMMAND);
+    ct.Command = command;
+    ct.SetProp(EProperty::COMMAND);
 
     return TError::Success();
 }
 
-TError TCommand::Get(std::string &value) {
+TError TCommand::Get(TContainer &ct, std::string &value) {
     std::string virt_mode;
 
-    value = CurrentContainer->Command;
+    value = ct.Command;
 
     return TError::Success();
 }
 
 class TVirtMode : public TProperty {
 public:
-    TError Set(const std::string &virt_mode);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &virt_mode);
+    TError Get(TContainer &ct, std::string &value);
     TVirtMode() : TProperty(P_VIRT_MODE, EProperty::VIRT_MODE,
                             "Virtualization mode: os|app") {}
 } static VirtMode;
 
-TError TVirtMode::Set(const std::string &virt_mode) {
-    TError error = IsAliveAndStopped();
+TError TVirtMode::Set(TContainer &ct, const std::string &virt_mode) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
     if (virt_mode == P_VIRT_MODE_APP)
-        CurrentContainer->VirtMode = VIRT_MODE_APP;
+        ct.VirtMode = VIRT_MODE_APP;
     else if (virt_mode == P_VIRT_MODE_OS)
-        CurrentContainer->VirtMode = VIRT_MODE_OS;
+        ct.VirtMode = VIRT_MODE_OS;
     else
         return TError(EError::InvalidValue, std::string("Unsupported ") +
                       P_VIRT_MODE + ": " + virt_mode);
 
-    CurrentContainer->SetProp(EProperty::VIRT_MODE);
-    CurrentContainer->SanitizeCapabilities();
+    ct.SetProp(EProperty::VIRT_MODE);
+    ct.SanitizeCapabilities();
 
     return TError::Success();
 }
 
-TError TVirtMode::Get(std::string &value) {
+TError TVirtMode::Get(TContainer &ct, std::string &value) {
 
-    switch (CurrentContainer->VirtMode) {
+    switch (ct.VirtMode) {
         case VIRT_MODE_APP:
             value = P_VIRT_MODE_APP;
             break;
@@ -673,7 +778,7 @@ TError TVirtMode::Get(std::string &value) {
             value = P_VIRT_MODE_OS;
             break;
         default:
-            value = "unknown " + std::to_string(CurrentContainer->VirtMode);
+            value = "unknown " + std::to_string(ct.VirtMode);
             break;
     }
 
@@ -684,15 +789,15 @@ class TStdinPath : public TProperty {
 public:
     TStdinPath() : TProperty(P_STDIN_PATH, EProperty::STDIN,
             "Container standard input path") {}
-    TError Get(std::string &value) {
-        value = CurrentContainer->Stdin.Path.ToString();
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.Stdin.Path.ToString();
         return TError::Success();
     }
-    TError Set(const std::string &path) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &path) {
+        TError error = IsAliveAndStopped(ct);
         if (!error) {
-            CurrentContainer->Stdin.SetInside(path);
-            CurrentContainer->SetProp(EProperty::STDIN);
+            ct.Stdin.SetInside(path);
+            ct.SetProp(EProperty::STDIN);
         }
         return error;
     }
@@ -703,15 +808,15 @@ class TStdoutPath : public TProperty {
 public:
     TStdoutPath() : TProperty(P_STDOUT_PATH, EProperty::STDOUT,
             "Container standard output path") {}
-    TError Get(std::string &value) {
-        value =  CurrentContainer->Stdout.Path.ToString();
+    TError Get(TContainer &ct, std::string &value) {
+        value =  ct.Stdout.Path.ToString();
         return TError::Success();
     }
-    TError Set(const std::string &path) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &path) {
+        TError error = IsAliveAndStopped(ct);
         if (!error) {
-            CurrentContainer->Stdout.SetInside(path);
-            CurrentContainer->SetProp(EProperty::STDOUT);
+            ct.Stdout.SetInside(path);
+            ct.SetProp(EProperty::STDOUT);
         }
         return error;
     }
@@ -721,15 +826,15 @@ class TStderrPath : public TProperty {
 public:
     TStderrPath() : TProperty(P_STDERR_PATH, EProperty::STDERR,
             "Container standard error path") {}
-    TError Get(std::string &value) {
-        value = CurrentContainer->Stderr.Path.ToString();
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.Stderr.Path.ToString();
         return TError::Success();
     }
-    TError Set(const std::string &path) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &path) {
+        TError error = IsAliveAndStopped(ct);
         if (!error) {
-            CurrentContainer->Stderr.SetInside(path);
-            CurrentContainer->SetProp(EProperty::STDERR);
+            ct.Stderr.SetInside(path);
+            ct.SetProp(EProperty::STDERR);
         }
         return error;
     }
@@ -739,11 +844,11 @@ class TStdoutLimit : public TProperty {
 public:
     TStdoutLimit() : TProperty(P_STDOUT_LIMIT, EProperty::STDOUT_LIMIT,
             "Limit for stored stdout and stderr size (dynamic)") {}
-    TError Get(std::string &value) {
-        value = std::to_string(CurrentContainer->Stdout.Limit);
+    TError Get(TContainer &ct, std::string &value) {
+        value = std::to_string(ct.Stdout.Limit);
         return TError::Success();
     }
-    TError Set(const std::string &value) {
+    TError Set(TContainer &ct, const std::string &value) {
         uint64_t limit;
         TError error = StringToSize(value, limit);
         if (error)
@@ -754,24 +859,49 @@ public:
             return TError(EError::Permission,
                           "Maximum limit is: " + std::to_string(limit_max));
 
-        CurrentContainer->Stdout.Limit = limit;
-        CurrentContainer->Stderr.Limit = limit;
-        CurrentContainer->SetProp(EProperty::STDOUT_LIMIT);
+        ct.Stdout.Limit = limit;
+        ct.Stderr.Limit = limit;
+        ct.SetProp(EProperty::STDOUT_LIMIT);
         return TError::Success();
     }
 } static StdoutLimit;
 
+class TStreamMemory : public TProperty {
+public:
+    TStreamMemory() : TProperty(P_STREAM_MEMORY, EProperty::STREAM_MEMORY,
+            "Keep default stdout and stderr in memory, stdout_limit bytes each") {}
+    TError Get(TContainer &ct, std::string &value) {
+        value = BoolToString(ct.Stdout.Memory);
+        return TError::Success();
+    }
+    TError Set(TContainer &ct, const std::string &value) {
+        TError error = IsAliveAndStopped(ct);
+        if (error)
+            return error;
+
+        bool memory;
+        error = StringToBool(value, memory);
+        if (error)
+            return error;
+
+        ct.Stdout.Memory = memory;
+        ct.Stderr.Memory = memory;
+        ct.SetProp(EProperty::STREAM_MEMORY);
+        return TError::Success();
+    }
+} static StreamMemory;
+
 class TStdoutOffset : public TProperty {
 public:
     TStdoutOffset() : TProperty(D_STDOUT_OFFSET, EProperty::NONE,
             "Offset of stored stdout (ro)") {
         IsReadOnly = true;
     }
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        value = std::to_string(CurrentContainer->Stdout.Offset);
+        value = std::to_string(ct.Stdout.Offset);
         return TError::Success();
     }
 } static StdoutOffset;
@@ -782,11 +912,11 @@ public:
             "Offset of stored stderr (ro)") {
         IsReadOnly = true;
     }
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        value = std::to_string(CurrentContainer->Stderr.Offset);
+        value = std::to_string(ct.Stderr.Offset);
         return TError::Success();
     }
 } static StderrOffset;
@@ -797,17 +927,17 @@ public:
             "stdout [[offset][:length]] (ro)") {
         IsReadOnly = true;
     }
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        return CurrentContainer->Stdout.Read(*CurrentContainer, value);
+        return ct.Stdout.Read(ct, value);
     }
-    TError GetIndexed(const std::string &index, std::string &value) {
-        TError error = IsRunning();
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        return CurrentContainer->Stdout.Read(*CurrentContainer, value, index);
+        return ct.Stdout.Read(ct, value, index);
     }
 } static Stdout;
 
@@ -817,17 +947,17 @@ public:
             "stderr [[offset][:length]] (ro))") {
         IsReadOnly = true;
     }
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        return CurrentContainer->Stderr.Read(*CurrentContainer, value);
+        return ct.Stderr.Read(ct, value);
     }
-    TError GetIndexed(const std::string &index, std::string &value) {
-        TError error = IsRunning();
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        return CurrentContainer->Stderr.Read(*CurrentContainer, value, index);
+        return ct.Stderr.Read(ct, value, index);
     }
 } static Stderr;
 
@@ -836,19 +966,19 @@ public:
     TBindDns() : TProperty(P_BIND_DNS, EProperty::BIND_DNS,
                            "Bind /etc/resolv.conf and /etc/hosts"
                            " from host into container root") {}
-    TError Get(std::string &value) {
-        value = BoolToString(CurrentContainer->BindDns);
+    TError Get(TContainer &ct, std::string &value) {
+        value = BoolToString(ct.BindDns);
         return TError::Success();
     }
-    TError Set(const std::string &value) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &value) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
 
-        error = StringToBool(value, CurrentContainer->BindDns);
+        error = StringToBool(value, ct.BindDns);
         if (error)
             return error;
-        CurrentContainer->SetProp(EProperty::BIND_DNS);
+        ct.SetProp(EProperty::BIND_DNS);
         return TError::Success();
     }
 } static BindDns;
@@ -856,64 +986,64 @@ public:
 
 class TIsolate : public TProperty {
 public:
-    TError Set(const std::string &isolate_needed);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &isolate_needed);
+    TError Get(TContainer &ct, std::string &value);
     TIsolate() : TProperty(P_ISOLATE, EProperty::ISOLATE,
                            "Isolate container from parent") {}
 } static Isolate;
 
-TError TIsolate::Get(std::string &value) {
-    value = CurrentContainer->Isolate ? "true" : "false";
+TError TIsolate::Get(TContainer &ct, std::string &value) {
+    value = ct.Isolate ? "true" : "false";
 
     return TError::Success();
 }
 
-TError TIsolate::Set(const std::string &isolate_needed) {
-    TError error = IsAliveAndStopped();
+TError TIsolate::Set(TContainer &ct, const std::string &isolate_needed) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
     if (isolate_needed == "true")
-        CurrentContainer->Isolate = true;
+        ct.Isolate = true;
     else if (isolate_needed == "false")
-        CurrentContainer->Isolate = false;
+        ct.Isolate = false;
     else
         return TError(EError::InvalidValue, "Invalid bool value");
 
-    CurrentContainer->SetProp(EProperty::ISOLATE);
+    ct.SetProp(EProperty::ISOLATE);
 
     return TError::Success();
 }
 
 class TRoot : public TProperty {
 public:
-    TError Set(const std::string &root);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &root);
+    TError Get(TContainer &ct, std::string &value);
     TRoot() : TProperty(P_ROOT, EProperty::ROOT, "Container root directory"
                         "(container will be chrooted into ths directory)") {}
 } static Root;
 
-TError TRoot::Get(std::string &value) {
-    value = CurrentContainer->Root;
+TError TRoot::Get(TContainer &ct, std::string &value) {
+    value = ct.Root;
 
     return TError::Success();
 }
 
-TError TRoot::Set(const std::string &root) {
-    TError error = IsAliveAndStopped();
+TError TRoot::Set(TContainer &ct, const std::string &root) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
-    CurrentContainer->Root = root;
-    CurrentContainer->SetProp(EProperty::ROOT);
+    ct.Root = root;
+    ct.SetProp(EProperty::ROOT);
 
     return TError::Success();
 }
 
 class TNet : public TProperty {
 public:
-    TError Set(const std::string &net_desc);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &net_desc);
+    TError Get(TContainer &ct, std::string &value);
     TNet() : TProperty(P_NET, EProperty::NET,
  "Container network settings: "
  "none | "
@@ -930,8 +1060,8 @@ public:
  "netns <name>") {}
 } static Net;
 
-TError TNet::Set(const std::string &net_desc) {
-    TError error = IsAliveAndStopped();
+TError TNet::Set(TContainer &ct, const std::string &net_desc) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -943,44 +1073,44 @@ TError TNet::Set(const std::string &net_desc) {
     if (error)
         return error;
 
-    CurrentContainer->NetProp = new_net_desc; /* FIXME: Copy vector contents? */
+    ct.NetProp = new_net_desc; /* FIXME: Copy vector contents? */
 
-    CurrentContainer->SetProp(EProperty::NET);
+    ct.SetProp(EProperty::NET);
     return TError::Success();
 }
 
-TError TNet::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->NetProp, ';');
+TError TNet::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.NetProp, ';');
     return TError::Success();
 }
 
 class TRootRo : public TProperty {
 public:
-    TError Set(const std::string &ro);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &ro);
+    TError Get(TContainer &ct, std::string &value);
     TRootRo() : TProperty(P_ROOT_RDONLY, EProperty::ROOT_RDONLY,
                           "Mount root directory in read-only mode") {}
 } static RootRo;
 
-TError TRootRo::Set(const std::string &ro) {
-    TError error = IsAliveAndStopped();
+TError TRootRo::Set(TContainer &ct, const std::string &ro) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
     if (ro == "true")
-        CurrentContainer->RootRo = true;
+        ct.RootRo = true;
     else if (ro == "false")
-        CurrentContainer->RootRo = false;
+        ct.RootRo = false;
     else
         return TError(EError::InvalidValue, "Invalid bool value");
 
-    CurrentContainer->SetProp(EProperty::ROOT_RDONLY);
+    ct.SetProp(EProperty::ROOT_RDONLY);
 
     return TError::Success();
 }
 
-TError TRootRo::Get(std::string &ro) {
-    ro = CurrentContainer->RootRo ? "true" : "false";
+TError TRootRo::Get(TContainer &ct, std::string &ro) {
+    ro = ct.RootRo ? "true" : "false";
 
     return TError::Success();
 }
@@ -988,58 +1118,58 @@ TError TRootRo::Get(std::string &ro) {
 class TUmask : public TProperty {
 public:
     TUmask() : TProperty(P_UMASK, EProperty::UMASK, "Set file mode creation mask") { }
-    TError Get(std::string &value) {
-        value = StringFormat("%#o", CurrentContainer->Umask);
+    TError Get(TContainer &ct, std::string &value) {
+        value = StringFormat("%#o", ct.Umask);
         return TError::Success();
     }
-    TError Set(const std::string &value) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &value) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
-        error = StringToOct(value, CurrentContainer->Umask);
+        error = StringToOct(value, ct.Umask);
         if (error)
             return error;
-        CurrentContainer->SetProp(EProperty::UMASK);
+        ct.SetProp(EProperty::UMASK);
         return TError::Success();
     }
 } static Umask;
 
 class THostname : public TProperty {
 public:
-    TError Set(const std::string &hostname);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &hostname);
+    TError Get(TContainer &ct, std::string &value);
     THostname() : TProperty(P_HOSTNAME, EProperty::HOSTNAME, "Container hostname") {}
 } static Hostname;
 
-TError THostname::Set(const std::string &hostname) {
-    TError error = IsAliveAndStopped();
+TError THostname::Set(TContainer &ct, const std::string &hostname) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
-    CurrentContainer->Hostname = hostname;
-    CurrentContainer->SetProp(EProperty::HOSTNAME);
+    ct.Hostname = hostname;
+    ct.SetProp(EProperty::HOSTNAME);
 
     return TError::Success();
 }
 
-TError THostname::Get(std::string &value) {
-    value = CurrentContainer->Hostname;
+TError THostname::Get(TContainer &ct, std::string &value) {
+    value = ct.Hostname;
 
     return TError::Success();
 }
 
 class TEnvProperty : public TProperty {
 public:
-    TError Set(const std::string &env);
-    TError Get(std::string &value);
-    TError GetIndexed(const std::string &index, std::string &value);
-    TError SetIndexed(const std::string &index, const std::string &env_val);
+    TError Set(TContainer &ct, const std::string &env);
+    TError Get(TContainer &ct, std::string &value);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &env_val);
     TEnvProperty() : TProperty(P_ENV, EProperty::ENV,
                        "Container environment variables: <name>=<value>; ...") {}
 } static EnvProperty;
 
-TError TEnvProperty::Set(const std::string &env_val) {
-    TError error = IsAliveAndStopped();
+TError TEnvProperty::Set(TContainer &ct, const std::string &env_val) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -1051,24 +1181,24 @@ TError TEnvProperty::Set(const std::string &env_val) {
     if (error)
         return error;
 
-    env.Format(CurrentContainer->EnvCfg);
-    CurrentContainer->SetProp(EProperty::ENV);
+    env.Format(ct.EnvCfg);
+    ct.SetProp(EProperty::ENV);
 
     return TError::Success();
 }
 
-TError TEnvProperty::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->EnvCfg, ';');
+TError TEnvProperty::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.EnvCfg, ';');
     return TError::Success();
 }
 
-TError TEnvProperty::SetIndexed(const std::string &index, const std::string &env_val) {
-    TError error = IsAliveAndStopped();
+TError TEnvProperty::SetIndexed(TContainer &ct, const std::string &index, const std::string &env_val) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
     TEnv env;
-    error = env.Parse(CurrentContainer->EnvCfg, true);
+    error = env.Parse(ct.EnvCfg, true);
     if (error)
         return error;
 
@@ -1076,15 +1206,15 @@ TError TEnvProperty::SetIndexed(const std::string &index, const std::string &env
     if (error)
         return error;
 
-    env.Format(CurrentContainer->EnvCfg);
-    CurrentContainer->SetProp(EProperty::ENV);
+    env.Format(ct.EnvCfg);
+    ct.SetProp(EProperty::ENV);
 
     return TError::Success();
 }
 
-TError TEnvProperty::GetIndexed(const std::string &index, std::string &value) {
+TError TEnvProperty::GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
     TEnv env;
-    TError error = CurrentContainer->GetEnvironment(env);
+    TError error = ct.GetEnvironment(env);
     if (error)
         return error;
 
@@ -1096,15 +1226,15 @@ TError TEnvProperty::GetIndexed(const std::string &index, std::string &value) {
 
 class TBind : public TProperty {
 public:
-    TError Set(const std::string &bind_str);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &bind_str);
+    TError Get(TContainer &ct, std::string &value);
     TBind() : TProperty(P_BIND, EProperty::BIND,
                         "Share host directories with container: "
                         "<host_path> <container_path> [ro|rw]; ...") {}
 } static Bind;
 
-TError TBind::Set(const std::string &bind_str) {
-    TError error = IsAliveAndStopped();
+TError TBind::Set(TContainer &ct, const std::string &bind_str) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -1138,15 +1268,15 @@ TError TBind::Set(const std::string &bind_str) {
         bindMounts.push_back(bm);
     }
 
-    CurrentContainer->BindMounts = bindMounts;
-    CurrentContainer->SetProp(EProperty::BIND);
+    ct.BindMounts = bindMounts;
+    ct.SetProp(EProperty::BIND);
 
     return TError::Success();
 }
 
-TError TBind::Get(std::string &value) {
+TError TBind::Get(TContainer &ct, std::string &value) {
     std::vector<std::string> list;
-    for (const auto &bm : CurrentContainer->BindMounts)
+    for (const auto &bm : ct.BindMounts)
         list.push_back(bm.Source.ToString() + " " + bm.Dest.ToString() +
                        (bm.ReadOnly ? " ro" : bm.ReadWrite ? " rw" : ""));
     value = MergeEscapeStrings(list, ';');
@@ -1155,14 +1285,14 @@ TError TBind::Get(std::string &value) {
 
 class TIp : public TProperty {
 public:
-    TError Set(const std::string &ipaddr);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &ipaddr);
+    TError Get(TContainer &ct, std::string &value);
     TIp() : TProperty(P_IP, EProperty::IP,
                       "IP configuration: <interface> <ip>/<prefix>; ...") {}
 } static Ip;
 
-TError TIp::Set(const std::string &ipaddr) {
-    TError error = IsAliveAndStopped();
+TError TIp::Set(TContainer &ct, const std::string &ipaddr) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -1174,29 +1304,29 @@ TError TIp::Set(const std::string &ipaddr) {
     if (error)
         return error;
 
-    CurrentContainer->IpList = ipaddrs;
-    CurrentContainer->SetProp(EProperty::IP);
+    ct.IpList = ipaddrs;
+    ct.SetProp(EProperty::IP);
 
     return TError::Success();
 }
 
-TError TIp::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->IpList, ';');
+TError TIp::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.IpList, ';');
     return TError::Success();
 }
 
 class TDefaultGw : public TProperty {
 public:
-    TError Set(const std::string &gw);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &gw);
+    TError Get(TContainer &ct, std::string &value);
     TDefaultGw() : TProperty(P_DEFAULT_GW, EProperty::DEFAULT_GW,
                              "Default gateway: <interface> <ip>; ...") {
         IsHidden = true;
     }
 } static DefaultGw;
 
-TError TDefaultGw::Set(const std::string &gw) {
-    TError error = IsAliveAndStopped();
+TError TDefaultGw::Set(TContainer &ct, const std::string &gw) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
@@ -1208,67 +1338,67 @@ TError TDefaultGw::Set(const std::string &gw) {
     if (error)
         return error;
 
-    CurrentContainer->DefaultGw = gws;
-    CurrentContainer->SetProp(EProperty::DEFAULT_GW);
+    ct.DefaultGw = gws;
+    ct.SetProp(EProperty::DEFAULT_GW);
 
     return TError::Success();
 }
 
-TError TDefaultGw::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->DefaultGw, ';');
+TError TDefaultGw::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.DefaultGw, ';');
     return TError::Success();
 }
 
 class TResolvConf : public TProperty {
 public:
-    TError Set(const std::string &conf);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &conf);
+    TError Get(TContainer &ct, std::string &value);
     TResolvConf() : TProperty(P_RESOLV_CONF, EProperty::RESOLV_CONF,
                               "DNS resolver configuration: "
                               "<resolv.conf option>;...") {}
 } static ResolvConf;
 
-TError TResolvConf::Set(const std::string &conf_str) {
-    TError error = IsAliveAndStopped();
+TError TResolvConf::Set(TContainer &ct, const std::string &conf_str) {
+    TError error = IsAliveAndStopped(ct);
     if (error)
         return error;
 
     std::vector<std::string> conf;
     SplitEscapedString(conf_str, conf, ';');
 
-    CurrentContainer->ResolvConf = conf;
-    CurrentContainer->SetProp(EProperty::RESOLV_CONF);
+    ct.ResolvConf = conf;
+    ct.SetProp(EProperty::RESOLV_CONF);
 
     return TError::Success();
 }
 
-TError TResolvConf::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->ResolvConf, ';');
+TError TResolvConf::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.ResolvConf, ';');
     return TError::Success();
 }
 
 class TDevices : public TProperty {
 public:
-    TError Set(const std::string &dev);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &dev);
+    TError Get(TContainer &ct, std::string &value);
     TDevices() : TProperty(P_DEVICES, EProperty::DEVICES,
                                    "Devices that container can access: "
                                    "<device> [r][w][m][-] [name] [mode] "
                                    "[user] [group]; ...") {}
 } static Devices;
 
-TError TDevices::Set(const std::string &dev_str) {
+TError TDevices::Set(TContainer &ct, const std::string &dev_str) {
     std::vector<std::string> dev_list;
 
     SplitEscapedString(dev_str, dev_list, ';');
-    CurrentContainer->Devices = dev_list;
-    CurrentContainer->SetProp(EProperty::DEVICES);
+    ct.Devices = dev_list;
+    ct.SetProp(EProperty::DEVICES);
 
     return TError::Success();
 }
 
-TError TDevices::Get(std::string &value) {
-    value = MergeEscapeStrings(CurrentContainer->Devices, ';');
+TError TDevices::Get(TContainer &ct, std::string &value) {
+    value = MergeEscapeStrings(ct.Devices, ';');
     return TError::Success();
 }
 
@@ -1278,89 +1408,89 @@ public:
         IsReadOnly = true;
         IsHidden = true;
     }
-    TError Get(std::string &value) {
-        value = StringFormat("%d;%d;%d", CurrentContainer->Task.Pid,
-                                         CurrentContainer->TaskVPid,
-                                         CurrentContainer->WaitTask.Pid);
+    TError Get(TContainer &ct, std::string &value) {
+        value = StringFormat("%d;%d;%d", ct.Task.Pid,
+                                         ct.TaskVPid,
+                                         ct.WaitTask.Pid);
         return TError::Success();
     }
-    TError SetFromRestore(const std::string &value) {
+    TError SetFromRestore(TContainer &ct, const std::string &value) {
         std::vector<std::string> val;
         TError error;
 
         SplitEscapedString(value, val, ';');
         if (val.size() > 0)
-            error = StringToInt(val[0], CurrentContainer->Task.Pid);
+            error = StringToInt(val[0], ct.Task.Pid);
         else
-            CurrentContainer->Task.Pid = 0;
+            ct.Task.Pid = 0;
         if (!error && val.size() > 1)
-            error = StringToInt(val[1], CurrentContainer->TaskVPid);
+            error = StringToInt(val[1], ct.TaskVPid);
         else
-            CurrentContainer->TaskVPid = 0;
+            ct.TaskVPid = 0;
         if (!error && val.size() > 2)
-            error = StringToInt(val[2], CurrentContainer->WaitTask.Pid);
+            error = StringToInt(val[2], ct.WaitTask.Pid);
         else
-            CurrentContainer->WaitTask.Pid = CurrentContainer->Task.Pid;
+            ct.WaitTask.Pid = ct.Task.Pid;
         return error;
     }
 } static RawRootPid;
 
 class TRawLoopDev : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TRawLoopDev() : TProperty(P_RAW_LOOP_DEV, EProperty::LOOP_DEV, "") {
         IsReadOnly = true;
         IsHidden = true;
     }
 } static RawLoopDev;
 
-TError TRawLoopDev::SetFromRestore(const std::string &value) {
-    return StringToInt(value, CurrentContainer->LoopDev);
+TError TRawLoopDev::SetFromRestore(TContainer &ct, const std::string &value) {
+    return StringToInt(value, ct.LoopDev);
 }
 
-TError TRawLoopDev::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->LoopDev);
+TError TRawLoopDev::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.LoopDev);
 
     return TError::Success();
 }
 
 class TRawStartTime : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TRawStartTime() : TProperty(P_RAW_START_TIME, EProperty::START_TIME, "") {
         IsReadOnly = true;
         IsHidden = true;
     }
 } static RawStartTime;
 
-TError TRawStartTime::SetFromRestore(const std::string &value) {
-    return StringToUint64(value, CurrentContainer->StartTime);
+TError TRawStartTime::SetFromRestore(TContainer &ct, const std::string &value) {
+    return StringToUint64(value, ct.StartTime);
 }
 
-TError TRawStartTime::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->StartTime);
+TError TRawStartTime::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.StartTime);
 
     return TError::Success();
 }
 
 class TRawDeathTime : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TRawDeathTime() : TProperty(P_RAW_DEATH_TIME, EProperty::DEATH_TIME, "") {
         IsReadOnly = true;
         IsHidden = true;
     }
 } static RawDeathTime;
 
-TError TRawDeathTime::SetFromRestore(const std::string &value) {
-    return StringToUint64(value, CurrentContainer->DeathTime);
+TError TRawDeathTime::SetFromRestore(TContainer &ct, const std::string &value) {
+    return StringToUint64(value, ct.DeathTime);
 }
 
-TError TRawDeathTime::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->DeathTime);
+TError TRawDeathTime::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.DeathTime);
 
     return TError::Success();
 }
@@ -1369,30 +1499,30 @@ class TPortoNamespace : public TProperty {
 public:
     TPortoNamespace() : TProperty(P_PORTO_NAMESPACE, EProperty::PORTO_NAMESPACE,
             "Porto containers namespace (container name prefix)") {}
-    TError Get(std::string &value) {
-        value = CurrentContainer->NsName;
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.NsName;
         return TError::Success();
     }
-    TError Set(const std::string &value) {
-        TError error = IsAliveAndStopped();
+    TError Set(TContainer &ct, const std::string &value) {
+        TError error = IsAliveAndStopped(ct);
         if (error)
             return error;
-        CurrentContainer->NsName = value;
-        CurrentContainer->SetProp(EProperty::PORTO_NAMESPACE);
+        ct.NsName = value;
+        ct.SetProp(EProperty::PORTO_NAMESPACE);
         return TError::Success();
     }
 } static PortoNamespace;
 
 class TMemoryLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TMemoryLimit() : TProperty(P_MEM_LIMIT, EProperty::MEM_LIMIT,
                                "Memory hard limit [bytes] (dynamic)") {}
 } static MemoryLimit;
 
-TError TMemoryLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TMemoryLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1401,24 +1531,74 @@ TError TMemoryLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->MemLimit != new_size) {
-        CurrentContainer->MemLimit = new_size;
-        CurrentContainer->SetProp(EProperty::MEM_LIMIT);
+    if (ct.MemLimit != new_size) {
+        ct.MemLimit = new_size;
+        ct.SetProp(EProperty::MEM_LIMIT);
+    }
+
+    return TError::Success();
+}
+
+TError TMemoryLimit::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.MemLimit);
+
+    return TError::Success();
+}
+
+class TMemoryThreshold : public TProperty {
+public:
+    TError Set(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
+    TMemoryThreshold() : TProperty(P_MEM_THRESHOLD, EProperty::MEM_THRESHOLD,
+            "Notify waiters at memory usage crossing: <bytes>;... (dynamic)") {}
+} static MemoryThreshold;
+
+TError TMemoryThreshold::Set(TContainer &ct, const std::string &value) {
+    std::vector<std::string> list;
+    std::vector<uint64_t> thresholds;
+    TError error = IsAlive(ct);
+    if (error)
+        return error;
+
+    SplitEscapedString(value, list, ';');
+    for (auto &str: list) {
+        uint64_t size;
+
+        if (StringTrim(str).empty())
+            continue;
+        error = StringToSize(StringTrim(str), size);
+        if (error)
+            return error;
+        if (!size)
+            return TError(EError::InvalidValue, "Zero memory threshold");
+        thresholds.push_back(size);
+    }
+
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+
+    if (ct.MemThresholds != thresholds) {
+        ct.MemThresholds = thresholds;
+        ct.SetProp(EProperty::MEM_THRESHOLD);
     }
 
     return TError::Success();
 }
 
-TError TMemoryLimit::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->MemLimit);
+TError TMemoryThreshold::Get(TContainer &ct, std::string &value) {
+    std::vector<std::string> list;
+
+    for (auto threshold: ct.MemThresholds)
+        list.push_back(std::to_string(threshold));
+    value = MergeEscapeStrings(list, ';');
 
     return TError::Success();
 }
 
 class TAnonLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TAnonLimit() : TProperty(P_ANON_LIMIT, EProperty::ANON_LIMIT,
                              "Anonymous memory limit [bytes] (dynamic)") {}
     void Init(void) {
@@ -1427,8 +1607,8 @@ public:
 
 } static AnonLimit;
 
-TError TAnonLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TAnonLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1437,24 +1617,24 @@ TError TAnonLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->AnonMemLimit != new_size) {
-        CurrentContainer->AnonMemLimit = new_size;
-        CurrentContainer->SetProp(EProperty::ANON_LIMIT);
+    if (ct.AnonMemLimit != new_size) {
+        ct.AnonMemLimit = new_size;
+        ct.SetProp(EProperty::ANON_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TAnonLimit::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->AnonMemLimit);
+TError TAnonLimit::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.AnonMemLimit);
 
     return TError::Success();
 }
 
 class TDirtyLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TDirtyLimit() : TProperty(P_DIRTY_LIMIT, EProperty::DIRTY_LIMIT,
                               "Dirty file cache limit [bytes] "
                               "(dynamic)" ) {}
@@ -1463,8 +1643,8 @@ public:
     }
 } static DirtyLimit;
 
-TError TDirtyLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TDirtyLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1473,24 +1653,24 @@ TError TDirtyLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->DirtyMemLimit != new_size) {
-        CurrentContainer->DirtyMemLimit = new_size;
-        CurrentContainer->SetProp(EProperty::ANON_LIMIT);
+    if (ct.DirtyMemLimit != new_size) {
+        ct.DirtyMemLimit = new_size;
+        ct.SetProp(EProperty::ANON_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TDirtyLimit::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->DirtyMemLimit);
+TError TDirtyLimit::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.DirtyMemLimit);
 
     return TError::Success();
 }
 
 class TRechargeOnPgfault : public TProperty {
 public:
-    TError Set(const std::string &recharge);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &recharge);
+    TError Get(TContainer &ct, std::string &value);
     TRechargeOnPgfault() : TProperty(P_RECHARGE_ON_PGFAULT,
                                      EProperty::RECHARGE_ON_PGFAULT,
                                      "Recharge memory on "
@@ -1500,8 +1680,8 @@ public:
     }
 } static RechargeOnPgfault;
 
-TError TRechargeOnPgfault::Set(const std::string &recharge) {
-    TError error = IsAlive();
+TError TRechargeOnPgfault::Set(TContainer &ct, const std::string &recharge) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1513,31 +1693,31 @@ TError TRechargeOnPgfault::Set(const std::string &recharge) {
     else
         return TError(EError::InvalidValue, "Invalid bool value");
 
-    if (CurrentContainer->RechargeOnPgfault != new_val) {
-        CurrentContainer->RechargeOnPgfault = new_val;
-        CurrentContainer->SetProp(EProperty::RECHARGE_ON_PGFAULT);
+    if (ct.RechargeOnPgfault != new_val) {
+        ct.RechargeOnPgfault = new_val;
+        ct.SetProp(EProperty::RECHARGE_ON_PGFAULT);
     }
 
     return TError::Success();
 }
 
-TError TRechargeOnPgfault::Get(std::string &value) {
-    value = CurrentContainer->RechargeOnPgfault ? "true" : "false";
+TError TRechargeOnPgfault::Get(TContainer &ct, std::string &value) {
+    value = ct.RechargeOnPgfault ? "true" : "false";
 
     return TError::Success();
 }
 
 class TCpuLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TCpuLimit() : TProperty(P_CPU_LIMIT, EProperty::CPU_LIMIT,
                             "CPU limit: 0-100.0 [%] | 0.0c-<CPUS>c "
                             " [cores] (dynamic)") {}
 } static CpuLimit;
 
-TError TCpuLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TCpuLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1546,31 +1726,31 @@ TError TCpuLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->CpuLimit != new_limit) {
-        CurrentContainer->CpuLimit = new_limit;
-        CurrentContainer->SetProp(EProperty::CPU_LIMIT);
+    if (ct.CpuLimit != new_limit) {
+        ct.CpuLimit = new_limit;
+        ct.SetProp(EProperty::CPU_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TCpuLimit::Get(std::string &value) {
-    value = StringFormat("%lgc", CurrentContainer->CpuLimit);
+TError TCpuLimit::Get(TContainer &ct, std::string &value) {
+    value = StringFormat("%lgc", ct.CpuLimit);
 
     return TError::Success();
 }
 
 class TCpuGuarantee : public TProperty {
 public:
-    TError Set(const std::string &guarantee);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &guarantee);
+    TError Get(TContainer &ct, std::string &value);
     TCpuGuarantee() : TProperty(P_CPU_GUARANTEE, EProperty::CPU_GUARANTEE,
                                 "CPU guarantee: 0-100.0 [%] | "
                                 "0.0c-<CPUS>c [cores] (dynamic)") {}
 } static CpuGuarantee;
 
-TError TCpuGuarantee::Set(const std::string &guarantee) {
-    TError error = IsAlive();
+TError TCpuGuarantee::Set(TContainer &ct, const std::string &guarantee) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1579,24 +1759,123 @@ TError TCpuGuarantee::Set(const std::string &guarantee) {
     if (error)
         return error;
 
-    if (CurrentContainer->CpuGuarantee != new_guarantee) {
-        CurrentContainer->CpuGuarantee = new_guarantee;
-        CurrentContainer->SetProp(EProperty::CPU_GUARANTEE);
+    if (ct.CpuGuarantee != new_guarantee) {
+        ct.CpuGuarantee = new_guarantee;
+        ct.SetProp(EProperty::CPU_GUARANTEE);
     }
 
     return TError::Success();
 }
 
-TError TCpuGuarantee::Get(std::string &value) {
-    value = StringFormat("%lgc", CurrentContainer->CpuGuarantee);
+TError TCpuGuarantee::Get(TContainer &ct, std::string &value) {
+    value = StringFormat("%lgc", ct.CpuGuarantee);
+
+    return TError::Success();
+}
+
+class TCpuSet : public TProperty {
+public:
+    TError Set(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value) {
+        value = ct.CpuSet;
+        return TError::Success();
+    }
+    TCpuSet() : TProperty(P_CPU_SET, EProperty::CPU_SET,
+            "CPU set: [N|N-M,]... | node N | auto - pack by cpu_guarantee "
+            "into NUMA node (dynamic)") {}
+    void Init(void) {
+        IsSupported = CpusetSubsystem.Supported;
+    }
+} static CpuSet;
+
+TError TCpuSet::Set(TContainer &ct, const std::string &value) {
+    TError error = IsAlive(ct);
+    if (error)
+        return error;
+
+    std::string cpuset = StringTrim(value);
+
+    if (StringStartsWith(cpuset, "node ")) {
+        int node;
+
+        error = StringToInt(StringTrim(cpuset.substr(5)), node);
+        if (error)
+            return error;
+        if (node < 0 || node >= (int)CpusetSubsystem.NodeCpus.size() ||
+                CpusetSubsystem.NodeCpus[node].empty())
+            return TError(EError::InvalidValue, "Unknown NUMA node " + std::to_string(node));
+        cpuset = "node " + std::to_string(node);
+    } else if (cpuset != "" && cpuset != "auto") {
+        TBitMap cpus;
+
+        /* bitmap is sized by last cpu, don't let client choose it */
+        error = StringToBitMap(cpuset, cpus, get_nprocs_conf());
+        if (error)
+            return error;
+        if (std::find(cpus.begin(), cpus.end(), true) == cpus.end())
+            return TError(EError::InvalidValue, "Empty cpu set");
+        cpuset = BitMapToString(cpus);
+    }
+
+    if (ct.CpuSet != cpuset) {
+        ct.CpuSet = cpuset;
+        ct.SetProp(EProperty::CPU_SET);
+    }
 
     return TError::Success();
 }
 
+class TCpuSetAffinity : public TProperty {
+public:
+    TCpuSetAffinity() : TProperty(D_CPU_SET_AFFINITY, EProperty::NONE,
+            "current placement: cpus: <list>; mems: <nodes>; node: <N> (ro)") {
+        IsReadOnly = true;
+    }
+    void Init(void) {
+        IsSupported = CpusetSubsystem.Supported;
+    }
+    TError Get(TContainer &ct, std::string &value) {
+        TStringMap map;
+        TError error = GetMap(ct, map);
+        if (!error)
+            value = StringMapToString(map);
+        return error;
+    }
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        TStringMap map;
+        TError error = GetMap(ct, map);
+        if (error)
+            return error;
+        if (map.find(index) == map.end())
+            return TError(EError::InvalidValue, "invalid index " + index);
+        value = map[index];
+        return TError::Success();
+    }
+    TError GetMap(TContainer &ct, TStringMap &map) {
+        TCgroup cg = ct.GetCgroup(CpusetSubsystem);
+        TBitMap cpus;
+
+        TError error = IsRunning(ct);
+        if (error)
+            return error;
+
+        error = CpusetSubsystem.GetCpus(cg, cpus);
+        if (!error)
+            error = CpusetSubsystem.GetMems(cg, map["mems"]);
+        if (error)
+            return error;
+
+        map["cpus"] = BitMapToString(cpus);
+        if (ct.CpuSetNode >= 0)
+            map["node"] = std::to_string(ct.CpuSetNode);
+        return TError::Success();
+    }
+} static CpuSetAffinity;
+
 class TIoLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TIoLimit()  : TProperty(P_IO_LIMIT, EProperty::IO_LIMIT,
                             "Filesystem bandwidth limit [bytes/s] "
                             "(dynamic)") {}
@@ -1605,8 +1884,8 @@ public:
     }
 } static IoLimit;
 
-TError TIoLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TIoLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1615,24 +1894,24 @@ TError TIoLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->IoLimit != new_limit) {
-        CurrentContainer->IoLimit = new_limit;
-        CurrentContainer->SetProp(EProperty::IO_LIMIT);
+    if (ct.IoLimit != new_limit) {
+        ct.IoLimit = new_limit;
+        ct.SetProp(EProperty::IO_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TIoLimit::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->IoLimit);
+TError TIoLimit::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.IoLimit);
 
     return TError::Success();
 }
 
 class TIopsLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
     TIopsLimit() : TProperty(P_IO_OPS_LIMIT, EProperty::IO_OPS_LIMIT,
                              "Filesystem IOPS limit "
                              "[operations/s] (dynamic)") {}
@@ -1641,8 +1920,8 @@ public:
     }
 } static IopsLimit;
 
-TError TIopsLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TIopsLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1651,34 +1930,34 @@ TError TIopsLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->IopsLimit != new_limit) {
-        CurrentContainer->IopsLimit = new_limit;
-        CurrentContainer->SetProp(EProperty::IO_OPS_LIMIT);
+    if (ct.IopsLimit != new_limit) {
+        ct.IopsLimit = new_limit;
+        ct.SetProp(EProperty::IO_OPS_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TIopsLimit::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->IopsLimit);
+TError TIopsLimit::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.IopsLimit);
 
     return TError::Success();
 }
 
 class TNetGuarantee : public TProperty {
 public:
-    TError Set(const std::string &guarantee);
-    TError Get(std::string &value);
-    TError SetIndexed(const std::string &index, const std::string &guarantee);
-    TError GetIndexed(const std::string &index, std::string &value);
+    TError Set(TContainer &ct, const std::string &guarantee);
+    TError Get(TContainer &ct, std::string &value);
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &guarantee);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TNetGuarantee() : TProperty(P_NET_GUARANTEE, EProperty::NET_GUARANTEE,
                                 "Guaranteed container network "
                                 "bandwidth: <interface>|default "
                                 "<Bps>;... (dynamic)") {}
 } static NetGuarantee;
 
-TError TNetGuarantee::Set(const std::string &guarantee) {
-    TError error = IsAlive();
+TError TNetGuarantee::Set(TContainer &ct, const std::string &guarantee) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1687,21 +1966,21 @@ TError TNetGuarantee::Set(const std::string &guarantee) {
     if (error)
         return error;
 
-    if (CurrentContainer->NetGuarantee != new_guarantee) {
-        CurrentContainer->NetGuarantee = new_guarantee;
-        CurrentContainer->SetProp(EProperty::NET_GUARANTEE);
+    if (ct.NetGuarantee != new_guarantee) {
+        ct.NetGuarantee = new_guarantee;
+        ct.SetProp(EProperty::NET_GUARANTEE);
     }
 
     return TError::Success();
 }
 
-TError TNetGuarantee::Get(std::string &value) {
-    return UintMapToString(CurrentContainer->NetGuarantee, value);
+TError TNetGuarantee::Get(TContainer &ct, std::string &value) {
+    return UintMapToString(ct.NetGuarantee, value);
 }
 
-TError TNetGuarantee::SetIndexed(const std::string &index,
+TError TNetGuarantee::SetIndexed(TContainer &ct, const std::string &index,
                                           const std::string &guarantee) {
-    TError error = IsAlive();
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1710,40 +1989,40 @@ TError TNetGuarantee::SetIndexed(const std::string &index,
     if (error)
         return TError(EError::InvalidValue, "Invalid value " + guarantee);
 
-    if (CurrentContainer->NetGuarantee[index] != val) {
-        CurrentContainer->NetGuarantee[index] = val;
-        CurrentContainer->SetProp(EProperty::NET_GUARANTEE);
+    if (ct.NetGuarantee[index] != val) {
+        ct.NetGuarantee[index] = val;
+        ct.SetProp(EProperty::NET_GUARANTEE);
     }
 
     return TError::Success();
 }
 
-TError TNetGuarantee::GetIndexed(const std::string &index,
+TError TNetGuarantee::GetIndexed(TContainer &ct, const std::string &index,
                                           std::string &value) {
 
-    if (CurrentContainer->NetGuarantee.find(index) ==
-        CurrentContainer->NetGuarantee.end())
+    if (ct.NetGuarantee.find(index) ==
+        ct.NetGuarantee.end())
 
         return TError(EError::InvalidValue, "invalid index " + index);
 
-    value = std::to_string(CurrentContainer->NetGuarantee[index]);
+    value = std::to_string(ct.NetGuarantee[index]);
 
     return TError::Success();
 }
 
 class TNetLimit : public TProperty {
 public:
-    TError Set(const std::string &limit);
-    TError Get(std::string &value);
-    TError SetIndexed(const std::string &index, const std::string &limit);
-    TError GetIndexed(const std::string &index, std::string &value);
+    TError Set(TContainer &ct, const std::string &limit);
+    TError Get(TContainer &ct, std::string &value);
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &limit);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TNetLimit() : TProperty(P_NET_LIMIT, EProperty::NET_LIMIT,
                             "Maximum container network bandwidth: "
                             "<interface>|default <Bps>;... (dynamic)") {}
 } static NetLimit;
 
-TError TNetLimit::Set(const std::string &limit) {
-    TError error = IsAlive();
+TError TNetLimit::Set(TContainer &ct, const std::string &limit) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1752,21 +2031,21 @@ TError TNetLimit::Set(const std::string &limit) {
     if (error)
         return error;
 
-    if (CurrentContainer->NetLimit != new_limit) {
-        CurrentContainer->NetLimit = new_limit;
-        CurrentContainer->SetProp(EProperty::NET_LIMIT);
+    if (ct.NetLimit != new_limit) {
+        ct.NetLimit = new_limit;
+        ct.SetProp(EProperty::NET_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TNetLimit::Get(std::string &value) {
-    return UintMapToString(CurrentContainer->NetLimit, value);
+TError TNetLimit::Get(TContainer &ct, std::string &value) {
+    return UintMapToString(ct.NetLimit, value);
 }
 
-TError TNetLimit::SetIndexed(const std::string &index,
+TError TNetLimit::SetIndexed(TContainer &ct, const std::string &index,
                                       const std::string &limit) {
-    TError error = IsAlive();
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1775,41 +2054,41 @@ TError TNetLimit::SetIndexed(const std::string &index,
     if (error)
         return TError(EError::InvalidValue, "Invalid value " + limit);
 
-    if (CurrentContainer->NetLimit[index] != val) {
-        CurrentContainer->NetLimit[index] = val;
-        CurrentContainer->SetProp(EProperty::NET_LIMIT);
+    if (ct.NetLimit[index] != val) {
+        ct.NetLimit[index] = val;
+        ct.SetProp(EProperty::NET_LIMIT);
     }
 
     return TError::Success();
 }
 
-TError TNetLimit::GetIndexed(const std::string &index,
+TError TNetLimit::GetIndexed(TContainer &ct, const std::string &index,
                                       std::string &value) {
 
-    if (CurrentContainer->NetLimit.find(index) ==
-        CurrentContainer->NetLimit.end())
+    if (ct.NetLimit.find(index) ==
+        ct.NetLimit.end())
 
         return TError(EError::InvalidValue, "invalid index " + index);
 
-    value = std::to_string(CurrentContainer->NetLimit[index]);
+    value = std::to_string(ct.NetLimit[index]);
 
     return TError::Success();
 }
 
 class TNetPriority : public TProperty {
 public:
-    TError Set(const std::string &prio);
-    TError Get(std::string &value);
-    TError SetIndexed(const std::string &index, const std::string &prio);
-    TError GetIndexed(const std::string &index, std::string &value);
+    TError Set(TContainer &ct, const std::string &prio);
+    TError Get(TContainer &ct, std::string &value);
+    TError SetIndexed(TContainer &ct, const std::string &index, const std::string &prio);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TNetPriority()  : TProperty(P_NET_PRIO, EProperty::NET_PRIO,
                                 "Container network priority: "
                                 "<interface>|default 0-7;... "
                                 "(dynamic)") {}
 } static NetPriority;
 
-TError TNetPriority::Set(const std::string &prio) {
-    TError error = IsAlive();
+TError TNetPriority::Set(TContainer &ct, const std::string &prio) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1823,21 +2102,21 @@ TError TNetPriority::Set(const std::string &prio) {
             return TError(EError::InvalidValue, "invalid value");
     }
 
-    if (CurrentContainer->NetPriority != new_prio) {
-        CurrentContainer->NetPriority = new_prio;
-        CurrentContainer->SetProp(EProperty::NET_PRIO);
+    if (ct.NetPriority != new_prio) {
+        ct.NetPriority = new_prio;
+        ct.SetProp(EProperty::NET_PRIO);
     }
 
     return TError::Success();
 }
 
-TError TNetPriority::Get(std::string &value) {
-    return UintMapToString(CurrentContainer->NetPriority, value);
+TError TNetPriority::Get(TContainer &ct, std::string &value) {
+    return UintMapToString(ct.NetPriority, value);
 }
 
-TError TNetPriority::SetIndexed(const std::string &index,
+TError TNetPriority::SetIndexed(TContainer &ct, const std::string &index,
                                       const std::string &prio) {
-    TError error = IsAlive();
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1849,69 +2128,69 @@ TError TNetPriority::SetIndexed(const std::string &index,
     if (val > 7)
         return TError(EError::InvalidValue, "invalid value");
 
-    if (CurrentContainer->NetPriority[index] != val) {
-        CurrentContainer->NetPriority[index] = val;
-        CurrentContainer->SetProp(EProperty::NET_PRIO);
+    if (ct.NetPriority[index] != val) {
+        ct.NetPriority[index] = val;
+        ct.SetProp(EProperty::NET_PRIO);
     }
 
     return TError::Success();
 }
 
-TError TNetPriority::GetIndexed(const std::string &index,
+TError TNetPriority::GetIndexed(TContainer &ct, const std::string &index,
                                       std::string &value) {
 
-    if (CurrentContainer->NetPriority.find(index) ==
-        CurrentContainer->NetPriority.end())
+    if (ct.NetPriority.find(index) ==
+        ct.NetPriority.end())
 
         return TError(EError::InvalidValue, "invalid index " + index);
 
-    value = std::to_string(CurrentContainer->NetPriority[index]);
+    value = std::to_string(ct.NetPriority[index]);
 
     return TError::Success();
 }
 
 class TRespawn : public TProperty {
 public:
-    TError Set(const std::string &respawn);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &respawn);
+    TError Get(TContainer &ct, std::string &value);
     TRespawn() : TProperty(P_RESPAWN, EProperty::RESPAWN,
                            "Automatically respawn dead container (dynamic)") {}
 } static Respawn;
 
-TError TRespawn::Set(const std::string &respawn) {
-    TError error = IsAlive();
+TError TRespawn::Set(TContainer &ct, const std::string &respawn) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
     if (respawn == "true")
-        CurrentContainer->ToRespawn = true;
+        ct.ToRespawn = true;
     else if (respawn == "false")
-        CurrentContainer->ToRespawn = false;
+        ct.ToRespawn = false;
     else
         return TError(EError::InvalidValue, "Invalid bool value");
 
-    CurrentContainer->SetProp(EProperty::RESPAWN);
+    ct.SetProp(EProperty::RESPAWN);
 
     return TError::Success();
 }
 
-TError TRespawn::Get(std::string &value) {
-    value = CurrentContainer->ToRespawn ? "true" : "false";
+TError TRespawn::Get(TContainer &ct, std::string &value) {
+    value = ct.ToRespawn ? "true" : "false";
 
     return TError::Success();
 }
 
 class TMaxRespawns : public TProperty {
 public:
-    TError Set(const std::string &max);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &max);
+    TError Get(TContainer &ct, std::string &value);
     TMaxRespawns() : TProperty(P_MAX_RESPAWNS, EProperty::MAX_RESPAWNS,
                                "Limit respawn count for specific "
                                "container (dynamic)") {}
 } static MaxRespawns;
 
-TError TMaxRespawns::Set(const std::string &max) {
-    TError error = IsAlive();
+TError TMaxRespawns::Set(TContainer &ct, const std::string &max) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1919,28 +2198,28 @@ TError TMaxRespawns::Set(const std::string &max) {
     if (StringToInt(max, new_value))
         return TError(EError::InvalidValue, "Invalid integer value " + max);
 
-    CurrentContainer->MaxRespawns = new_value;
-    CurrentContainer->SetProp(EProperty::MAX_RESPAWNS);
+    ct.MaxRespawns = new_value;
+    ct.SetProp(EProperty::MAX_RESPAWNS);
 
     return TError::Success();
 }
 
-TError TMaxRespawns::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->MaxRespawns);
+TError TMaxRespawns::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.MaxRespawns);
 
     return TError::Success();
 }
 
 class TPrivate : public TProperty {
 public:
-    TError Set(const std::string &max);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &max);
+    TError Get(TContainer &ct, std::string &value);
     TPrivate() : TProperty(P_PRIVATE, EProperty::PRIVATE,
                            "User-defined property (dynamic)") {}
 } static Private;
 
-TError TPrivate::Set(const std::string &value) {
-    TError error = IsAlive();
+TError TPrivate::Set(TContainer &ct, const std::string &value) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1948,29 +2227,29 @@ TError TPrivate::Set(const std::string &value) {
     if (value.length() > max)
         return TError(EError::InvalidValue, "Value is too long");
 
-    CurrentContainer->Private = value;
+    ct.Private = value;
 
     return TError::Success();
 }
 
-TError TPrivate::Get(std::string &value) {
-    value = CurrentContainer->Private;
+TError TPrivate::Get(TContainer &ct, std::string &value) {
+    value = ct.Private;
 
     return TError::Success();
 }
 
 class TAgingTime : public TProperty {
 public:
-    TError Set(const std::string &time);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &time);
+    TError Get(TContainer &ct, std::string &value);
     TAgingTime() : TProperty(P_AGING_TIME, EProperty::AGING_TIME,
                              "After given number of seconds "
                              "container in dead state is "
                              "automatically removed (dynamic)") {}
 } static AgingTime;
 
-TError TAgingTime::Set(const std::string &time) {
-    TError error = IsAlive();
+TError TAgingTime::Set(TContainer &ct, const std::string &time) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
@@ -1979,14 +2258,14 @@ TError TAgingTime::Set(const std::string &time) {
     if (error)
         return error;
 
-    CurrentContainer->AgingTime = new_time;
-    CurrentContainer->SetProp(EProperty::AGING_TIME);
+    ct.AgingTime = new_time;
+    ct.SetProp(EProperty::AGING_TIME);
 
     return TError::Success();
 }
 
-TError TAgingTime::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->AgingTime);
+TError TAgingTime::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.AgingTime);
 
     return TError::Success();
 }
@@ -1995,8 +2274,8 @@ class TEnablePorto : public TProperty {
 public:
     TEnablePorto() : TProperty(P_ENABLE_PORTO, EProperty::ENABLE_PORTO,
             "Proto access level: false | read-only | child-only | true (dynamic)") {}
-    TError Get(std::string &value) {
-        switch (CurrentContainer->AccessLevel) {
+    TError Get(TContainer &ct, std::string &value) {
+        switch (ct.AccessLevel) {
             case EAccessLevel::None:
                 value = "false";
                 break;
@@ -2012,7 +2291,7 @@ public:
         }
         return TError::Success();
     }
-    TError Set(const std::string &value) {
+    TError Set(TContainer &ct, const std::string &value) {
         EAccessLevel level;
 
         if (value == "false")
@@ -2027,45 +2306,45 @@ public:
             return TError(EError::InvalidValue, "Unknown access level: " + value);
 
         if (level > EAccessLevel::ChildOnly) {
-            for (auto p = CurrentContainer->Parent; p; p = p->Parent)
+            for (auto p = ct.Parent; p; p = p->Parent)
                 if (p->AccessLevel < EAccessLevel::ChildOnly)
                     return TError(EError::Permission,
                             "Parent container has access lower than child");
         }
 
-        CurrentContainer->AccessLevel = level;
-        CurrentContainer->SetProp(EProperty::ENABLE_PORTO);
+        ct.AccessLevel = level;
+        ct.SetProp(EProperty::ENABLE_PORTO);
         return TError::Success();
     }
 } static EnablePorto;
 
 class TWeak : public TProperty {
 public:
-    TError Set(const std::string &weak);
-    TError Get(std::string &value);
+    TError Set(TContainer &ct, const std::string &weak);
+    TError Get(TContainer &ct, std::string &value);
     TWeak() : TProperty(P_WEAK, EProperty::WEAK,
                         "Destroy container when client disconnects (dynamic)") {}
 } static Weak;
 
-TError TWeak::Set(const std::string &weak) {
-    TError error = IsAlive();
+TError TWeak::Set(TContainer &ct, const std::string &weak) {
+    TError error = IsAlive(ct);
     if (error)
         return error;
 
     if (weak == "true")
-        CurrentContainer->IsWeak = true;
+        ct.IsWeak = true;
     else if (weak == "false")
-        CurrentContainer->IsWeak = false;
+        ct.IsWeak = false;
     else
         return TError(EError::InvalidValue, "Invalid bool value");
 
-    CurrentContainer->SetProp(EProperty::WEAK);
+    ct.SetProp(EProperty::WEAK);
 
     return TError::Success();
 }
 
-TError TWeak::Get(std::string &value) {
-    value = CurrentContainer->IsWeak ? "true" : "false";
+TError TWeak::Get(TContainer &ct, std::string &value) {
+    value = ct.IsWeak ? "true" : "false";
 
     return TError::Success();
 }
@@ -2074,7 +2353,7 @@ TError TWeak::Get(std::string &value) {
 
 class TAbsoluteName : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TAbsoluteName() : TProperty(D_ABSOLUTE_NAME, EProperty::NONE,
                                 "container name including "
                                 "porto namespaces (ro)") {
@@ -2082,19 +2361,19 @@ public:
     }
 } static AbsoluteName;
 
-TError TAbsoluteName::Get(std::string &value) {
-    if (CurrentContainer->IsRoot() || CurrentContainer->IsPortoRoot())
-        value = CurrentContainer->GetName();
+TError TAbsoluteName::Get(TContainer &ct, std::string &value) {
+    if (ct.IsRoot() || ct.IsPortoRoot())
+        value = ct.GetName();
     else
         value = std::string(PORTO_ROOT_CONTAINER) + "/" +
-                CurrentContainer->GetName();
+                ct.GetName();
 
     return TError::Success();
 }
 
 class TAbsoluteNamespace : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TAbsoluteNamespace() : TProperty(D_ABSOLUTE_NAMESPACE, EProperty::NONE,
                                      "container namespace "
                                      "including parent "
@@ -2103,23 +2382,23 @@ public:
     }
 } static AbsoluteNamespace;
 
-TError TAbsoluteNamespace::Get(std::string &value) {
+TError TAbsoluteNamespace::Get(TContainer &ct, std::string &value) {
     value = std::string(PORTO_ROOT_CONTAINER) + "/" +
-            CurrentContainer->GetPortoNamespace();
+            ct.GetPortoNamespace();
 
     return TError::Success();
 }
 
 class TState : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TState() : TProperty(D_STATE, EProperty::STATE, "container state (ro)") {
         IsReadOnly = true;
     }
 } static State;
 
-TError TState::SetFromRestore(const std::string &value) {
+TError TState::SetFromRestore(TContainer &ct, const std::string &value) {
     /*
      * We are just restoring value indication there.
      * The container must manually call SetState()
@@ -2127,25 +2406,25 @@ TError TState::SetFromRestore(const std::string &value) {
      */
 
     if (value == "stopped")
-        CurrentContainer->State = EContainerState::Stopped;
+        ct.State = EContainerState::Stopped;
     else if (value == "dead")
-        CurrentContainer->State = EContainerState::Dead;
+        ct.State = EContainerState::Dead;
     else if (value == "running")
-        CurrentContainer->State = EContainerState::Running;
+        ct.State = EContainerState::Running;
     else if (value == "paused")
-        CurrentContainer->State = EContainerState::Paused;
+        ct.State = EContainerState::Paused;
     else if (value == "meta")
-        CurrentContainer->State = EContainerState::Meta;
+        ct.State = EContainerState::Meta;
     else if (value == "unknown")
-        CurrentContainer->State  = EContainerState::Unknown;
+        ct.State  = EContainerState::Unknown;
     else
         return TError(EError::Unknown, "Invalid container saved state");
 
     return TError::Success();
 }
 
-TError TState::Get(std::string &value) {
-    value = CurrentContainer->ContainerStateName(CurrentContainer->GetState());
+TError TState::Get(TContainer &ct, std::string &value) {
+    value = ct.ContainerStateName(ct.GetState());
 
     return TError::Success();
 }
@@ -2156,24 +2435,24 @@ public:
                              "container has been killed by OOM (ro)") {
         IsReadOnly = true;
     }
-    TError SetFromRestore(const std::string &value) {
-        return StringToBool(value, CurrentContainer->OomKilled);
+    TError SetFromRestore(TContainer &ct, const std::string &value) {
+        return StringToBool(value, ct.OomKilled);
     }
-    TError GetToSave(std::string &value) {
-        value = BoolToString(CurrentContainer->OomKilled);
+    TError GetToSave(TContainer &ct, std::string &value) {
+        value = BoolToString(ct.OomKilled);
         return TError::Success();
     }
-    TError Get(std::string &value) {
-        TError error = IsDead();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsDead(ct);
         if (!error)
-            value = BoolToString(CurrentContainer->OomKilled);
+            value = BoolToString(ct.OomKilled);
         return error;
     }
 } static OomKilled;
 
 class TParent : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TParent() : TProperty(D_PARENT, EProperty::NONE,
                           "parent container name (ro) (deprecated)") {
         IsReadOnly = true;
@@ -2181,8 +2460,8 @@ public:
     }
 } static Parent;
 
-TError TParent::Get(std::string &value) {
-    auto p = CurrentContainer->GetParent();
+TError TParent::Get(TContainer &ct, std::string &value) {
+    auto p = ct.GetParent();
     value = p ? p->GetName() : "";
 
     return TError::Success();
@@ -2190,20 +2469,20 @@ TError TParent::Get(std::string &value) {
 
 class TRespawnCount : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TRespawnCount() : TProperty(D_RESPAWN_COUNT, EProperty::RESPAWN_COUNT,
                                 "current respawn count (ro)") {
         IsReadOnly = true;
     }
 } static RespawnCount;
 
-TError TRespawnCount::SetFromRestore(const std::string &value) {
-    return StringToUint64(value, CurrentContainer->RespawnCount);
+TError TRespawnCount::SetFromRestore(TContainer &ct, const std::string &value) {
+    return StringToUint64(value, ct.RespawnCount);
 }
 
-TError TRespawnCount::Get(std::string &value) {
-    value = std::to_string(CurrentContainer->RespawnCount);
+TError TRespawnCount::Get(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.RespawnCount);
 
     return TError::Success();
 }
@@ -2215,62 +2494,63 @@ public:
         IsHidden = true;
     }
 
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
-        value = std::to_string(CurrentContainer->GetPidFor(CurrentClient->Pid));
+        value = std::to_string(ct.GetPidFor(CurrentClient->Pid));
         return TError::Success();
     }
 } static RootPid;
 
 class TExitStatusProperty : public TProperty {
 public:
-    TError SetFromRestore(const std::string &value);
-    TError GetToSave(std::string &value);
-    TError Get(std::string &value);
+    TError SetFromRestore(TContainer &ct, const std::string &value);
+    TError GetToSave(TContainer &ct, std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TExitStatusProperty() : TProperty(D_EXIT_STATUS, EProperty::EXIT_STATUS,
                                       "container exit status (ro)") {
         IsReadOnly = true;
     }
 } static ExitStatusProperty;
 
-TError TExitStatusProperty::SetFromRestore(const std::string &value) {
-    return StringToInt(value, CurrentContainer->ExitStatus);
+TError TExitStatusProperty::SetFromRestore(TContainer &ct, const std::string &value) {
+    return StringToInt(value, ct.ExitStatus);
 }
 
-TError TExitStatusProperty::GetToSave(std::string &value) {
-    value = std::to_string(CurrentContainer->ExitStatus);
+TError TExitStatusProperty::GetToSave(TContainer &ct, std::string &value) {
+    value = std::to_string(ct.ExitStatus);
 
     return TError::Success();
 }
 
-TError TExitStatusProperty::Get(std::string &value) {
-    TError error = IsDead();
+TError TExitStatusProperty::Get(TContainer &ct, std::string &value) {
+    TError error = IsDead(ct);
     if (error)
         return error;
 
-    return GetToSave(value);
+    return GetToSave(ct, value);
 }
 
 class TMemUsage : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TMemUsage() : TProperty(D_MEMORY_USAGE, EProperty::NONE,
                             "current memory usage [bytes] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
     }
 } static MemUsage;
 
-TError TMemUsage::Get(std::string &value) {
-    TError error = IsRunning();
+TError TMemUsage::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(MemorySubsystem);
+    auto cg = ct.GetCgroup(MemorySubsystem);
 
     uint64_t val;
-    error = MemorySubsystem.Usage(cg, val);
+    error = ct.Knobs.GetUint64(cg, MemorySubsystem.USAGE, val);
     if (error) {
         L_ERR() << "Can't get memory usage: " << error << std::endl;
         return error;
@@ -2283,22 +2563,23 @@ TError TMemUsage::Get(std::string &value) {
 
 class TAnonUsage : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TAnonUsage() : TProperty(D_ANON_USAGE, EProperty::NONE,
                              "current anonymous memory usage [bytes] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
     }
 } static AnonUsage;
 
-TError TAnonUsage::Get(std::string &value) {
-    TError error = IsRunning();
+TError TAnonUsage::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(MemorySubsystem);
+    auto cg = ct.GetCgroup(MemorySubsystem);
     uint64_t val;
 
-    if (MemorySubsystem.GetAnonUsage(cg, val))
+    if (MemorySubsystem.GetAnonUsage(ct.Knobs, cg, val))
         value = "0";
     else
         value = std::to_string(val);
@@ -2308,58 +2589,63 @@ TError TAnonUsage::Get(std::string &value) {
 
 class TMinorFaults : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TMinorFaults() : TProperty(D_MINOR_FAULTS, EProperty::NONE, "minor page faults (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static MinorFaults;
 
-TError TMinorFaults::Get(std::string &value) {
-    TError error = IsRunning();
+TError TMinorFaults::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(MemorySubsystem);
-    TUintMap stat;
+    auto cg = ct.GetCgroup(MemorySubsystem);
+    TUintField stat[] = { { "total_pgfault" }, { "total_pgmajfault" } };
 
-    if (MemorySubsystem.Statistics(cg, stat))
+    if (ct.Knobs.GetFields(cg, MemorySubsystem.STAT, stat))
         value = "-1";
     else
-        value = std::to_string(stat["total_pgfault"] - stat["total_pgmajfault"]);
+        value = std::to_string(stat[0].Value - stat[1].Value);
 
     return TError::Success();
 }
 
 class TMajorFaults : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TMajorFaults() : TProperty(D_MAJOR_FAULTS, EProperty::NONE, "major page faults (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static MajorFaults;
 
-TError TMajorFaults::Get(std::string &value) {
-    TError error = IsRunning();
+TError TMajorFaults::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(MemorySubsystem);
-    TUintMap stat;
+    auto cg = ct.GetCgroup(MemorySubsystem);
+    TUintField stat[] = { { "total_pgmajfault" } };
 
-    if (MemorySubsystem.Statistics(cg, stat))
+    if (ct.Knobs.GetFields(cg, MemorySubsystem.STAT, stat))
         value = "-1";
     else
-        value = std::to_string(stat["total_pgmajfault"]);
+        value = std::to_string(stat[0].Value);
 
     return TError::Success();
 }
 
 class TMaxRss : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TMaxRss() : TProperty(D_MAX_RSS, EProperty::NONE,
                           "peak anonymous memory usage [bytes] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
     }
     void Init(void) {
         TCgroup rootCg = MemorySubsystem.RootCgroup();
@@ -2370,38 +2656,100 @@ public:
     }
 } static MaxRss;
 
-TError TMaxRss::Get(std::string &value) {
-    TError error = IsRunning();
+TError TMaxRss::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(MemorySubsystem);
-    TUintMap stat;
-    if (MemorySubsystem.Statistics(cg, stat))
+    auto cg = ct.GetCgroup(MemorySubsystem);
+    TUintField stat[] = { { "total_max_rss" } };
+    if (ct.Knobs.GetFields(cg, MemorySubsystem.STAT, stat))
         value = "-1";
     else
-        value = std::to_string(stat["total_max_rss"]);
+        value = std::to_string(stat[0].Value);
 
     return TError::Success();
 }
 
+class TMemoryPressure : public TProperty {
+public:
+    TMemoryPressure() : TProperty(D_MEMORY_PRESSURE, EProperty::NONE,
+            "memory pressure events since start: <level>: <count>;... (ro)") {
+        IsReadOnly = true;
+    }
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
+        if (error)
+            return error;
+        return UintMapToString(ct.MemPressureCount, value);
+    }
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        TError error = IsRunning(ct);
+        if (error)
+            return error;
+        auto it = ct.MemPressureCount.find(index);
+        if (it == ct.MemPressureCount.end())
+            return TError(EError::InvalidValue, "invalid index " + index);
+        value = std::to_string(it->second);
+        return TError::Success();
+    }
+} static MemoryPressure;
+
+class TStartProfile : public TProperty {
+public:
+    TStartProfile() : TProperty(D_START_PROFILE, EProperty::NONE,
+            "duration of last start phases: <phase>: <microseconds>;... (ro)") {
+        IsReadOnly = true;
+    }
+    TError Get(TContainer &ct, std::string &value) {
+        return UintMapToString(ct.StartProfile, value);
+    }
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        auto it = ct.StartProfile.find(index);
+        if (it == ct.StartProfile.end())
+            return TError(EError::InvalidValue, "invalid index " + index);
+        value = std::to_string(it->second);
+        return TError::Success();
+    }
+} static StartProfile;
+
+class TExecStatus : public TProperty {
+public:
+    TExecStatus() : TProperty(D_EXEC_STATUS, EProperty::NONE,
+            "exit status of recent exec processes: <pid>: <status>;... (ro)") {
+        IsReadOnly = true;
+    }
+    TError Get(TContainer &ct, std::string &value) {
+        return UintMapToString(ct.ExecStatus, value);
+    }
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        auto it = ct.ExecStatus.find(index);
+        if (it == ct.ExecStatus.end())
+            return TError(EError::InvalidValue, "invalid index " + index);
+        value = std::to_string(it->second);
+        return TError::Success();
+    }
+} static ExecStatus;
+
 class TCpuUsage : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TCpuUsage() : TProperty(D_CPU_USAGE, EProperty::NONE, "consumed CPU time [nanoseconds] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static CpuUsage;
 
-TError TCpuUsage::Get(std::string &value) {
-    TError error = IsRunning();
+TError TCpuUsage::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(CpuacctSubsystem);
+    auto cg = ct.GetCgroup(CpuacctSubsystem);
 
     uint64_t val;
-    error = CpuacctSubsystem.Usage(cg, val);
+    error = ct.Knobs.GetUint64(cg, "cpuacct.usage", val);
 
     if (error) {
         L_ERR() << "Can't get CPU usage: " << error << std::endl;
@@ -2415,22 +2763,24 @@ TError TCpuUsage::Get(std::string &value) {
 
 class TCpuSystem : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TCpuSystem() : TProperty(D_CPU_SYSTEM, EProperty::NONE,
                              "consumed system CPU time [nanoseconds] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static CpuSystem;
 
-TError TCpuSystem::Get(std::string &value) {
-    TError error = IsRunning();
+TError TCpuSystem::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    auto cg = CurrentContainer->GetCgroup(CpuacctSubsystem);
+    auto cg = ct.GetCgroup(CpuacctSubsystem);
 
     uint64_t val;
-    error = CpuacctSubsystem.SystemUsage(cg, val);
+    error = CpuacctSubsystem.SystemUsage(ct.Knobs, cg, val);
 
     if (error) {
         L_ERR() << "Can't get system CPU usage: " << error << std::endl;
@@ -2450,25 +2800,27 @@ public:
             TProperty(name, EProperty::NONE, desc) {
         Kind = kind;
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 
-    TError Get(std::string &value) {
-        TError error = IsRunning();
+    TError Get(TContainer &ct, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
         TUintMap stat;
-        error = CurrentContainer->GetNetStat(Kind, stat);
+        error = ct.GetNetStat(Kind, stat);
         if (error)
             return error;
         return UintMapToString(stat, value);
     }
 
-    TError GetIndexed(const std::string &index, std::string &value) {
-        TError error = IsRunning();
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+        TError error = IsRunning(ct);
         if (error)
             return error;
         TUintMap stat;
-        error = CurrentContainer->GetNetStat(Kind, stat);
+        error = ct.GetNetStat(Kind, stat);
         if (error)
             return error;
         if (stat.find(index) == stat.end())
@@ -2493,50 +2845,52 @@ TNetStat NetTxDrops(D_NET_TX_DROPS, ENetStat::TxDrops, "device tx drops: <interf
 
 class TIoRead : public TProperty {
 public:
-    void Populate(TUintMap &m);
-    TError Get(std::string &value);
-    TError GetIndexed(const std::string &index, std::string &value);
+    void Populate(TContainer &ct, TUintMap &m);
+    TError Get(TContainer &ct, std::string &value);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TIoRead() : TProperty(D_IO_READ, EProperty::NONE, "read from disk [bytes] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static IoRead;
 
-void TIoRead::Populate(TUintMap &m) {
-    auto memCg = CurrentContainer->GetCgroup(MemorySubsystem);
-    auto blkCg = CurrentContainer->GetCgroup(BlkioSubsystem);
-    TUintMap memStat;
+void TIoRead::Populate(TContainer &ct, TUintMap &m) {
+    auto memCg = ct.GetCgroup(MemorySubsystem);
+    auto blkCg = ct.GetCgroup(BlkioSubsystem);
+    TUintField memStat[] = { { "fs_io_bytes" }, { "fs_io_write_bytes" } };
 
-    TError error = MemorySubsystem.Statistics(memCg, memStat);
+    TError error = ct.Knobs.GetFields(memCg, MemorySubsystem.STAT, memStat);
     if (!error)
-        m["fs"] = memStat["fs_io_bytes"] - memStat["fs_io_write_bytes"];
+        m["fs"] = memStat[0].Value - memStat[1].Value;
 
     std::vector<BlkioStat> blkStat;
-    error = BlkioSubsystem.Statistics(blkCg, "blkio.io_service_bytes_recursive", blkStat);
+    error = ct.Knobs.GetBlkio(blkCg, "blkio.io_service_bytes_recursive", blkStat);
     if (!error) {
         for (auto &s : blkStat)
             m[s.Device] = s.Read;
     }
 }
 
-TError TIoRead::Get(std::string &value) {
-    TError error = IsRunning();
+TError TIoRead::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     return UintMapToString(m, value);
 }
 
-TError TIoRead::GetIndexed(const std::string &index,
+TError TIoRead::GetIndexed(TContainer &ct, const std::string &index,
                                     std::string &value) {
-    TError error = IsRunning();
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     if (m.find(index) == m.end())
         return TError(EError::InvalidValue, "Invalid subscript for property");
@@ -2548,25 +2902,27 @@ TError TIoRead::GetIndexed(const std::string &index,
 
 class TIoWrite : public TProperty {
 public:
-    void Populate(TUintMap &m);
-    TError Get(std::string &value);
-    TError GetIndexed(const std::string &index, std::string &value);
+    void Populate(TContainer &ct, TUintMap &m);
+    TError Get(TContainer &ct, std::string &value);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TIoWrite() : TProperty(D_IO_WRITE, EProperty::NONE, "written to disk [bytes] (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static IoWrite;
 
-void TIoWrite::Populate(TUintMap &m) {
-    auto memCg = CurrentContainer->GetCgroup(MemorySubsystem);
-    auto blkCg = CurrentContainer->GetCgroup(BlkioSubsystem);
-    TUintMap memStat;
+void TIoWrite::Populate(TContainer &ct, TUintMap &m) {
+    auto memCg = ct.GetCgroup(MemorySubsystem);
+    auto blkCg = ct.GetCgroup(BlkioSubsystem);
+    TUintField memStat[] = { { "fs_io_write_bytes" } };
 
-    TError error = MemorySubsystem.Statistics(memCg, memStat);
+    TError error = ct.Knobs.GetFields(memCg, MemorySubsystem.STAT, memStat);
     if (!error)
-        m["fs"] = memStat["fs_io_write_bytes"];
+        m["fs"] = memStat[0].Value;
 
     std::vector<BlkioStat> blkStat;
-    error = BlkioSubsystem.Statistics(blkCg, "blkio.io_service_bytes_recursive", blkStat);
+    error = ct.Knobs.GetBlkio(blkCg, "blkio.io_service_bytes_recursive", blkStat);
     if (!error) {
         for (auto &s : blkStat)
             m[s.Device] = s.Write;
@@ -2574,24 +2930,24 @@ void TIoWrite::Populate(TUintMap &m) {
 
 }
 
-TError TIoWrite::Get(std::string &value) {
-    TError error = IsRunning();
+TError TIoWrite::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     return UintMapToString(m, value);
 }
 
-TError TIoWrite::GetIndexed(const std::string &index, std::string &value) {
-    TError error = IsRunning();
+TError TIoWrite::GetIndexed(TContainer &ct, const std::string &index, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     if (m.find(index) == m.end())
         return TError(EError::InvalidValue, "Invalid subscript for property");
@@ -2603,50 +2959,52 @@ TError TIoWrite::GetIndexed(const std::string &index, std::string &value) {
 
 class TIoOps : public TProperty {
 public:
-    void Populate(TUintMap &m);
-    TError Get(std::string &value);
-    TError GetIndexed(const std::string &index, std::string &value);
+    void Populate(TContainer &ct, TUintMap &m);
+    TError Get(TContainer &ct, std::string &value);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TIoOps() : TProperty(D_IO_OPS, EProperty::NONE, "io operations (ro)") {
         IsReadOnly = true;
+        IsSampled = true;
+        IsCounter = true;
     }
 } static IoOps;
 
-void TIoOps::Populate(TUintMap &m) {
-    auto memCg = CurrentContainer->GetCgroup(MemorySubsystem);
-    auto blkCg = CurrentContainer->GetCgroup(BlkioSubsystem);
-    TUintMap memStat;
+void TIoOps::Populate(TContainer &ct, TUintMap &m) {
+    auto memCg = ct.GetCgroup(MemorySubsystem);
+    auto blkCg = ct.GetCgroup(BlkioSubsystem);
+    TUintField memStat[] = { { "fs_io_operations" } };
 
-    TError error = MemorySubsystem.Statistics(memCg, memStat);
+    TError error = ct.Knobs.GetFields(memCg, MemorySubsystem.STAT, memStat);
     if (!error)
-        m["fs"] = memStat["fs_io_operations"];
+        m["fs"] = memStat[0].Value;
 
     std::vector<BlkioStat> blkStat;
-    error = BlkioSubsystem.Statistics(blkCg, "blkio.io_service_bytes_recursive", blkStat);
+    error = ct.Knobs.GetBlkio(blkCg, "blkio.io_service_bytes_recursive", blkStat);
     if (!error) {
         for (auto &s : blkStat)
             m[s.Device] = s.Read + s.Write;
     }
 }
 
-TError TIoOps::Get(std::string &value) {
-    TError error = IsRunning();
+TError TIoOps::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     return UintMapToString(m, value);
 }
 
-TError TIoOps::GetIndexed(const std::string &index,
+TError TIoOps::GetIndexed(TContainer &ct, const std::string &index,
                                    std::string &value) {
-    TError error = IsRunning();
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     if (m.find(index) == m.end())
         return TError(EError::InvalidValue, "Invalid subscript for property");
@@ -2658,18 +3016,18 @@ TError TIoOps::GetIndexed(const std::string &index,
 
 class TTime : public TProperty {
 public:
-    TError Get(std::string &value);
+    TError Get(TContainer &ct, std::string &value);
     TTime() : TProperty(D_TIME, EProperty::NONE, "running time [seconds] (ro)") {
         IsReadOnly = true;
     }
 } static Time;
 
-TError TTime::Get(std::string &value) {
-    TError error = IsRunning();
+TError TTime::Get(TContainer &ct, std::string &value) {
+    TError error = IsRunning(ct);
     if (error)
         return error;
 
-    if (CurrentContainer->IsRoot()) {
+    if (ct.IsRoot()) {
         struct sysinfo si;
         int ret = sysinfo(&si);
         if (ret)
@@ -2682,40 +3040,40 @@ TError TTime::Get(std::string &value) {
 
     // we started recording raw start/death time since porto v1.15;
     // in case we updated from old version, return zero
-    if (!CurrentContainer->HasProp(EProperty::START_TIME)) {
-        CurrentContainer->StartTime = GetCurrentTimeMs();
-        CurrentContainer->SetProp(EProperty::START_TIME);
+    if (!ct.HasProp(EProperty::START_TIME)) {
+        ct.StartTime = GetCurrentTimeMs();
+        ct.SetProp(EProperty::START_TIME);
     }
 
-    if (!CurrentContainer->HasProp(EProperty::DEATH_TIME) &&
-        (CurrentContainer->GetState() == EContainerState::Dead)) {
+    if (!ct.HasProp(EProperty::DEATH_TIME) &&
+        (ct.GetState() == EContainerState::Dead)) {
 
-        CurrentContainer->DeathTime = GetCurrentTimeMs();
-        CurrentContainer->SetProp(EProperty::DEATH_TIME);
+        ct.DeathTime = GetCurrentTimeMs();
+        ct.SetProp(EProperty::DEATH_TIME);
     }
 
-    if (CurrentContainer->GetState() == EContainerState::Dead)
-        value = std::to_string((CurrentContainer->DeathTime -
-                               CurrentContainer->StartTime) / 1000);
+    if (ct.GetState() == EContainerState::Dead)
+        value = std::to_string((ct.DeathTime -
+                               ct.StartTime) / 1000);
     else
         value = std::to_string((GetCurrentTimeMs() -
-                               CurrentContainer->StartTime) / 1000);
+                               ct.StartTime) / 1000);
 
     return TError::Success();
 }
 
 class TPortoStat : public TProperty {
 public:
-    void Populate(TUintMap &m);
-    TError Get(std::string &value);
-    TError GetIndexed(const std::string &index, std::string &value);
+    void Populate(TContainer &ct, TUintMap &m);
+    TError Get(TContainer &ct, std::string &value);
+    TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
     TPortoStat() : TProperty(D_PORTO_STAT, EProperty::NONE, "porto statistics (ro)") {
         IsReadOnly = true;
         IsHidden = true;
     }
 } static PortoStat;
 
-void TPortoStat::Populate(TUintMap &m) {
+void TPortoStat::Populate(TContainer &ct, TUintMap &m) {
     m["spawned"] = Statistics->Spawned;
     m["errors"] = Statistics->Errors;
     m["warnings"] = Statistics->Warns;
@@ -2729,7 +3087,7 @@ void TPortoStat::Populate(TUintMap &m) {
     m["rotated"] = Statistics->Rotated;
     m["restore_failed"] = Statistics->RestoreFailed;
     m["started"] = Statistics->Started;
-    m["running"] = CurrentContainer->GetRunningChildren();
+    m["running"] = ct.GetRunningChildren();
     uint64_t usage = 0;
     auto cg = MemorySubsystem.Cgroup(PORTO_DAEMON_CGROUP);
     TError error = MemorySubsystem.Usage(cg, usage);
@@ -2742,19 +3100,36 @@ void TPortoStat::Populate(TUintMap &m) {
     m["clients"] = Statistics->Clients;
     m["requests_queued"] = Statistics->RequestsQueued;
     m["requests_completed"] = Statistics->RequestsCompleted;
-}
-
-TError TPortoStat::Get(std::string &value) {
+    m["stat_samples"] = Statistics->StatSamples;
+    m["stat_sample_hits"] = Statistics->StatSampleHits;
+    m["cgroup_reads"] = Statistics->CgroupReads;
+    m["cgroup_reads_memoized"] = Statistics->CgroupReadsMemoized;
+    m["cgroups_deferred"] = Statistics->CgroupsDeferred;
+    m["cgroups_reaped"] = Statistics->CgroupsReaped;
+    m["cgroups_leaked"] = Statistics->CgroupsLeaked;
+    m["teardown_queued"] = Statistics->TeardownQueued;
+    m["memory_pressure_events"] = Statistics->MemPressureEvents;
+    m["memory_threshold_events"] = Statistics->MemThresholdEvents;
+    m["spawner_starts"] = Statistics->SpawnerStarts;
+    m["warm_cgroup_hits"] = Statistics->WarmCgroupHits;
+    m["warm_cgroup_misses"] = Statistics->WarmCgroupMisses;
+    m["warm_netns_hits"] = Statistics->WarmNetnsHits;
+    m["warm_netns_misses"] = Statistics->WarmNetnsMisses;
+    m["exec_starts"] = Statistics->ExecStarts;
+    m["log_lines_lost"] = Statistics->LogLinesLost;
+}
+
+TError TPortoStat::Get(TContainer &ct, std::string &value) {
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     return UintMapToString(m, value);
 }
 
-TError TPortoStat::GetIndexed(const std::string &index,
+TError TPortoStat::GetIndexed(TContainer &ct, const std::string &index,
                                        std::string &value) {
     TUintMap m;
-    Populate(m);
+    Populate(ct, m);
 
     if (m.find(index) == m.end())
         return TError(EError::InvalidValue, "Invalid subscript for property");
@@ -2766,10 +3141,10 @@ TError TPortoStat::GetIndexed(const std::string &index,
 
 class TNetTos : public TProperty {
 public:
-    TError Set(const std::string &tos) {
+    TError Set(TContainer &ct, const std::string &tos) {
         return TError(EError::NotSupported, Name + " is not supported");
     }
-    TError Get(std::string &value) {
+    TError Get(TContainer &ct, std::string &value) {
         return TError(EError::NotSupported, "Not supported: " + Name);
     }
     TNetTos() : TProperty(P_NET_TOS, EProperty::NET_TOS, "IP TOS") {
@@ -2786,13 +3161,26 @@ public:
                                  "in hierarchy") {
         IsReadOnly = true;
     }
-    TError Get(std::string &value) {
-       value = std::to_string(CurrentContainer->GetTotalMemLimit());
+    TError Get(TContainer &ct, std::string &value) {
+       value = std::to_string(ct.GetTotalMemLimit());
        return TError::Success();
     }
 } static MemTotalLimit;
 
-void InitContainerProperties(void) {
-    for (auto prop: ContainerProperties)
+TError InitContainerProperties(void) {
+    for (auto prop: ContainerProperties) {
         prop.second->Init();
+
+        if (prop.second->IsSampled && prop.second->IsSupported) {
+            prop.second->SampleIndex = SampledProperties.size();
+            SampledProperties.push_back(prop.second);
+
+            if (prop.second->IsCounter) {
+                prop.second->CounterIndex = CounterProperties.size();
+                CounterProperties.push_back(prop.second);
+            }
+        }
+    }
+
+    return PropertyIndex.Build(ContainerProperties);
 }
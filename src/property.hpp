@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include "common.hpp"
 
 constexpr const char *P_RAW_ROOT_PID = "_root_pid";
@@ -23,13 +24,16 @@ constexpr const char *P_STDIN_PATH = "stdin_path";
 constexpr const char *P_STDOUT_PATH = "stdout_path";
 constexpr const char *P_STDERR_PATH = "stderr_path";
 constexpr const char *P_STDOUT_LIMIT = "stdout_limit";
+constexpr const char *P_STREAM_MEMORY = "stream_memory";
 constexpr const char *P_MEM_GUARANTEE = "memory_guarantee";
 constexpr const char *P_MEM_LIMIT = "memory_limit";
+constexpr const char *P_MEM_THRESHOLD = "memory_threshold";
 constexpr const char *P_DIRTY_LIMIT = "dirty_limit";
 constexpr const char *P_ANON_LIMIT = "anon_limit";
 constexpr const char *P_RECHARGE_ON_PGFAULT = "recharge_on_pgfault";
 constexpr const char *P_CPU_POLICY = "cpu_policy";
 constexpr const char *P_CPU_GUARANTEE = "cpu_guarantee";
+constexpr const char *P_CPU_SET = "cpu_set";
 constexpr const char *P_CPU_LIMIT = "cpu_limit";
 constexpr const char *P_IO_POLICY = "io_policy";
 constexpr const char *P_IO_LIMIT = "io_limit";
@@ -77,6 +81,10 @@ constexpr const char *D_ANON_USAGE = "anon_usage";
 constexpr const char *D_MINOR_FAULTS = "minor_faults";
 constexpr const char *D_MAJOR_FAULTS = "major_faults";
 constexpr const char *D_MAX_RSS = "max_rss";
+constexpr const char *D_MEMORY_PRESSURE = "memory_pressure";
+constexpr const char *D_CPU_SET_AFFINITY = "cpu_set_affinity";
+constexpr const char *D_START_PROFILE = "start_profile";
+constexpr const char *D_EXEC_STATUS = "exec_status";
 constexpr const char *D_CPU_USAGE = "cpu_usage";
 constexpr const char *D_CPU_SYSTEM = "cpu_usage_system";
 constexpr const char *D_NET_BYTES = "net_bytes";
@@ -153,6 +161,9 @@ enum class EProperty {
     EXIT_STATUS,
     CAPABILITIES_AMBIENT,
     UMASK,
+    MEM_THRESHOLD,
+    CPU_SET,
+    STREAM_MEMORY,
     NR_PROPERTIES,
 };
 
@@ -162,35 +173,88 @@ constexpr int VIRT_MODE_APP = 0;
 constexpr int VIRT_MODE_OS = 1;
 constexpr const char *P_CMD_VIRT_MODE_OS = "/sbin/init";
 
+class TContainer;
+
 class TProperty {
 public:
     std::string Name;
     EProperty Prop;
+    uint32_t Id;    /* stable wire id, hash of name */
     std::string Desc;
     bool IsSupported = true;
     bool IsReadOnly = false;
     bool IsHidden = false;
-    TError IsAliveAndStopped(void);
-    TError IsAlive(void);
-    TError IsDead(void);
-    TError IsRunning(void);
+    bool IsSampled = false;     /* refreshed by statistics sampler */
+    int SampleIndex = -1;
+    bool IsCounter = false;     /* sampler keeps history for rates */
+    int CounterIndex = -1;
+    TError IsAliveAndStopped(TContainer &ct);
+    TError IsAlive(TContainer &ct);
+    TError IsDead(TContainer &ct);
+    TError IsRunning(TContainer &ct);
 
     TProperty(std::string name, EProperty prop, std::string desc);
 
     virtual void Init(void) {}
 
-    virtual TError Get(std::string &value) = 0;
-    virtual TError Set(const std::string &value);
+    virtual TError Get(TContainer &ct, std::string &value) = 0;
+    virtual TError Set(TContainer &ct, const std::string &value);
 
-    virtual TError GetIndexed(const std::string &index, std::string &value);
-    virtual TError SetIndexed(const std::string &index, const std::string &value);
+    virtual TError GetIndexed(TContainer &ct, const std::string &index, std::string &value);
+    virtual TError SetIndexed(TContainer &ct, const std::string &index, const std::string &value);
 
-    virtual TError GetToSave(std::string &value);
-    virtual TError SetFromRestore(const std::string &value);
+    virtual TError GetToSave(TContainer &ct, std::string &value);
+    virtual TError SetFromRestore(TContainer &ct, const std::string &value);
 };
 
-void InitContainerProperties(void);
+/*
+ * Perfect hash over property ids, built once after registration.
+ * Bucket of id selects displacement, displacement selects unique slot.
+ */
+class TPropertyIndex {
+    uint32_t BucketMask = 0;
+    uint32_t SlotMask = 0;
+    std::vector<uint32_t> Displace;
+    std::vector<TProperty *> Slots;
+
+    /* probes per bucket and table sparseness before giving up */
+    static constexpr uint32_t MAX_DISPLACE = 1 << 16;
+    static constexpr uint32_t MAX_SCALE = 16;
+
+    uint32_t Slot(uint32_t id) const;
+    bool TryBuild(const std::map<std::string, TProperty *> &props, uint32_t scale);
+
+public:
+    static uint32_t Hash(const char *name, size_t len);
+    static uint32_t Hash(const std::string &name) {
+        return Hash(name.data(), name.size());
+    }
+
+    /* Fails with ResourceNotAvailable if ids collide or probes exhausted */
+    TError Build(const std::map<std::string, TProperty *> &props);
+
+    TProperty *Find(uint32_t id) const {
+        if (Slots.empty())
+            return nullptr;
+        TProperty *prop = Slots[Slot(id)];
+        return prop && prop->Id == id ? prop : nullptr;
+    }
+
+    /* name isn't required to be terminated, e.g. prefix of "name[index]" */
+    TProperty *Find(const char *name, size_t len) const {
+        TProperty *prop = Find(Hash(name, len));
+        return prop && prop->Name.size() == len &&
+               !prop->Name.compare(0, len, name, len) ? prop : nullptr;
+    }
+
+    TProperty *Find(const std::string &name) const {
+        return Find(name.data(), name.size());
+    }
+};
+
+TError InitContainerProperties(void);
 
-class TContainer;
-extern __thread TContainer *CurrentContainer;
 extern std::map<std::string, TProperty*> ContainerProperties;
+extern TPropertyIndex PropertyIndex;
+extern std::vector<TProperty *> SampledProperties;
+extern std::vector<TProperty *> CounterProperties;
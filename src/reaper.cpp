@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "reaper.hpp"
+#include "config.hpp"
+#include "statistics.hpp"
+#include "util/log.hpp"
+#include "util/unix.hpp"
+#include "util/string.hpp"
+
+extern "C" {
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+}
+
+TCgroupReaper CgroupReaper;
+
+void TCgroupReaper::Start() {
+    if (Valid)
+        return;
+
+    WakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (WakeupFd < 0) {
+        L_ERR() << "Cannot create eventfd: " << TError(EError::Unknown, errno, "eventfd") << std::endl;
+        return;
+    }
+
+    Valid = true;
+    Thread = std::thread(&TCgroupReaper::ReaperFn, this);
+}
+
+void TCgroupReaper::Stop() {
+    if (!Valid)
+        return;
+
+    auto lock = ScopedLock();
+    Valid = false;
+    Wakeup();
+    lock.unlock();
+
+    Thread.join();
+
+    lock.lock();
+    for (auto &pending: Pending)
+        L_WRN() << "Cgroup " << pending.Cgroup << " left for removal at restart" << std::endl;
+    Pending.clear();
+
+    close(WakeupFd);
+    WakeupFd = -1;
+}
+
+void TCgroupReaper::Wakeup() {
+    uint64_t val = 1;
+    if (write(WakeupFd, &val, sizeof(val)) < 0)
+        L_ERR() << "Cannot wakeup cgroup reaper: " << TError(EError::Unknown, errno, "write") << std::endl;
+}
+
+bool TCgroupReaper::Defer(const TCgroup &cg) {
+    auto lock = ScopedLock();
+
+    if (!Valid)
+        return false;
+
+    uint64_t now = GetCurrentTimeMs();
+
+    L_ACT() << "Defer removal of cgroup " << cg << std::endl;
+
+    Pending.push_back({ cg, now + config().daemon().cgroup_reaper_timeout_s() * 1000,
+                        10, now + 10 });
+    Statistics->CgroupsDeferred++;
+    Wakeup();
+
+    return true;
+}
+
+bool TCgroupReaper::IsNested(const TCgroup &parent, const TCgroup &child) {
+    return parent.Subsystem == child.Subsystem &&
+           StringStartsWith(child.Name, parent.Name + "/");
+}
+
+bool TCgroupReaper::HasPendingChilds(const TCgroup &cg) {
+    auto lock = ScopedLock();
+
+    for (auto &pending: Pending)
+        if (IsNested(cg, pending.Cgroup))
+            return true;
+
+    return false;
+}
+
+bool TCgroupReaper::Cancel(const TCgroup &cg) {
+    auto lock = ScopedLock();
+    bool found = false;
+
+    for (auto it = Pending.begin(); it != Pending.end(); ) {
+        bool self = it->Cgroup.Subsystem == cg.Subsystem && it->Cgroup.Name == cg.Name;
+        bool nested = IsNested(cg, it->Cgroup);
+
+        if (self || nested || IsNested(it->Cgroup, cg)) {
+            L_ACT() << "Cancel removal of cgroup " << it->Cgroup << std::endl;
+            it = Pending.erase(it);
+            found |= self || nested;
+        } else
+            it++;
+    }
+
+    return found;
+}
+
+void TCgroupReaper::ReaperFn() {
+    SetProcessName("portod-reaper");
+
+    auto lock = ScopedLock();
+    while (Valid) {
+        uint64_t now = GetCurrentTimeMs();
+        int timeout = -1;
+
+        for (auto it = Pending.begin(); it != Pending.end(); ) {
+            if (it->Next > now) {
+                uint64_t delay = it->Next - now;
+                if (timeout < 0 || delay < (uint64_t)timeout)
+                    timeout = delay;
+                it++;
+                continue;
+            }
+
+            TError error = it->Cgroup.Path().Rmdir();
+            if (!error || error.GetErrno() == ENOENT) {
+                L_ACT() << "Removed cgroup " << it->Cgroup << std::endl;
+                Statistics->CgroupsReaped++;
+
+                /* parent might wait only for this one */
+                for (auto &parent: Pending) {
+                    if (IsNested(parent.Cgroup, it->Cgroup)) {
+                        parent.Delay = 10;
+                        parent.Next = now;
+                        timeout = 0;
+                    }
+                }
+            } else if (error.GetErrno() == EBUSY && now < it->Deadline) {
+                it->Delay = std::min(it->Delay * 2, (uint64_t)1000);
+                it->Next = now + it->Delay;
+                continue;
+            } else {
+                L_ERR() << "Cannot remove cgroup " << it->Cgroup << " : " << error << std::endl;
+                Statistics->CgroupsLeaked++;
+            }
+
+            it = Pending.erase(it);
+        }
+
+        if (!Pending.empty() && timeout < 0)
+            timeout = 0;
+
+        lock.unlock();
+
+        struct pollfd pfd = { WakeupFd, POLLIN, 0 };
+        (void)poll(&pfd, 1, timeout);
+
+        uint64_t val;
+        if (read(WakeupFd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+            L_ERR() << "Cannot read eventfd: " << TError(EError::Unknown, errno, "read") << std::endl;
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <list>
+#include <thread>
+
+#include "cgroup.hpp"
+#include "util/locks.hpp"
+
+/*
+ * Removes empty cgroups which kernel still reports as busy. Removal is
+ * retried with exponential backoff. Parents of busy cgroups are deferred too
+ * and retried right after their last pending child is removed. Cgroups
+ * which cannot be removed in cgroup_reaper_timeout_s are counted as leaked.
+ */
+class TCgroupReaper : public TLockable, public TNonCopyable {
+    struct TPendingCgroup {
+        TCgroup Cgroup;
+        uint64_t Deadline;
+        uint64_t Delay;
+        uint64_t Next;
+    };
+
+    std::list<TPendingCgroup> Pending;
+    std::thread Thread;
+    bool Valid = false;
+    int WakeupFd = -1;
+
+    void Wakeup();
+    void ReaperFn();
+
+    static bool IsNested(const TCgroup &parent, const TCgroup &child);
+
+public:
+    void Start();
+    void Stop();
+
+    /* false if reaper isn't running */
+    bool Defer(const TCgroup &cg);
+
+    /* true if some nested cgroup is waiting for removal */
+    bool HasPendingChilds(const TCgroup &cg);
+
+    /*
+     * Forgets cgroup, its ancestors and nested cgroups. Returns
+     * true if cgroup itself or something nested was waiting for removal.
+     */
+    bool Cancel(const TCgroup &cg);
+};
+
+extern TCgroupReaper CgroupReaper;
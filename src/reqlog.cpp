@@ -0,0 +1,96 @@
+#include "reqlog.hpp"
+#include "config.hpp"
+#include "rpc.pb.h"
+#include "util/log.hpp"
+#include "util/path.hpp"
+
+extern "C" {
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+}
+
+TRequestLog RequestLog;
+
+void TRequestLog::Open() {
+    const auto &cfg = config().request_log();
+    TPath path(cfg.file().path());
+
+    Sample = cfg.sample();
+    SlowUs = cfg.slow_ms() * 1000;
+
+    if (path.IsEmpty()) {
+        Close();
+        return;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC |
+                                O_NOFOLLOW | O_NOCTTY, cfg.file().perm());
+    if (fd < 0) {
+        L_ERR() << "Cannot open request log " << path << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    struct stat st;
+    if (!fstat(fd, &st) && !st.st_size &&
+            write(fd, REQUEST_LOG_MAGIC, sizeof(REQUEST_LOG_MAGIC)) !=
+            sizeof(REQUEST_LOG_MAGIC)) {
+        L_ERR() << "Cannot write request log " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return;
+    }
+
+    /* replace atomically, concurrent writers never see closed fd */
+    int old = Fd;
+    if (old >= 0) {
+        (void)dup3(fd, old, O_CLOEXEC);
+        close(fd);
+    } else
+        Fd = fd;
+}
+
+void TRequestLog::Close() {
+    int fd = Fd.exchange(-1);
+    if (fd >= 0)
+        close(fd);
+}
+
+uint32_t TRequestLog::Select(const TError &error, uint64_t durationUs) {
+    uint32_t flags = 0;
+
+    if (error && error.GetError() != EError::Queued)
+        flags |= REQUEST_LOG_ERROR;
+    if (SlowUs && durationUs >= SlowUs)
+        flags |= REQUEST_LOG_SLOW;
+    if (Sample && Sequence++ % Sample == 0)
+        flags |= REQUEST_LOG_SAMPLED;
+
+    return flags;
+}
+
+void TRequestLog::Write(const TRequestRecord &record) {
+    int fd = Fd;
+
+    /* O_APPEND: records from workers never interleave */
+    if (fd >= 0 && write(fd, &record, sizeof(record)) != sizeof(record))
+        L_WRN() << "Cannot write request log: " << strerror(errno) << std::endl;
+}
+
+uint16_t TRequestLog::Method(const rpc::TContainerRequest &req, std::string &name) {
+    std::vector<const google::protobuf::FieldDescriptor *> fields;
+    auto reflection = req.GetReflection();
+
+    name.clear();
+    reflection->ListFields(req, &fields);
+    if (fields.empty() || fields[0]->type() != google::protobuf::FieldDescriptor::TYPE_MESSAGE)
+        return 0;
+
+    auto &sub = reflection->GetMessage(req, fields[0]);
+    auto field = sub.GetDescriptor()->FindFieldByName("name");
+    if (field && !field->is_repeated() &&
+            field->type() == google::protobuf::FieldDescriptor::TYPE_STRING &&
+            sub.GetReflection()->HasField(sub, field))
+        name = sub.GetReflection()->GetString(sub, field);
+
+    return fields[0]->number();
+}
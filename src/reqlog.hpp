@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "common.hpp"
+
+namespace rpc {
+    class TContainerRequest;
+}
+
+/*
+ * Binary request log: fixed-size records appended to separate file after
+ * header REQUEST_LOG_MAGIC, integers are in host byte order. Method is
+ * field number of request in TContainerRequest, container id is -1 if
+ * request has no container or it wasn't found.
+ */
+constexpr char REQUEST_LOG_MAGIC[8] = { 'P', 'O', 'R', 'T', 'O', 'R', 'Q', '1' };
+
+constexpr uint32_t REQUEST_LOG_SAMPLED = 1;
+constexpr uint32_t REQUEST_LOG_ERROR = 2;
+constexpr uint32_t REQUEST_LOG_SLOW = 4;
+constexpr uint32_t REQUEST_LOG_QUEUED = 8;     /* reply is deferred, time till queued */
+
+struct TRequestRecord {
+    uint64_t Time;          /* start, us since epoch */
+    uint32_t Duration;      /* us */
+    uint32_t RequestSize;
+    uint32_t ResponseSize;
+    int32_t ClientPid;
+    int32_t ContainerId;
+    uint16_t Method;
+    uint16_t Error;
+    uint32_t Flags;
+} __attribute__((packed));
+
+/*
+ * Errors and requests slower than slow_ms are always written,
+ * successful - every sample'th, zero sample writes none of them.
+ */
+class TRequestLog : public TNonCopyable {
+    std::atomic<int> Fd;
+    std::atomic<uint64_t> Sequence;
+    uint64_t Sample = 0;
+    uint64_t SlowUs = 0;
+
+public:
+    TRequestLog() : Fd(-1), Sequence(0) {}
+
+    /* Also reopens at SIGUSR1, empty path disables log */
+    void Open();
+    void Close();
+
+    bool IsEnabled() const { return Fd >= 0; }
+
+    /* Returns record flags, zero if request shouldn't be written */
+    uint32_t Select(const TError &error, uint64_t durationUs);
+    void Write(const TRequestRecord &record);
+
+    /* Field number of request and its "name" if it has one */
+    static uint16_t Method(const rpc::TContainerRequest &req, std::string &name);
+};
+
+extern TRequestLog RequestLog;
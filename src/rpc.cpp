@@ -10,10 +10,15 @@
 #include "layer.hpp"
 #include "event.hpp"
 #include "protobuf.hpp"
+#include "reqlog.hpp"
 #include "util/log.hpp"
 #include "util/string.hpp"
 #include "util/cred.hpp"
 
+extern "C" {
+#include <sys/time.h>
+}
+
 using std::string;
 
 static std::string RequestAsString(const rpc::TContainerRequest &req) {
@@ -42,12 +47,16 @@ static std::string RequestAsString(const rpc::TContainerRequest &req) {
         for (int i = 0; i < req.get().name_size(); i++)
             ret += " " + req.get().name(i);
 
-        if (req.get().name_size() && req.get().variable_size())
+        if (req.get().name_size() &&
+                (req.get().variable_size() || req.get().variable_id_size()))
             ret += ",";
 
         for (int i = 0; i < req.get().variable_size(); i++)
             ret += " " + req.get().variable(i);
 
+        for (int i = 0; i < req.get().variable_id_size(); i++)
+            ret += " #" + std::to_string(req.get().variable_id(i));
+
         return ret;
     } else if (req.has_start())
         return "start " + req.start().name();
@@ -63,6 +72,12 @@ static std::string RequestAsString(const rpc::TContainerRequest &req) {
         return "list available data";
     else if (req.has_kill())
         return "kill " + req.kill().name() + " " + std::to_string(req.kill().sig());
+    else if (req.has_exec())
+        return "exec " + req.exec().name() + " " + req.exec().command() +
+            (req.exec().wait() ? " wait" : "");
+    else if (req.has_readstream())
+        return "read " + req.readstream().name() + " " + req.readstream().stream() +
+            (req.readstream().follow() ? " follow" : "");
     else if (req.has_version())
         return "get version";
     else if (req.has_wait()) {
@@ -151,7 +166,10 @@ static std::string ResponseAsString(const rpc::TContainerResponse &resp) {
                 ret = "Wait " + resp.wait().name();
         } else if (resp.has_convertpath())
             ret = resp.convertpath().path();
-        else
+        else if (resp.has_stop()) {
+            for (auto &result: resp.stop().result())
+                ret += result.name() + (result.killed() ? " (killed) " : " ");
+        } else
             ret = "Ok";
         return ret;
         break;
@@ -227,6 +245,7 @@ static bool InfoRequest(const rpc::TContainerRequest &req) {
         req.has_datalist() ||
         req.has_version() ||
         req.has_wait() ||
+        req.has_readstream() ||
         req.has_listvolumeproperties() ||
         req.has_listvolumes() ||
         req.has_listlayers() ||
@@ -250,6 +269,8 @@ static bool ValidRequest(const rpc::TContainerRequest &req) {
         req.has_propertylist() +
         req.has_datalist() +
         req.has_kill() +
+        req.has_exec() +
+        req.has_readstream() +
         req.has_version() +
         req.has_wait() +
         req.has_listvolumeproperties() +
@@ -297,6 +318,8 @@ static noinline TError CreateContainer(TContext &context,
     if (err)
         return err;
 
+    context.Cholder->WaitTeardown(holder_lock, name);
+
     auto parent = context.Cholder->GetParent(name);
     if (!parent)
         return TError(EError::InvalidValue, "invalid parent container");
@@ -310,6 +333,8 @@ static noinline TError CreateContainer(TContext &context,
 
     std::shared_ptr<TContainer> container;
     err = context.Cholder->Create(holder_lock, name, container);
+    if (!err)
+        CurrentClient->RequestContainerId = container->GetId();
 
     if (!err && weak) {
         container->IsWeak = true;
@@ -350,7 +375,7 @@ noinline TError DestroyContainer(TContext &context,
             if (!acquire.IsAcquired())
                 return TError(EError::Busy, "Can't destroy busy container");
 
-            err = context.Cholder->Destroy(holder_lock, container);
+            err = context.Cholder->DestroyDeferred(holder_lock, container);
             if (err)
                 return err;
         }
@@ -383,6 +408,7 @@ noinline TError StartContainer(TContext &context,
     err = TContainer::Find(name, target);
     if (err)
         return err;
+    CurrentClient->RequestContainerId = target->GetId();
 
     std::vector<std::string> nameVec;
     err = SplitString(name, '/', nameVec);
@@ -390,6 +416,34 @@ noinline TError StartContainer(TContext &context,
         return TError(EError::InvalidValue, "Invalid container name " + req.name());
 
     std::shared_ptr<TContainer> topContainer = nullptr;
+    std::map<std::string, std::vector<std::string>> after;
+    std::vector<TStartNode> plan;
+
+    /* validate whole subtree before anything is started */
+    if (req.recursive()) {
+        std::string dep_name;
+
+        for (auto &dep: req.dependency()) {
+            err = CurrentClient->ResolveRelativeName(dep.name(), dep_name);
+            if (err)
+                return err;
+            auto &prev = after[dep_name];
+            for (auto &sibling: dep.after()) {
+                err = CurrentClient->ResolveRelativeName(sibling, dep_name);
+                if (err)
+                    return err;
+                prev.push_back(dep_name);
+            }
+        }
+
+        TNestedScopedLock lock(*target, holder_lock);
+        if (!target->IsValid())
+            return TError(EError::ContainerDoesNotExist, "container doesn't exist");
+
+        err = target->PlanSubtree(holder_lock, after, plan);
+        if (err)
+            return err;
+    }
 
     name = "";
     for (auto i = nameVec.begin(); i != nameVec.end(); i++) {
@@ -403,10 +457,12 @@ noinline TError StartContainer(TContext &context,
         if (err)
             goto release;
 
-        if (i + 1 != nameVec.end())
-            if (container->GetState() == EContainerState::Running ||
-                container->GetState() == EContainerState::Meta)
-                continue;
+        bool last = i + 1 == nameVec.end();
+        bool started = container->GetState() == EContainerState::Running ||
+                       container->GetState() == EContainerState::Meta;
+
+        if (!last && started)
+            continue;
 
         err = CurrentClient->CanControl(*container);
         if (err)
@@ -419,8 +475,13 @@ noinline TError StartContainer(TContext &context,
                 return TError(EError::Busy, "Can't start busy container " + topContainer->GetName());
         }
 
+        /* recursive start continues in already running container */
+        if (started && req.recursive())
+            break;
+
         std::string cmd = container->Command;
-        bool meta = i + 1 != nameVec.end() && cmd.empty();
+        bool meta = cmd.empty() && (!last || (req.recursive() &&
+                                              !container->GetChildren().empty()));
 
         auto parent = container->GetParent();
         if (parent) {
@@ -442,6 +503,22 @@ noinline TError StartContainer(TContext &context,
             goto release;
     }
 
+    if (req.recursive()) {
+        std::vector<TStartResult> results;
+
+        err = target->StartSubtree(holder_lock, plan, results);
+
+        for (auto &result: results) {
+            auto entry = rsp.mutable_start()->add_result();
+            if (CurrentClient->ComposeRelativeName(result.Name, name))
+                name = result.Name;
+            entry->set_name(name);
+            entry->set_error(result.Error.GetError());
+            if (result.Error)
+                entry->set_errormsg(result.Error.GetMsg());
+        }
+    }
+
 release:
     if (topContainer)
         topContainer->Release();
@@ -471,7 +548,19 @@ noinline TError StopContainer(TContext &context,
     uint64_t timeout_ms = req.has_timeout_ms() ?
         req.timeout_ms() : config().container().stop_timeout_ms();
 
-    return container->Stop(holder_lock, timeout_ms);
+    std::vector<TStopResult> results;
+    error = container->Stop(holder_lock, timeout_ms, &results);
+
+    for (auto &result: results) {
+        auto entry = rsp.mutable_stop()->add_result();
+        entry->set_name(result.Name);
+        entry->set_error(result.Error.GetError());
+        if (result.Error)
+            entry->set_errormsg(result.Error.GetMsg());
+        entry->set_killed(result.Killed);
+    }
+
+    return error;
 }
 
 noinline TError PauseContainer(TContext &context,
@@ -521,12 +610,20 @@ noinline TError ResumeContainer(TContext &context,
 noinline TError ListContainers(TContext &context, rpc::TContainerResponse &rsp) {
     auto holder_lock = LockContainers();
 
-    for (auto &c : context.Cholder->List()) {
+    std::vector<std::string> names;
+    names.reserve(Containers.size());
+
+    for (auto &it : Containers) {
         std::string name;
-        if (!CurrentClient->ComposeRelativeName(c->GetName(), name))
-            rsp.mutable_list()->add_name(name);
+        if (!it.second->IsPortoRoot() && !it.second->Dying &&
+                !CurrentClient->ComposeRelativeName(it.first, name))
+            names.push_back(name);
     }
 
+    std::sort(names.begin(), names.end());
+    for (auto &name : names)
+        rsp.mutable_list()->add_name(name);
+
     return TError::Success();
 }
 
@@ -623,7 +720,7 @@ noinline TError GetContainerCombined(TContext &context,
                                      rpc::TContainerResponse &rsp) {
     auto holder_lock = LockContainers();
 
-    if (!req.variable_size())
+    if (!req.variable_size() && !req.variable_id_size())
         return TError(EError::InvalidValue, "Properties/data are not specified");
 
     if (!req.name_size())
@@ -657,6 +754,10 @@ noinline TError GetContainerCombined(TContext &context,
             }
         }
 
+        /* each knob is read only once for all requested variables */
+        if (!containerError && container)
+            container->Knobs.StartRequest();
+
         for (int j = 0; j < req.variable_size(); j++) {
             auto var = req.variable(j);
 
@@ -665,7 +766,7 @@ noinline TError GetContainerCombined(TContext &context,
 
             TError error = containerError;
             if (!error && container)
-                error = container->GetProperty(var, value);
+                error = container->GetProperty(var, value, req.max_age_ms());
 
             keyval->set_variable(var);
             if (error) {
@@ -675,6 +776,31 @@ noinline TError GetContainerCombined(TContext &context,
                 keyval->set_value(value);
             }
         }
+
+        for (int j = 0; j < req.variable_id_size(); j++) {
+            auto prop = PropertyIndex.Find(req.variable_id(j));
+
+            auto keyval = entry->add_keyval();
+            std::string value;
+
+            TError error = containerError;
+            if (!error && !prop)
+                error = TError(EError::InvalidProperty, "Unknown property id: " +
+                               std::to_string(req.variable_id(j)));
+            if (!error && container)
+                error = container->GetProperty(*prop, "", value, req.max_age_ms());
+
+            keyval->set_variable(prop ? prop->Name : std::to_string(req.variable_id(j)));
+            if (error) {
+                keyval->set_error(error.GetError());
+                keyval->set_errormsg(error.GetMsg());
+            } else {
+                keyval->set_value(value);
+            }
+        }
+
+        if (!containerError && container)
+            container->Knobs.FinishRequest();
     }
 
     return TError::Success();
@@ -701,6 +827,7 @@ noinline TError ListProperty(TContext &context,
         auto entry = list->add_list();
         entry->set_name(elem.first);
         entry->set_desc(elem.second->Desc.c_str());
+        entry->set_id(elem.second->Id);
     }
 
     return TError::Success();
@@ -726,6 +853,7 @@ noinline TError ListData(TContext &context,
         auto entry = list->add_list();
         entry->set_name(elem.first);
         entry->set_desc(elem.second->Desc.c_str());
+        entry->set_id(elem.second->Id);
     }
 
     return TError::Success();
@@ -753,6 +881,67 @@ noinline TError Kill(TContext &context,
     return container->Kill(req.sig());
 }
 
+noinline TError Exec(TContext &context,
+                     const rpc::TContainerExecRequest &req,
+                     rpc::TContainerResponse &rsp,
+                     std::shared_ptr<TClient> &client) {
+    auto holder_lock = LockContainers();
+    std::string stdPath[3] = {
+        req.stdin_path(), req.stdout_path(), req.stderr_path(),
+    };
+    pid_t pid, vpid;
+
+    TError error = CheckPortoWriteAccess();
+    if (error)
+        return error;
+
+    std::shared_ptr<TContainer> container;
+    TNestedScopedLock lock;
+    error = context.Cholder->GetLocked(holder_lock, CurrentClient, req.name(), true, container, lock);
+    if (error)
+        return error;
+
+    TScopedAcquire acquire(container);
+    if (!acquire.IsAcquired())
+        return TError(EError::Busy, "Can't exec in busy container");
+
+    /*
+     * Spawn waits for task, don't block other requests meanwhile.
+     * Exit cannot be delivered while container is locked.
+     */
+    {
+        TScopedUnlock unlock(holder_lock);
+        error = container->Exec(req.command(), req.env(), req.cwd(),
+                                stdPath, pid, vpid);
+    }
+    if (error)
+        return error;
+
+    rsp.mutable_exec()->set_pid(pid);
+    rsp.mutable_exec()->set_vpid(vpid);
+
+    if (!req.wait())
+        return TError::Success();
+
+    std::weak_ptr<TClient> weak = client;
+    container->ExecTasks[pid].Reply = [weak, pid, vpid] (const TError &error, int status) {
+        auto client = weak.lock();
+        if (!client)
+            return;
+        rpc::TContainerResponse response;
+        response.set_error(error.GetError());
+        if (error)
+            response.set_errormsg(error.GetMsg());
+        response.mutable_exec()->set_pid(pid);
+        response.mutable_exec()->set_vpid(vpid);
+        if (!error)
+            response.mutable_exec()->set_exit_status(status);
+        SendReply(*client, response, true);
+    };
+
+    return TError::Queued();
+}
+
 noinline TError Version(rpc::TContainerResponse &rsp) {
     auto ver = rsp.mutable_version();
 
@@ -773,15 +962,20 @@ noinline TError Wait(TContext &context,
         return TError(EError::InvalidValue, "Containers are not specified");
 
     auto fn = [] (std::shared_ptr<TClient> client,
-                  TError error, std::string name) {
+                  TError error, std::string name, std::string event) {
         rpc::TContainerResponse response;
         response.set_error(error.GetError());
         response.mutable_wait()->set_name(name);
+        if (!event.empty())
+            response.mutable_wait()->set_event(event);
         SendReply(*client, response, error || !name.empty());
     };
 
     auto waiter = std::make_shared<TContainerWaiter>(client, fn);
 
+    for (auto &event: req.events())
+        waiter->Events.push_back(event);
+
     for (int i = 0; i < req.name_size(); i++) {
         std::string name = req.name(i);
         std::string abs_name;
@@ -818,8 +1012,9 @@ noinline TError Wait(TContext &context,
     }
 
     if (!waiter->Wildcards.empty()) {
-        for (auto &container : context.Cholder->List()) {
-            if (container->IsRoot() || container->IsPortoRoot())
+        for (auto &it : Containers) {
+            auto &container = it.second;
+            if (container->IsRoot() || container->IsPortoRoot() || container->Dying)
                 continue;
 
             /* Wildcard notifies immediately only dead and hollow meta */
@@ -857,6 +1052,124 @@ noinline TError Wait(TContext &context,
     return TError::Queued();
 }
 
+/* Offset is moved forward if requested data is already rotated away */
+static TError ReadStreamChunk(TContainer &ct, const std::string &name,
+                              uint64_t &offset, uint64_t limit,
+                              std::string &data, bool &eof) {
+    const TStdStream &stream = name == D_STDOUT ? ct.Stdout : ct.Stderr;
+    auto state = ct.GetState();
+
+    if (state == EContainerState::Stopped)
+        return TError(EError::InvalidState, "Container is stopped");
+
+    if (offset < stream.Offset)
+        offset = stream.Offset;
+
+    TError error = stream.Read(ct, data, std::to_string(offset) + ":" +
+                                         std::to_string(limit));
+    if (error)
+        return error;
+
+    eof = state == EContainerState::Dead && data.size() < limit;
+
+    return TError::Success();
+}
+
+noinline TError ReadStream(TContext &context,
+                           const rpc::TContainerReadStreamRequest &req,
+                           rpc::TContainerResponse &rsp,
+                           std::shared_ptr<TClient> &client) {
+    auto holder_lock = LockContainers();
+    uint64_t limit = req.has_limit() ? req.limit() : (1 << 20);
+    uint64_t offset;
+    std::string data;
+    bool eof = false;
+
+    if (req.stream() != D_STDOUT && req.stream() != D_STDERR)
+        return TError(EError::InvalidValue, "Unknown stream " + req.stream());
+
+    /* reply must fit into message */
+    limit = std::min<uint64_t>(limit, config().daemon().max_msg_len() / 2);
+    if (!limit)
+        return TError(EError::InvalidValue, "Zero limit");
+
+    std::shared_ptr<TContainer> container;
+    TNestedScopedLock lock;
+    TError error = context.Cholder->GetLocked(holder_lock, CurrentClient, req.name(), false, container, lock);
+    if (error)
+        return error;
+
+    std::string cursor = container->GetName() + ":" + req.stream();
+    offset = req.has_offset() ? req.offset() : client->StreamCursor[cursor];
+    bool follow = req.follow() && (!req.has_timeout() || req.timeout() != 0);
+
+    /* watch before read: data written in between must wake follower */
+    std::shared_ptr<TStreamWatch> watch;
+    if (follow) {
+        error = container->WatchStream(req.stream() == D_STDOUT ?
+                                       container->Stdout : container->Stderr, watch);
+        if (error)
+            return error;
+    }
+
+    error = ReadStreamChunk(*container, req.stream(), offset, limit, data, eof);
+    if (error)
+        return error;
+
+    if (data.size() || eof || !follow) {
+        client->StreamCursor[cursor] = offset + data.size();
+        rsp.mutable_readstream()->set_offset(offset);
+        rsp.mutable_readstream()->set_data(data);
+        rsp.mutable_readstream()->set_eof(eof);
+        return TError::Success();
+    }
+
+    /*
+     * One reply per request: client pulls next chunk when ready.
+     * Watch is released together with waiter: after reply or disconnect.
+     */
+    std::weak_ptr<TContainer> weak = container;
+    std::string stream = req.stream();
+    auto fn = [weak, stream, cursor, offset, limit, watch] (std::shared_ptr<TClient> client,
+                  TError error, std::string name, std::string event) {
+        uint64_t start = offset;
+        std::string data;
+        bool eof = false;
+
+        /* empty name means timeout */
+        auto ct = weak.lock();
+        if (!ct)
+            error = TError(EError::ContainerDoesNotExist, "Container destroyed");
+        else if (!error && !name.empty())
+            error = ReadStreamChunk(*ct, stream, start, limit, data, eof);
+
+        rpc::TContainerResponse response;
+        response.set_error(error.GetError());
+        if (error) {
+            response.set_errormsg(error.GetMsg());
+        } else {
+            client->StreamCursor[cursor] = start + data.size();
+            response.mutable_readstream()->set_offset(start);
+            response.mutable_readstream()->set_data(data);
+            response.mutable_readstream()->set_eof(eof);
+        }
+        SendReply(*client, response, bool(error));
+    };
+
+    auto waiter = std::make_shared<TContainerWaiter>(client, fn);
+    waiter->Events.push_back(stream);
+    container->AddWaiter(waiter);
+    client->Waiter = waiter;
+
+    if (req.has_timeout()) {
+        TEvent e(EEventType::WaitTimeout, nullptr);
+        e.WaitTimeout.Waiter = waiter;
+        context.Queue->Add(req.timeout(), e);
+    }
+
+    return TError::Queued();
+}
+
 noinline TError ConvertPath(const rpc::TConvertPathRequest &req,
                             rpc::TContainerResponse &rsp) {
     auto lock = LockContainers();
@@ -1287,14 +1600,53 @@ noinline TError ListLayers(const rpc::TLayerListRequest &req,
     return error;
 }
 
+/* Container id is captured by handlers under their locks, none taken here */
+static void WriteRequestLog(const rpc::TContainerRequest &req,
+                            const rpc::TContainerResponse &rsp,
+                            const TClient &client, const TError &error,
+                            uint64_t startTime, uint64_t startUs) {
+    uint64_t durationUs = GetCurrentTimeUs() - startUs;
+    uint32_t flags = RequestLog.Select(error, durationUs);
+    TRequestRecord record = {};
+    std::string name;
+
+    if (!flags)
+        return;
+
+    bool queued = error.GetError() == EError::Queued;
+    if (queued)
+        flags |= REQUEST_LOG_QUEUED;
+
+    record.Time = startTime;
+    record.Duration = std::min<uint64_t>(durationUs, UINT32_MAX);
+    record.RequestSize = req.ByteSizeLong();
+    record.ResponseSize = queued ? 0 : rsp.ByteSizeLong();
+    record.ClientPid = client.Pid;
+    record.ContainerId = client.RequestContainerId;
+    record.Method = TRequestLog::Method(req, name);
+    record.Error = error.GetError();
+    record.Flags = flags;
+
+    RequestLog.Write(record);
+}
+
 void HandleRpcRequest(TContext &context, const rpc::TContainerRequest &req,
                       std::shared_ptr<TClient> client) {
+    uint64_t startUs = 0, startTime = 0;
     rpc::TContainerResponse rsp;
     string str;
 
+    /* monotonic for duration, wall clock for record */
+    if (RequestLog.IsEnabled()) {
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        startTime = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+        startUs = GetCurrentTimeUs();
+    }
+
     client->StartRequest();
 
-    bool log = Verbose || !InfoRequest(req);
+    bool log = Verbose || (!InfoRequest(req) && config().log().requests());
     if (log) {
         std::string ns = "";
         std::shared_ptr<TContainer> clientContainer;
@@ -1342,6 +1694,10 @@ void HandleRpcRequest(TContext &context, const rpc::TContainerRequest &req,
             error = ListData(context, rsp);
         else if (req.has_kill())
             error = Kill(context, req.kill(), rsp);
+        else if (req.has_exec())
+            error = Exec(context, req.exec(), rsp, client);
+        else if (req.has_readstream())
+            error = ReadStream(context, req.readstream(), rsp, client);
         else if (req.has_version())
             error = Version(rsp);
         else if (req.has_wait())
@@ -1390,5 +1746,8 @@ void HandleRpcRequest(TContext &context, const rpc::TContainerRequest &req,
         SendReply(*client, rsp, log);
     }
 
+    if (startUs)
+        WriteRequestLog(req, rsp, *client, error, startTime, startUs);
+
     client->FinishRequest();
 }
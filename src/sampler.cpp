@@ -0,0 +1,43 @@
+#include "sampler.hpp"
+#include "holder.hpp"
+#include "config.hpp"
+#include "util/log.hpp"
+#include "util/unix.hpp"
+
+void TStatSampler::Start() {
+    uint64_t interval = config().daemon().stat_sample_interval_ms();
+
+    if (!interval || Valid)
+        return;
+
+    L_SYS() << "Start statistics sampler, interval " << interval << " ms" << std::endl;
+
+    Valid = true;
+    Thread = std::thread(&TStatSampler::SamplerFn, this, interval);
+}
+
+void TStatSampler::Stop() {
+    if (!Valid)
+        return;
+
+    auto lock = ScopedLock();
+    Valid = false;
+    Cv.notify_all();
+    lock.unlock();
+
+    Thread.join();
+}
+
+void TStatSampler::SamplerFn(uint64_t intervalMs) {
+    SetProcessName("portod-stat");
+
+    auto lock = ScopedLock();
+    while (Valid) {
+        lock.unlock();
+        Holder->SampleStatistics();
+        lock.lock();
+
+        if (Valid)
+            Cv.wait_for(lock, std::chrono::milliseconds(intervalMs));
+    }
+}
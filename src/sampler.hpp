@@ -0,0 +1,24 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <condition_variable>
+
+#include "util/locks.hpp"
+
+class TContainerHolder;
+
+/* Periodically refreshes sampled statistics of running containers */
+class TStatSampler : public TLockable, public TNonCopyable {
+    std::shared_ptr<TContainerHolder> Holder;
+    std::condition_variable Cv;
+    std::thread Thread;
+    bool Valid = false;
+
+    void SamplerFn(uint64_t intervalMs);
+
+public:
+    TStatSampler(std::shared_ptr<TContainerHolder> holder) : Holder(holder) {}
+    void Start();
+    void Stop();
+};
@@ -0,0 +1,622 @@
+#include <algorithm>
+#include <cstring>
+
+#include "spawner.hpp"
+#include "task.hpp"
+#include "stream.hpp"
+#include "util/log.hpp"
+#include "util/signal.hpp"
+#include "util/path.hpp"
+
+extern "C" {
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+}
+
+TSpawner Spawner;
+
+static const int SpawnNamespaces[5] = {
+    CLONE_NEWIPC, CLONE_NEWUTS, CLONE_NEWNET, CLONE_NEWPID, CLONE_NEWNS,
+};
+
+/* Namespaces[] after namespace types: root and cwd directories */
+static constexpr int SpawnRoot = 5;
+static constexpr int SpawnCwd = 6;
+
+template <typename T>
+static void Put(std::string &data, const T &value) {
+    data.append((const char *)&value, sizeof(value));
+}
+
+static void PutString(std::string &data, const std::string &str) {
+    Put<uint32_t>(data, str.size());
+    data += str;
+}
+
+static void PutCred(std::string &data, const TCred &cred) {
+    Put(data, cred.Uid);
+    Put(data, cred.Gid);
+    Put<uint32_t>(data, cred.Groups.size());
+    for (auto gid: cred.Groups)
+        Put(data, gid);
+}
+
+class TSpawnReader {
+    const std::string &Data;
+    size_t Pos = 0;
+
+public:
+    bool Valid = true;
+
+    TSpawnReader(const std::string &data) : Data(data) {}
+
+    template <typename T>
+    T Get() {
+        T value = T();
+        if (Pos + sizeof(value) > Data.size())
+            Valid = false;
+        else
+            memcpy(&value, Data.data() + Pos, sizeof(value));
+        Pos += sizeof(value);
+        return value;
+    }
+
+    std::string GetString() {
+        uint32_t len = Get<uint32_t>();
+        if (!Valid || Pos + len > Data.size()) {
+            Valid = false;
+            return "";
+        }
+        Pos += len;
+        return Data.substr(Pos - len, len);
+    }
+
+    void GetCred(TCred &cred) {
+        cred.Uid = Get<uid_t>();
+        cred.Gid = Get<gid_t>();
+        cred.Groups.resize(std::min<size_t>(Get<uint32_t>(), Data.size()));
+        for (auto &gid: cred.Groups)
+            gid = Get<gid_t>();
+    }
+};
+
+void TSpawnRequest::Serialize(std::string &data, std::vector<int> &fds) const {
+    PutString(data, Name);
+    PutString(data, Command);
+    Put<uint32_t>(data, Environ.size());
+    for (auto &env: Environ)
+        PutString(data, env);
+    PutString(data, Cwd);
+    for (int i = 0; i < 3; i++)
+        PutString(data, InsidePath[i]);
+    PutCred(data, Cred);
+    PutCred(data, OwnerCred);
+    Put(data, CapAmbient.Permitted);
+    Put(data, CapLimit.Permitted);
+    Put<uint32_t>(data, Rlimit.size());
+    for (auto &it: Rlimit) {
+        Put(data, it.first);
+        Put(data, it.second);
+    }
+    Put(data, Umask);
+    Put(data, Isolate);
+    Put(data, NewMountNs);
+
+    /* Descriptors are passed in order of appearance, -1 are skipped */
+    fds.push_back(Sock);
+    Put<uint32_t>(data, Cgroups.size());
+    for (int fd: Cgroups)
+        fds.push_back(fd);
+    for (int fd: Streams) {
+        Put<bool>(data, fd >= 0);
+        if (fd >= 0)
+            fds.push_back(fd);
+    }
+    for (int fd: Namespaces) {
+        Put<bool>(data, fd >= 0);
+        if (fd >= 0)
+            fds.push_back(fd);
+    }
+    Put<bool>(data, PortoInit >= 0);
+    if (PortoInit >= 0)
+        fds.push_back(PortoInit);
+}
+
+TError TSpawnRequest::Deserialize(const std::string &data, const std::vector<int> &fds) {
+    TSpawnReader reader(data);
+    size_t nextFd = 0;
+
+    Name = reader.GetString();
+    Command = reader.GetString();
+    Environ.resize(std::min<size_t>(reader.Get<uint32_t>(), data.size()));
+    for (auto &env: Environ)
+        env = reader.GetString();
+    Cwd = reader.GetString();
+    for (int i = 0; i < 3; i++)
+        InsidePath[i] = reader.GetString();
+    reader.GetCred(Cred);
+    reader.GetCred(OwnerCred);
+    CapAmbient.Permitted = reader.Get<uint64_t>();
+    CapLimit.Permitted = reader.Get<uint64_t>();
+    Rlimit.clear();
+    for (uint32_t nr = reader.Get<uint32_t>(); reader.Valid && nr; nr--) {
+        int res = reader.Get<int>();
+        Rlimit[res] = reader.Get<struct rlimit>();
+    }
+    Umask = reader.Get<mode_t>();
+    Isolate = reader.Get<bool>();
+    NewMountNs = reader.Get<bool>();
+
+    if (nextFd < fds.size())
+        Sock = fds[nextFd++];
+    Cgroups.clear();
+    for (uint32_t nr = reader.Get<uint32_t>(); reader.Valid && nr; nr--)
+        Cgroups.push_back(nextFd < fds.size() ? fds[nextFd++] : -1);
+    for (int &fd: Streams)
+        fd = reader.Get<bool>() && nextFd < fds.size() ? fds[nextFd++] : -1;
+    for (int &fd: Namespaces)
+        fd = reader.Get<bool>() && nextFd < fds.size() ? fds[nextFd++] : -1;
+    PortoInit = reader.Get<bool>() && nextFd < fds.size() ? fds[nextFd++] : -1;
+
+    if (!reader.Valid || nextFd != fds.size() || Sock < 0 ||
+            std::find(Cgroups.begin(), Cgroups.end(), -1) != Cgroups.end())
+        return TError(EError::Unknown, "Malformed spawn request: " +
+                std::to_string(data.size()) + " bytes " +
+                std::to_string(fds.size()) + " fds");
+
+    return TError::Success();
+}
+
+/*
+ * Protocol is the same as for forked spawn-p:
+ * WPid, start status and error if start failed,
+ * VPid from task (from spawn-p for isolated task),
+ * wakeup, error if exec failed.
+ */
+void TSpawnRequest::Abort(const TError &error) const {
+    TUnixSocket sock(Sock);
+    TError error2;
+
+    L() << "abort due to " << error << std::endl;
+
+    error2 = sock.SendPid(getpid());
+    if (!error2)
+        error2 = sock.SendInt(1);
+    if (!error2)
+        error2 = sock.SendError(error);
+    if (error2)
+        L_ERR() << error2 << std::endl;
+
+    _exit(EXIT_FAILURE);
+}
+
+struct TSpawnChild {
+    const TSpawnRequest *Request;
+    int Wakeup[2];
+    int InitSock[2];
+};
+
+static int SpawnChildFn(void *arg) {
+    TSpawnChild *child = static_cast<TSpawnChild *>(arg);
+    close(child->Wakeup[1]);
+    if (child->InitSock[0] >= 0)
+        close(child->InitSock[0]);
+    child->Request->Exec(child->Wakeup[0], child->InitSock[1]);
+    return EXIT_FAILURE;
+}
+
+void TSpawnRequest::Spawn() const {
+    TUnixSocket sock(Sock);
+    std::string pid = std::to_string(getpid());
+    char stack[8192];
+    int wakeup[2];
+    TError error;
+
+    SetProcessName("portod-spawn-p");
+
+    (void)setsid();
+
+    /* move to target cgroups */
+    for (int fd: Cgroups) {
+        if (write(fd, pid.c_str(), pid.size()) < 0)
+            Abort(TError(EError::Unknown, errno, "Cannot attach to cgroup"));
+    }
+
+    /* Default streams and redirections are opened outside by slave */
+    for (int i = 0; i < 3; i++) {
+        if (Streams[i] >= 0 && dup2(Streams[i], i) < 0)
+            Abort(TError(EError::Unknown, errno, "dup2(" +
+                         std::to_string(Streams[i]) + ", " +
+                         std::to_string(i) + ")"));
+    }
+
+    /* Enter parent namespaces */
+    for (int i = 0; i < 5; i++) {
+        if (Namespaces[i] >= 0 && setns(Namespaces[i], SpawnNamespaces[i]))
+            Abort(TError(EError::Unknown, errno, "Cannot set namespace"));
+    }
+
+    if (Namespaces[SpawnRoot] >= 0 &&
+            (fchdir(Namespaces[SpawnRoot]) || chroot(".")))
+        Abort(TError(EError::Unknown, errno, "Cannot change root"));
+
+    if (Namespaces[SpawnCwd] >= 0 && fchdir(Namespaces[SpawnCwd]))
+        Abort(TError(EError::Unknown, errno, "Cannot change cwd"));
+
+    if (pipe2(wakeup, O_CLOEXEC))
+        Abort(TError(EError::Unknown, errno, "pipe2()"));
+
+    /* Application under portoinit reports VPid to us */
+    TUnixSocket initSock, initSock2;
+    if (PortoInit >= 0) {
+        error = TUnixSocket::SocketPair(initSock, initSock2);
+        if (error)
+            Abort(error);
+    }
+
+    int cloneFlags = SIGCHLD;
+    if (Isolate)
+        cloneFlags |= CLONE_NEWPID | CLONE_NEWIPC | CLONE_NEWUTS;
+    if (NewMountNs)
+        cloneFlags |= CLONE_NEWNS;
+
+    TSpawnChild child = { this, { wakeup[0], wakeup[1] },
+                          { initSock.GetFd(), initSock2.GetFd() } };
+    pid_t clonePid = clone(SpawnChildFn, stack + sizeof(stack), cloneFlags, &child);
+    if (clonePid < 0)
+        Abort(TError(errno == ENOMEM ? EError::ResourceNotAvailable :
+                     EError::Unknown, errno, "clone()"));
+
+    close(wakeup[0]);
+    initSock2.Close();
+
+    /* Report WPid in host pid namespace */
+    error = sock.SendPid(clonePid);
+    if (!error)
+        error = sock.SendInt(0);
+
+    /* Report VPid for isolated task: pid 1 isn't seen from inside */
+    if (!error && Isolate && PortoInit < 0)
+        error = sock.SendPid(clonePid);
+
+    if (error) {
+        L_ERR() << error << std::endl;
+        kill(clonePid, SIGKILL);
+        _exit(EXIT_FAILURE);
+    }
+
+    /* WPid reported, wakeup child */
+    if (write(wakeup[1], "", 1) != 1) {
+        kill(clonePid, SIGKILL);
+        _exit(EXIT_FAILURE);
+    }
+
+    if (PortoInit >= 0) {
+        pid_t appPid, appVPid;
+
+        error = initSock.RecvPid(appPid, appVPid);
+        /* Forward VPid */
+        if (!error)
+            error = sock.SendPid(appPid);
+        if (!error)
+            error = initSock.SendZero();
+        if (error) {
+            L_ERR() << error << std::endl;
+            kill(clonePid, SIGKILL);
+            _exit(EXIT_FAILURE);
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+/* Same as ConfigureChild() for host root without binds and devices */
+TError TSpawnRequest::MountFs() const {
+    TError error;
+
+    /* Remount to slave to receive propogations from parent namespace */
+    error = TPath("/").Remount(MS_SLAVE | MS_REC);
+    if (error)
+        return error;
+
+    if (Isolate) {
+        TPath proc("/proc");
+        error = proc.UmountAll();
+        if (error)
+            return error;
+        error = proc.Mount("proc", "proc", MS_NOEXEC | MS_NOSUID | MS_NODEV, {});
+        if (error)
+            return error;
+    }
+
+    TPath sys("/sys");
+    error = sys.UmountAll();
+    if (error)
+        return error;
+    error = sys.Mount("sysfs", "sysfs", MS_NOSUID | MS_NOEXEC | MS_NODEV | MS_RDONLY, {});
+    if (error)
+        return error;
+
+    error = TPath(Cwd).Chdir();
+    if (error)
+        return error;
+
+    /* Make all shared: subcontainers will get propgation from us */
+    return TPath("/").Remount(MS_SHARED | MS_REC);
+}
+
+/* Parent becomes portoinit, child continues as application */
+TError TSpawnRequest::StartInit(int initSock) const {
+    pid_t pid = fork();
+    if (pid < 0)
+        return TError(EError::Unknown, errno, "fork()");
+
+    if (pid) {
+        auto pid_ = std::to_string(pid);
+        const char * argv[] = {
+            "portoinit",
+            "--container",
+            Name.c_str(),
+            "--wait",
+            pid_.c_str(),
+            NULL,
+        };
+        std::vector<char *> envp;
+        TError error;
+
+        for (auto &env: Environ)
+            envp.push_back((char *)env.c_str());
+        envp.push_back(nullptr);
+
+        error = PortoInitCapabilities.ApplyLimit();
+        if (error)
+            return error;
+
+        TFile::CloseAll({PortoInit});
+        fexecve(PortoInit, (char *const *)argv, envp.data());
+        return TError(EError::Unknown, errno, "fexecve()");
+    }
+
+    TUnixSocket sock(initSock);
+    TError error = sock.SendPid(getpid());
+    if (!error)
+        error = sock.RecvZero();
+    if (error)
+        return error;
+
+    if (setsid() < 0)
+        return TError(EError::Unknown, errno, "setsid()");
+
+    return TError::Success();
+}
+
+void TSpawnRequest::Exec(int wakeup, int initSock) const {
+    TUnixSocket sock(Sock);
+    std::vector<char *> envp;
+    TError error;
+    char byte;
+
+    SetProcessName("portod-spawn-c");
+
+    /* Wait for report WPid in parent */
+    if (read(wakeup, &byte, 1) != 1)
+        _exit(EXIT_FAILURE);
+    close(wakeup);
+
+    /* Report VPid in pid namespace we're enter */
+    if (!Isolate) {
+        error = sock.SendPid(getpid());
+        if (error)
+            _exit(EXIT_FAILURE);
+    }
+
+    for (const auto &pair: Rlimit) {
+        if (setrlimit(pair.first, &pair.second) < 0) {
+            error = TError(EError::Unknown, errno,
+                           "setrlimit(" + std::to_string(pair.first) +
+                           ", " + std::to_string(pair.second.rlim_cur) +
+                           ":" + std::to_string(pair.second.rlim_max) + ")");
+            goto err;
+        }
+    }
+
+    if (setsid() < 0) {
+        error = TError(EError::Unknown, errno, "setsid()");
+        goto err;
+    }
+
+    umask(0);
+
+    if (NewMountNs)
+        error = MountFs();
+    else
+        error = TPath(Cwd).Chdir();
+    if (error)
+        goto err;
+
+    if (PortoInit >= 0) {
+        error = StartInit(initSock);
+        if (error)
+            goto err;
+    }
+
+    error = Cred.Apply();
+    if (error)
+        goto err;
+
+    error = CapAmbient.ApplyAmbient();
+    if (error)
+        goto err;
+
+    error = CapLimit.ApplyLimit();
+    if (error)
+        goto err;
+
+    if (!Cred.IsRootUser()) {
+        error = CapAmbient.ApplyEffective();
+        if (error)
+            goto err;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (!InsidePath[i].empty()) {
+            TStdStream stream(i);
+            error = stream.Open(InsidePath[i], OwnerCred);
+            if (error)
+                goto err;
+        }
+
+        /* Assign controlling terminal for our own session */
+        if (isatty(i))
+            (void)ioctl(i, TIOCSCTTY, 0);
+    }
+
+    umask(Umask);
+
+    /* Wait for Wakeup */
+    error = sock.RecvZero();
+    if (error)
+        goto err;
+
+    /* Reset signals before exec, signal block already lifted */
+    ResetIgnoredSignals();
+
+    /* set environment for wordexp */
+    clearenv();
+    for (auto &env: Environ) {
+        envp.push_back((char *)env.c_str());
+        if (putenv(envp.back())) {
+            error = TError(EError::Unknown, errno, "putenv");
+            goto err;
+        }
+    }
+    envp.push_back(nullptr);
+
+    error = ExecCommand(Command, envp.data(), Sock);
+
+err:
+    L() << "abort due to " << error << std::endl;
+    (void)sock.SendError(error);
+    _exit(EXIT_FAILURE);
+}
+
+void TSpawner::SpawnerMain(int sockFd) {
+    TUnixSocket sock(sockFd);
+
+    SetProcessName("portod-spawner");
+    SetDieOnParentExit(SIGKILL);
+
+    /* Switch from signafd back to normal signal delivery */
+    ResetBlockedSignals();
+
+    TFile::CloseAll({sockFd, TLogger::GetFd()});
+
+    /* Keep 0-2 busy: received descriptors must not land there */
+    for (int fd = 0; fd < 3; fd++) {
+        if (fcntl(fd, F_GETFD) < 0 && open("/dev/null", O_RDWR) != fd)
+            _exit(EXIT_FAILURE);
+    }
+
+    L_SYS() << "Spawner started " << getpid() << std::endl;
+
+    while (true) {
+        TSpawnRequest request;
+        std::vector<int> fds;
+        std::string data;
+        TError error;
+
+        error = sock.RecvFds(data, fds);
+        if (error) {
+            if (error.GetErrno() != EPIPE)
+                L_ERR() << "Spawner: " << error << std::endl;
+            break;
+        }
+
+        error = request.Deserialize(data, fds);
+        if (error) {
+            L_ERR() << "Spawner: " << error << std::endl;
+        } else {
+            /* slave gets EOF if spawn-p wasn't forked */
+            pid_t pid = fork();
+            if (pid < 0)
+                L_ERR() << "Spawner: " << TError(EError::Unknown, errno, "fork()") << std::endl;
+            else if (pid == 0)
+                request.Spawn();
+            else /* spawn-p lives until task reports its pid */
+                (void)waitpid(pid, nullptr, 0);
+        }
+
+        for (int fd: fds)
+            close(fd);
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+TError TSpawner::Start() {
+    TUnixSocket sock;
+    TError error;
+
+    std::lock_guard<std::mutex> guard(Lock);
+
+    if (Pid > 0)
+        return TError::Success();
+
+    error = TUnixSocket::SocketPair(Sock, sock);
+    if (error)
+        return error;
+
+    /* Slave is still single-threaded: plain fork is safe */
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = TError(EError::Unknown, errno, "fork()");
+        Sock.Close();
+        return error;
+    }
+
+    if (pid == 0)
+        SpawnerMain(sock.GetFd());
+
+    Pid = pid;
+    return TError::Success();
+}
+
+void TSpawner::Stop() {
+    std::lock_guard<std::mutex> guard(Lock);
+
+    if (Pid <= 0)
+        return;
+
+    Sock.Close();
+    (void)kill(Pid, SIGKILL);
+    (void)waitpid(Pid, nullptr, 0);
+    Pid = 0;
+}
+
+TError TSpawner::Spawn(const TSpawnRequest &request) {
+    std::vector<int> fds;
+    std::string data;
+    TError error;
+
+    request.Serialize(data, fds);
+
+    std::lock_guard<std::mutex> guard(Lock);
+
+    if (Pid <= 0)
+        return TError(EError::Unknown, "Spawner isn't running");
+
+    error = Sock.SendFds(data, fds);
+    if (error) {
+        L_ERR() << "Spawner failed: " << error << std::endl;
+        Sock.Close();
+        (void)kill(Pid, SIGKILL);
+        (void)waitpid(Pid, nullptr, 0);
+        Pid = 0;
+    }
+
+    return error;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include "util/cred.hpp"
+#include "util/unix.hpp"
+
+extern "C" {
+#include <sys/resource.h>
+}
+
+/*
+ * Everything task needs for start when it isn't configured by forked
+ * copy of slave: plain values and descriptors opened in slave context.
+ * Descriptor -1 means "not used", streams are opened inside then.
+ */
+struct TSpawnRequest {
+    std::string Name;
+    std::string Command;
+    std::vector<std::string> Environ;
+    std::string Cwd;
+    std::string InsidePath[3];
+    TCred Cred;
+    TCred OwnerCred;
+    TCapabilities CapAmbient;
+    TCapabilities CapLimit;
+    std::map<int, struct rlimit> Rlimit;
+    mode_t Umask;
+    bool Isolate = false;       /* new pid, ipc, uts namespaces and /proc */
+    bool NewMountNs = false;    /* private /sys at host root, no binds */
+
+    int Sock = -1;
+    std::vector<int> Cgroups;   /* cgroup.procs */
+    int Streams[3] = { -1, -1, -1 };
+    int Namespaces[7] = { -1, -1, -1, -1, -1, -1, -1 };
+    int PortoInit = -1;         /* pid 1 for application inside */
+
+    void Serialize(std::string &data, std::vector<int> &fds) const;
+    TError Deserialize(const std::string &data, const std::vector<int> &fds);
+
+    void Spawn() const;
+    void Exec(int wakeup, int initSock) const;
+
+private:
+    void Abort(const TError &error) const;
+    TError MountFs() const;
+    TError StartInit(int initSock) const;
+};
+
+/*
+ * Zygote forked from slave before any thread is started. It receives
+ * spawn requests over unix socket and forks tasks from its own small
+ * and single-threaded address space instead of forking whole slave.
+ */
+class TSpawner : public TNonCopyable {
+    std::mutex Lock;
+    TUnixSocket Sock;
+    pid_t Pid = 0;
+
+    static void SpawnerMain(int sock);
+
+public:
+    TError Start();
+    void Stop();
+    bool IsRunning() const { return Pid > 0; }
+    TError Spawn(const TSpawnRequest &request);
+};
+
+extern TSpawner Spawner;
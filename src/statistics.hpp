@@ -22,6 +22,23 @@ struct TStatistics {
     std::atomic<uint64_t> Clients;
     std::atomic<uint64_t> RequestsQueued;
     std::atomic<uint64_t> RequestsCompleted;
+    std::atomic<uint64_t> StatSamples;
+    std::atomic<uint64_t> StatSampleHits;
+    std::atomic<uint64_t> CgroupReads;
+    std::atomic<uint64_t> CgroupReadsMemoized;
+    std::atomic<uint64_t> CgroupsDeferred;
+    std::atomic<uint64_t> CgroupsReaped;
+    std::atomic<uint64_t> CgroupsLeaked;
+    std::atomic<uint64_t> TeardownQueued;
+    std::atomic<uint64_t> MemPressureEvents;
+    std::atomic<uint64_t> MemThresholdEvents;
+    std::atomic<uint64_t> SpawnerStarts;
+    std::atomic<uint64_t> WarmCgroupHits;
+    std::atomic<uint64_t> WarmCgroupMisses;
+    std::atomic<uint64_t> WarmNetnsHits;
+    std::atomic<uint64_t> WarmNetnsMisses;
+    std::atomic<uint64_t> ExecStarts;
+    std::atomic<uint64_t> LogLinesLost;
 };
 
 extern TStatistics *Statistics;
@@ -1,10 +1,14 @@
+#include <algorithm>
+
 #include "stream.hpp"
 #include "config.hpp"
+#include "epoll.hpp"
 #include "util/log.hpp"
 #include "client.hpp"
 #include "container.hpp"
 
 extern "C" {
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -34,12 +38,14 @@ TPath TStdStream::ResolveOutside(const TContainer &container) const {
     return container.RootPath / container.GetCwd() / Path;
 }
 
-TError TStdStream::Open(const TPath &path, const TCred &cred) {
+TError TStdStream::Open(const TPath &path, const TCred &cred, TFile *file) {
     int fd, flags;
 
     Offset = 0;
 
-    if (Stream)
+    if (Stream && IsCaptured())
+        flags = O_RDWR;
+    else if (Stream)
         flags = O_WRONLY | O_APPEND;
     else
         flags = O_RDONLY;
@@ -47,19 +53,28 @@ TError TStdStream::Open(const TPath &path, const TCred &cred) {
     /* Never assign controlling terminal at open */
     flags |= O_NOCTTY;
 
+    if (file)
+        flags |= O_CLOEXEC;
+
 retry:
     fd = open(path.c_str(), flags);
     if (fd < 0 && errno == ENOENT && Stream) {
         fd = open(path.c_str(), flags | O_CREAT | O_EXCL, 0660);
         if (fd < 0 && errno == EEXIST)
             goto retry;
-        if (fd >= 0 && fchown(fd, cred.Uid, cred.Gid))
-            return TError(EError::Unknown, errno, "fchown " + path.ToString());
+        if (fd >= 0 && fchown(fd, cred.Uid, cred.Gid)) {
+            TError error(EError::Unknown, errno, "fchown " + path.ToString());
+            close(fd);
+            return error;
+        }
     }
     if (fd < 0)
         return TError(EError::InvalidValue, errno, "open " + path.ToString());
 
-    if (fd != Stream) {
+    if (file) {
+        file->Close();
+        file->SetFd = fd;
+    } else if (fd != Stream) {
         if (dup2(fd, Stream) < 0) {
             close(fd);
             return TError(EError::Unknown, errno, "dup2(" + std::to_string(fd) +
@@ -72,9 +87,9 @@ retry:
 }
 
 TError TStdStream::OpenOutside(const TContainer &container,
-                               const TClient &client) {
+                               const TClient &client, TFile *file) {
     if (IsNull())
-        return Open("/dev/null", container.OwnerCred);
+        return Open("/dev/null", container.OwnerCred, file);
 
     if (IsRedirect()) {
         int clientFd = -1;
@@ -89,18 +104,18 @@ TError TStdStream::OpenOutside(const TContainer &container,
             return error;
 
         TPath path(StringFormat("/proc/%u/fd/%u", client.Pid, clientFd));
-        error = Open(path, container.OwnerCred);
+        error = Open(path, container.OwnerCred, file);
         if (error)
             return error;
 
         /* check permissions agains our copy */
-        path = StringFormat("/proc/self/fd/%u", Stream);
+        path = StringFormat("/proc/self/fd/%u", file ? file->Fd : Stream);
         if (!path.HasAccess(client.TaskCred, Stream ? TPath::W : TPath::R) &&
                 !path.HasAccess(client.Cred, Stream ? TPath::W : TPath::R))
             return TError(EError::Permission,
                     "Not enough permissions for redirect: " + Path.ToString());
     } else if (Outside)
-        return Open(ResolveOutside(container), container.OwnerCred);
+        return Open(ResolveOutside(container), container.OwnerCred, file);
 
     return TError::Success();
 }
@@ -133,6 +148,146 @@ TError TStdStream::Remove(const TContainer &container) {
     return error;
 }
 
+/* Only default files in working directory are replaced with fifo */
+bool TStdStream::IsCaptured(void) const {
+    return Memory && Stream && Outside && !IsNull() && !IsRedirect() &&
+        !Path.IsAbsolute();
+}
+
+TError TStdStream::StartCapture(const TContainer &container, bool restore) {
+    TPath path = ResolveOutside(container);
+    TError error;
+
+    StopCapture(!restore);
+
+    if (!IsCaptured())
+        return TError::Success();
+
+    if (!restore) {
+        if (path.Exists()) {
+            error = path.Unlink();
+            if (error)
+                return error;
+        }
+        error = path.Mknod(S_IFIFO | 0660, 0);
+        if (error)
+            return error;
+    }
+
+    /* owner controls this directory: never follow or chown by path */
+    error = Pipe.Open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY |
+                            O_NOFOLLOW | O_CLOEXEC);
+    if (error)
+        return error;
+
+    struct stat st;
+    if (fstat(Pipe.Fd, &st) || !S_ISFIFO(st.st_mode)) {
+        Pipe.Close();
+        return TError(EError::Unknown, "Not a fifo: " + path.ToString());
+    }
+
+    if (!restore && fchown(Pipe.Fd, container.OwnerCred.Uid,
+                           container.OwnerCred.Gid)) {
+        error = TError(EError::Unknown, errno, "fchown " + path.ToString());
+        Pipe.Close();
+        return error;
+    }
+
+    return TError::Success();
+}
+
+void TStdStream::StopCapture(bool clear) {
+    if (Pipe.Fd >= 0) {
+        (void)Drain();
+        if (Source)
+            Source->EpollLoop->RemoveSource(Source->Fd);
+        Source = nullptr;
+        Pipe.Close();
+    }
+
+    if (clear) {
+        Ring.clear();
+        Ring.shrink_to_fit();
+        RingSize = 0;
+        Written = 0;
+        Offset = 0;
+    }
+}
+
+/* Returns false when all writers are gone */
+bool TStdStream::Drain(void) {
+    char buf[65536];
+
+    /* Bounded per wakeup, rest comes at next one */
+    for (int i = 0; i < 16; i++) {
+        ssize_t len = read(Pipe.Fd, buf, sizeof(buf));
+        if (len > 0)
+            Append(buf, len);
+        else if (len == 0)
+            return false;
+        else
+            return errno == EAGAIN || errno == EINTR;
+    }
+
+    return true;
+}
+
+void TStdStream::Append(const char *data, size_t len) {
+    /* Limit has been changed: move tail into ring of new size */
+    if (RingSize != Limit) {
+        std::string tail;
+
+        ReadRing(Offset, Written - Offset, tail);
+        Ring.clear();
+        Ring.shrink_to_fit();
+        RingSize = Limit;
+        Written = Offset;
+        if (tail.size())
+            Append(tail.data(), tail.size());
+    }
+
+    if (!RingSize) {
+        Written += len;
+        Offset = Written;
+        return;
+    }
+
+    if (len > RingSize) {
+        Written += len - RingSize;
+        data += len - RingSize;
+        len = RingSize;
+    }
+
+    while (len) {
+        size_t pos = Written % RingSize;
+        size_t chunk = std::min<size_t>(len, RingSize - pos);
+
+        if (Ring.size() < pos + chunk)
+            Ring.resize(pos + chunk);
+        memcpy(&Ring[pos], data, chunk);
+        data += chunk;
+        len -= chunk;
+        Written += chunk;
+    }
+
+    if (Written - Offset > RingSize)
+        Offset = Written - RingSize;
+}
+
+void TStdStream::ReadRing(uint64_t offset, uint64_t len, std::string &text) const {
+    text.clear();
+    if (!RingSize)
+        return;
+    text.reserve(len);
+    while (len) {
+        size_t pos = offset % RingSize;
+        size_t chunk = std::min<uint64_t>(len, RingSize - pos);
+        text.append(Ring, pos, chunk);
+        offset += chunk;
+        len -= chunk;
+    }
+}
+
 TError TStdStream::Rotate(const TContainer &container) {
     TPath path = ResolveOutside(container);
     if (path.IsEmpty() || !path.IsRegularStrict())
@@ -153,12 +308,14 @@ TError TStdStream::Read(const TContainer &container, std::string &text,
     uint64_t offset, limit;
     TError error;
     TPath path = ResolveOutside(container);
+    bool ring = IsCaptured();
 
-    if (path.IsEmpty())
+    /* Captured stream is served from memory */
+    if (!ring && path.IsEmpty())
         return TError(EError::InvalidData, "Data not available");
-    if (!path.Exists())
+    if (!ring && !path.Exists())
         return TError(EError::InvalidData, "File not found");
-    if (!path.IsRegularStrict())
+    if (!ring && !path.IsRegularStrict())
         return TError(EError::InvalidData, "File is non-regular");
 
     /* [offset][:limit] */
@@ -188,6 +345,20 @@ TError TStdStream::Read(const TContainer &container, std::string &text,
     } else
         limit = Limit;
 
+    if (ring) {
+        uint64_t size = Written - Offset;
+
+        if (size <= offset)
+            limit = 0;
+        else if (size <= offset + limit)
+            limit = size - offset;
+        else if (!off.size())
+            offset = size - limit;
+
+        ReadRing(Offset + offset, limit, text);
+        return TError::Success();
+    }
+
     TFile file;
 
     error = file.Open(path, O_RDONLY | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC);
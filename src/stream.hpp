@@ -1,10 +1,12 @@
 #pragma once
 
 #include <string>
+#include <memory>
 #include <util/path.hpp>
 
 class TContainer;
 class TClient;
+struct TEpollSource;
 
 class TStdStream {
 public:
@@ -14,6 +16,19 @@ public:
     uint64_t Limit = 0;
     uint64_t Offset = 0;
 
+    /*
+     * Memory capture: default stdout/stderr is a fifo in working directory,
+     * task opens it read-write thus never gets SIGPIPE while portod is
+     * away, portod drains it into ring buffer of Limit bytes.
+     * Byte at offset N lives at Ring[N % RingSize].
+     */
+    bool Memory = false;
+    TFile Pipe;
+    std::shared_ptr<TEpollSource> Source;
+    std::string Ring;
+    uint64_t RingSize = 0;
+    uint64_t Written = 0;
+
     TStdStream(int stream): Stream(stream) { }
 
     void SetOutside(const std::string &path) {
@@ -30,12 +45,21 @@ public:
     bool IsRedirect(void) const;
     TPath ResolveOutside(const TContainer &container) const;
 
-    TError Open(const TPath &path, const TCred &cred);
-    TError OpenOutside(const TContainer &container, const TClient &client);
+    /* With file stream is opened there instead of fixed fd */
+    TError Open(const TPath &path, const TCred &cred, TFile *file = nullptr);
+    TError OpenOutside(const TContainer &container, const TClient &client,
+                       TFile *file = nullptr);
     TError OpenInside(const TContainer &container);
 
     TError Remove(const TContainer &container);
 
+    bool IsCaptured(void) const;
+    TError StartCapture(const TContainer &container, bool restore);
+    void StopCapture(bool clear);
+    bool Drain(void);
+    void Append(const char *data, size_t len);
+    void ReadRing(uint64_t offset, uint64_t len, std::string &text) const;
+
     TError Rotate(const TContainer &container);
     TError Read(const TContainer &container, std::string &text,
                 const std::string &range = "") const;
@@ -2,10 +2,13 @@
 #include <sstream>
 #include <iterator>
 #include <csignal>
+#include <list>
 
 #include "task.hpp"
 #include "device.hpp"
 #include "config.hpp"
+#include "spawner.hpp"
+#include "statistics.hpp"
 #include "util/log.hpp"
 #include "util/string.hpp"
 #include "util/signal.hpp"
@@ -86,9 +89,14 @@ TError TTaskEnv::ChildExec() {
                       std::to_string(PortoInit.Fd) +  ", portoinit)");
     }
 
+    return ExecCommand(CT->Command, envp, Sock.GetFd());
+}
+
+/* Environment must be applied for wordexp, keepFd reports exec failure */
+TError ExecCommand(const std::string &command, char **envp, int keepFd) {
     wordexp_t result;
 
-    int ret = wordexp(CT->Command.c_str(), &result, WRDE_NOCMD | WRDE_UNDEF);
+    int ret = wordexp(command.c_str(), &result, WRDE_NOCMD | WRDE_UNDEF);
     switch (ret) {
     case WRDE_BADCHAR:
         return TError(EError::Unknown, EINVAL, "wordexp(): illegal occurrence of newline or one of |, &, ;, <, >, (, ), {, }");
@@ -106,14 +114,14 @@ TError TTaskEnv::ChildExec() {
     }
 
     if (Verbose) {
-        L() << "command=" << CT->Command << std::endl;
+        L() << "command=" << command << std::endl;
         for (unsigned i = 0; result.we_wordv[i]; i++)
             L() << "argv[" << i << "]=" << result.we_wordv[i] << std::endl;
         for (unsigned i = 0; envp[i]; i++)
             L() << "environ[" << i << "]=" << envp[i] << std::endl;
     }
     SetDieOnParentExit(0);
-    TFile::CloseAll({0, 1, 2, Sock.GetFd()});
+    TFile::CloseAll({0, 1, 2, keepFd});
     execvpe(result.we_wordv[0], (char *const *)result.we_wordv, envp);
 
     return TError(EError::InvalidValue, errno, std::string("execvpe(") +
@@ -396,13 +404,232 @@ void TTaskEnv::StartChild() {
     Abort(error);
 }
 
+/*
+ * Tasks at host root are started by spawner: it creates pid, ipc, uts
+ * and mount namespaces, remounts /proc and /sys and starts portoinit.
+ * Chroot, binds, devices, hostname and resolv.conf need forked slave.
+ */
+bool TTaskEnv::UseSpawner() const {
+    return Spawner.IsRunning() && config().daemon().spawner() &&
+        !CT->Command.empty() && !TripleFork &&
+        Mnt.Root.IsRoot() && !Mnt.RootRdOnly && Mnt.BindMounts.empty() &&
+        CT->Hostname.empty() && CT->ResolvConf.empty() &&
+        Devices.empty() && Autoconf.empty();
+}
+
+/* Credentials, limits, cgroups and namespaces: common for task and exec */
+TError TTaskEnv::PrepareSpawn(TSpawnRequest &request, std::list<TFile> &files) {
+    const TNamespaceFd *ns[7] = {
+        &ParentNs.Ipc, &ParentNs.Uts, &ParentNs.Net, &ParentNs.Pid,
+        &ParentNs.Mnt, &ParentNs.Root, &ParentNs.Cwd,
+    };
+    TError error;
+
+    error = TUnixSocket::SocketPair(MasterSock, Sock);
+    if (error)
+        return error;
+
+    request.Name = CT->GetName();
+    for (char **env = Env.Envp(); *env; env++)
+        request.Environ.push_back(*env);
+    request.Cwd = Mnt.Cwd.ToString();
+    request.Cred = Cred;
+    request.OwnerCred = CT->OwnerCred;
+    request.CapAmbient = CT->CapAmbient;
+    request.CapLimit = CT->CapLimit;
+    request.Rlimit = CT->Rlimit;
+    request.Umask = CT->Umask;
+    request.Sock = Sock.GetFd();
+
+    for (auto &cg: Cgroups) {
+        files.emplace_back();
+        error = files.back().OpenWrite(cg.Knob("cgroup.procs"));
+        if (error)
+            return error;
+        request.Cgroups.push_back(files.back().Fd);
+    }
+
+    for (int i = 0; i < 7; i++)
+        request.Namespaces[i] = ns[i]->GetFd();
+
+    return TError::Success();
+}
+
+TError TTaskEnv::SendSpawner() {
+    TStdStream *streams[3] = { &CT->Stdin, &CT->Stdout, &CT->Stderr };
+    std::list<TFile> files;
+    TSpawnRequest request;
+    TError error;
+
+    error = PrepareSpawn(request, files);
+    if (error)
+        return error;
+
+    request.Command = CT->Command;
+    request.Isolate = CT->Isolate;
+    request.NewMountNs = NewMountNs;
+    if (QuadroFork)
+        request.PortoInit = PortoInit.Fd;
+
+    /* Default streams and redirections are outside */
+    for (int i = 0; i < 3; i++) {
+        /* Open() resets offset, for forked spawn-p only in its copy */
+        uint64_t offset = streams[i]->Offset;
+        files.emplace_back();
+        error = streams[i]->OpenOutside(*CT, *Client, &files.back());
+        streams[i]->Offset = offset;
+        if (error)
+            return error;
+        request.Streams[i] = files.back().Fd;
+        if (request.Streams[i] < 0 && !streams[i]->Outside)
+            request.InsidePath[i] = streams[i]->Path.ToString();
+    }
+
+    error = Spawner.Spawn(request);
+    Sock.Close();
+    return error;
+}
+
+TError TTaskEnv::WaitSpawner() {
+    uint64_t waitUs = 0;
+    TError error;
+    int status;
+
+    error = MasterSock.SetRecvTimeout(config().container().start_timeout_ms());
+    if (error)
+        goto kill_all;
+
+    waitUs = GetCurrentTimeUs();
+
+    error = MasterSock.RecvPid(CT->WaitTask.Pid, CT->TaskVPid);
+    if (error)
+        goto kill_all;
+
+    error = MasterSock.RecvInt(status);
+    if (!error && status)
+        error = MasterSock.RecvError();
+    if (error)
+        goto kill_all;
+
+    error = MasterSock.RecvPid(CT->Task.Pid, CT->TaskVPid);
+    if (error)
+        goto kill_all;
+
+    error = MasterSock.SendZero();
+    if (error)
+        L() << "Task wakeup error: " << error << std::endl;
+
+    error = MasterSock.RecvError();
+    if (error)
+        goto kill_all;
+
+    ReportWaitUs = GetCurrentTimeUs() - waitUs;
+    Statistics->SpawnerStarts++;
+    return TError::Success();
+
+kill_all:
+    L_ACT() << "Kill partialy constructed container: " << error << std::endl;
+    for (auto &cg : Cgroups)
+        (void)cg.KillAll(SIGKILL);
+    CT->Task.Pid = 0;
+    CT->TaskVPid = 0;
+    CT->WaitTask.Pid = 0;
+    return error;
+}
+
+/*
+ * Starts command in namespaces and cgroups of running container.
+ * Process is reaped by master as usual task, exit comes as event.
+ */
+TError TTaskEnv::Exec(const std::string &command, const std::string stdPath[3],
+                      pid_t &pid, pid_t &vpid) {
+    std::list<TFile> files;
+    TSpawnRequest request;
+    pid_t wpid = 0;
+    TError error;
+    int status;
+
+    pid = vpid = 0;
+
+    if (!Spawner.IsRunning() || !config().daemon().spawner())
+        return TError(EError::NotSupported, "Exec requires spawner");
+
+    error = PrepareSpawn(request, files);
+    if (error)
+        return error;
+
+    request.Command = command;
+
+    /* Empty paths are left at /dev/null of spawner */
+    for (int i = 0; i < 3; i++)
+        request.InsidePath[i] = stdPath[i];
+
+    error = Spawner.Spawn(request);
+    Sock.Close();
+    if (error)
+        return error;
+
+    error = MasterSock.SetRecvTimeout(config().container().start_timeout_ms());
+    if (error)
+        return error;
+
+    error = MasterSock.RecvPid(wpid, vpid);
+    if (error)
+        return error;
+
+    error = MasterSock.RecvInt(status);
+    if (!error && status)
+        error = MasterSock.RecvError();
+    if (error)
+        return error;
+
+    error = MasterSock.RecvPid(pid, vpid);
+    if (!error) {
+        /* Short command could exit and be reaped right after wakeup */
+        auto holder_lock = LockContainers();
+        ExecPids[wpid] = CT;
+        CT->ExecTasks[wpid].VPid = vpid;
+        holder_lock.unlock();
+        error = MasterSock.SendZero();
+    }
+    if (!error)
+        error = MasterSock.RecvError();
+    if (error) {
+        L_ACT() << "Kill partialy started exec: " << error << std::endl;
+        if (wpid > 0) {
+            auto holder_lock = LockContainers();
+            ExecPids.erase(wpid);
+            CT->ExecTasks.erase(wpid);
+            holder_lock.unlock();
+            (void)kill(wpid, SIGKILL);
+        }
+        pid = vpid = 0;
+        return error;
+    }
+
+    pid = wpid;
+    return TError::Success();
+}
+
 TError TTaskEnv::Start() {
+    uint64_t waitUs = 0;
     TError error;
 
     CT->Task.Pid = 0;
     CT->TaskVPid = 0;
     CT->WaitTask.Pid = 0;
 
+    if (UseSpawner()) {
+        error = SendSpawner();
+        if (!error)
+            return WaitSpawner();
+        if (Spawner.IsRunning())
+            return error;
+        L_WRN() << "Fallback to fork after spawner failure: " << error << std::endl;
+        MasterSock.Close();
+        Sock.Close();
+    }
+
     error = TUnixSocket::SocketPair(MasterSock, Sock);
     if (error)
         return error;
@@ -568,6 +795,8 @@ TError TTaskEnv::Start() {
     if (error)
         goto kill_all;
 
+    waitUs = GetCurrentTimeUs();
+
     error = MasterSock.RecvPid(CT->WaitTask.Pid, CT->TaskVPid);
     if (error)
         goto kill_all;
@@ -598,6 +827,7 @@ TError TTaskEnv::Start() {
         goto kill_all;
     }
 
+    ReportWaitUs = GetCurrentTimeUs() - waitUs;
     return TError::Success();
 
 kill_all:
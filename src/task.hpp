@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <list>
 
 #include "util/namespace.hpp"
 #include "util/path.hpp"
@@ -16,6 +17,10 @@ extern "C" {
 #include <sys/resource.h>
 }
 
+struct TSpawnRequest;
+
+TError ExecCommand(const std::string &command, char **envp, int keepFd);
+
 struct TTaskEnv {
     std::shared_ptr<TContainer> CT;
     TClient *Client;
@@ -34,10 +39,19 @@ struct TTaskEnv {
     TUnixSocket Sock, MasterSock;
     TUnixSocket Sock2, MasterSock2;
     int ReportStage = 0;
+    uint64_t ReportWaitUs = 0;  /* waiting for task reports */
 
     TError Start();
     void StartChild();
 
+    bool UseSpawner() const;
+    TError PrepareSpawn(TSpawnRequest &request, std::list<TFile> &files);
+    TError SendSpawner();
+    TError WaitSpawner();
+
+    TError Exec(const std::string &command, const std::string stdPath[3],
+                pid_t &pid, pid_t &vpid);
+
     TError ConfigureChild();
     TError ChildApplyLimits();
     TError WriteResolvConf();
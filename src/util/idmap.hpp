@@ -6,10 +6,20 @@
 #include "common.hpp"
 #include "log.hpp"
 
+/* Bitmap id allocator: free id lookup scans 64 ids per word starting from hint */
 class TIdMap : public TNonCopyable {
 private:
     int Base;
-    std::vector<bool> Used;
+    int Size = 0;
+    size_t Hint = 0; /* no free ids in words before this */
+    std::vector<uint64_t> Used;
+
+    static constexpr int WordBits = 64;
+
+    bool IsUsed(int index) const {
+        return Used[index / WordBits] & (1ull << (index % WordBits));
+    }
+
 public:
     TIdMap(int base, int size) {
         Base = base;
@@ -17,35 +27,55 @@ public:
     }
 
     void Resize(int size) {
-        Used.resize(size, false);
+        int words = (size + WordBits - 1) / WordBits;
+
+        /* release padding bits of former last word */
+        for (int index = Size; index < std::min(size, (int)Used.size() * WordBits); index++)
+            Used[index / WordBits] &= ~(1ull << (index % WordBits));
+
+        Used.resize(words, 0);
+        Size = size;
+
+        /* padding bits beyond size are never allocated */
+        if (size % WordBits)
+            Used[words - 1] |= ~0ull << (size % WordBits);
+
+        Hint = 0;
     }
 
     TError GetAt(int id) {
-        if (id < Base || id >= Base + (int)Used.size())
+        if (id < Base || id >= Base + Size)
             return TError(EError::Unknown, "Id " + std::to_string(id) + " out of range");
-        if (Used[id - Base])
+        int index = id - Base;
+        if (IsUsed(index))
             return TError(EError::Unknown, "Id " + std::to_string(id) + " already used");
-        Used[id - Base] = true;
+        Used[index / WordBits] |= 1ull << (index % WordBits);
         return TError::Success();
     }
 
     TError Get(int &id) {
-        auto it = std::find(Used.begin(), Used.end(), false);
-        if (it == Used.end()) {
-            id = -1;
-            return TError(EError::ResourceNotAvailable, "Cannot allocate id");
+        for (size_t word = Hint; word < Used.size(); word++) {
+            if (Used[word] == ~0ull)
+                continue;
+            int bit = __builtin_ctzll(~Used[word]);
+            Used[word] |= 1ull << bit;
+            Hint = word;
+            id = Base + word * WordBits + bit;
+            return TError::Success();
         }
-        id = Base + (it - Used.begin());
-        *it = true;
-        return TError::Success();
+        Hint = Used.size();
+        id = -1;
+        return TError(EError::ResourceNotAvailable, "Cannot allocate id");
     }
 
     TError Put(int id) {
-        if (id < Base || id >= Base + (int)Used.size())
+        if (id < Base || id >= Base + Size)
             return TError(EError::Unknown, "Id out of range");
-        if (!Used[id - Base])
+        int index = id - Base;
+        if (!IsUsed(index))
             return TError(EError::Unknown, "Freeing not allocated id");
-        Used[id - Base] = false;
+        Used[index / WordBits] &= ~(1ull << (index % WordBits));
+        Hint = std::min(Hint, (size_t)(index / WordBits));
         return TError::Success();
     }
 };
@@ -1,4 +1,10 @@
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstring>
 
 #include "statistics.hpp"
 #include "log.hpp"
@@ -10,6 +16,10 @@ extern "C" {
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
 }
 
 bool Verbose;
@@ -18,7 +28,11 @@ TStatistics *Statistics = nullptr;
 
 //FIXME KILL THIS SHIT
 
+/* Stream buffer flushes at most this, longer lines come in pieces */
+static constexpr size_t LOG_LINE_MAX = 1024;
+
 static int logBufFd = STDERR_FILENO;
+static std::mutex logFdLock;    /* writer thread vs reopen */
 class TLogBuf : public std::streambuf {
     std::vector<char> Data;
 public:
@@ -35,18 +49,278 @@ protected:
     int_type overflow(int_type ch) override;
 };
 
+/*
+ * Async mode: complete lines are queued into bounded lock-free ring and
+ * written by background thread in batches with writev(). Producers never
+ * block or take locks: if ring is full line is dropped and counted.
+ *
+ * Slot is free for position P when its Seq == P, filled when Seq == P + 1,
+ * writer frees it for next round with Seq = P + size. Consumer claims slot
+ * by advancing tail, so crash handler could take lines from writer.
+ * Lines are copied into buffers preallocated in slots: no allocations.
+ */
+struct TLogSlot {
+    std::atomic<uint64_t> Seq;
+    size_t Len;
+    char Data[LOG_LINE_MAX];
+};
+
+static std::unique_ptr<TLogSlot[]> logRing;
+static uint64_t logRingSize;
+static std::atomic<uint64_t> logHead;   /* next position for producers */
+static std::atomic<uint64_t> logTail;   /* next position for consumer */
+static std::atomic<bool> logAsync;
+static std::atomic<bool> logSleeping;
+static std::atomic<bool> logStopping;
+static std::atomic<uint64_t> logLost;
+static std::thread *logThread;
+static int logEventFd = -1;
+
+static bool QueueLogLine(const char *data, size_t len) {
+    uint64_t pos = logHead.load(std::memory_order_relaxed);
+
+    while (true) {
+        TLogSlot &slot = logRing[pos % logRingSize];
+        uint64_t seq = slot.Seq.load(std::memory_order_acquire);
+
+        if (seq == pos) {
+            if (logHead.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+                slot.Len = std::min(len, LOG_LINE_MAX);
+                memcpy(slot.Data, data, slot.Len);
+                slot.Seq.store(pos + 1);
+                break;
+            }
+        } else if (seq < pos) {
+            logLost++;
+            if (Statistics)
+                Statistics->LogLinesLost++;
+            return false;
+        } else
+            pos = logHead.load(std::memory_order_relaxed);
+    }
+
+    if (logSleeping.exchange(false)) {
+        uint64_t one = 1;
+        (void)write(logEventFd, &one, sizeof(one));
+    }
+
+    return true;
+}
+
+static bool LogQueued() {
+    uint64_t pos = logTail.load();
+    return logRing[pos % logRingSize].Seq.load() == pos + 1;
+}
+
+/* Returns filled slot owned by caller or nullptr */
+static TLogSlot *ClaimLogSlot(uint64_t &pos) {
+    pos = logTail.load();
+    while (logRing[pos % logRingSize].Seq.load(std::memory_order_acquire) == pos + 1) {
+        if (logTail.compare_exchange_weak(pos, pos + 1))
+            return &logRing[pos % logRingSize];
+    }
+    return nullptr;
+}
+
+static void TakeLogLines(std::vector<uint64_t> &taken, size_t max) {
+    uint64_t pos;
+
+    while (taken.size() < max && ClaimLogSlot(pos))
+        taken.push_back(pos);
+}
+
+/* Writes lines right from taken slots and frees them after that */
+static void WriteLogLines(std::vector<uint64_t> &taken, const std::string &extra = "") {
+    std::vector<struct iovec> iov;
+    size_t i = 0;
+
+    iov.reserve(taken.size() + 1);
+    for (auto pos: taken) {
+        TLogSlot &slot = logRing[pos % logRingSize];
+        iov.push_back({ slot.Data, slot.Len });
+    }
+    if (!extra.empty())
+        iov.push_back({ (void *)extra.data(), extra.size() });
+
+    size_t nr = iov.size();
+
+    std::lock_guard<std::mutex> guard(logFdLock);
+
+    while (i < nr) {
+        ssize_t ret = writev(logBufFd, &iov[i], std::min(nr - i, (size_t)IOV_MAX));
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (; i < nr && (size_t)ret >= iov[i].iov_len; i++)
+            ret -= iov[i].iov_len;
+        if (i < nr) {
+            iov[i].iov_base = (char *)iov[i].iov_base + ret;
+            iov[i].iov_len -= ret;
+        }
+    }
+
+    for (auto pos: taken)
+        logRing[pos % logRingSize].Seq.store(pos + logRingSize,
+                                             std::memory_order_release);
+    taken.clear();
+}
+
+static void LogWriter() {
+    std::vector<uint64_t> taken;
+    uint64_t lost = logLost;
+
+    SetProcessName("portod-log");
+
+    while (true) {
+        TakeLogLines(taken, IOV_MAX);
+
+        if (taken.empty()) {
+            if (logStopping)
+                break;
+
+            /* producer wakes us if it sees this flag after publishing */
+            logSleeping = true;
+            if (LogQueued() || logStopping) {
+                logSleeping = false;
+                continue;
+            }
+
+            uint64_t val;
+            (void)read(logEventFd, &val, sizeof(val));
+            continue;
+        }
+
+        std::string overflow;
+        if (logLost != lost) {
+            uint64_t now = logLost;
+            overflow = CurrentTimeFormat("%F %T") +
+                " portod-log: WRN Log queue overflow, lost " +
+                std::to_string(now - lost) + " lines\n";
+            lost = now;
+        }
+
+        WriteLogLines(taken, overflow);
+    }
+}
+
+/*
+ * Called from fatal signal handler: only atomics and write(2) here.
+ * No locks, no allocations, writer thread is left as is. Slots aren't
+ * freed - process is going to die anyway.
+ */
+void TLogger::CrashWriter() {
+    if (!logAsync.exchange(false) || !logRing)
+        return;
+
+    TLogSlot *slot;
+    uint64_t pos;
+
+    while ((slot = ClaimLogSlot(pos))) {
+        const char *buf = slot->Data;
+        size_t len = slot->Len;
+
+        while (len) {
+            ssize_t ret = write(logBufFd, buf, len);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret <= 0)
+                break;
+            buf += ret;
+            len -= ret;
+        }
+    }
+}
+
+static void LogAtForkPrepare() {
+    logFdLock.lock();
+}
+
+static void LogAtForkParent() {
+    logFdLock.unlock();
+}
+
+/* Writer thread doesn't exist in child, log synchronously there */
+static void LogAtForkChild() {
+    logFdLock.unlock();
+    logAsync = false;
+    logThread = nullptr;
+    logEventFd = -1;
+}
+
+void TLogger::StartWriter(size_t size) {
+    static bool atfork = false;
+
+    if (logThread || !size)
+        return;
+
+    logEventFd = eventfd(0, EFD_CLOEXEC);
+    if (logEventFd < 0)
+        return;
+
+    if (!atfork) {
+        pthread_atfork(LogAtForkPrepare, LogAtForkParent, LogAtForkChild);
+        atexit(TLogger::StopWriter);
+        atfork = true;
+    }
+
+    logRingSize = size;
+    logRing.reset(new TLogSlot[size]);
+    for (uint64_t i = 0; i < size; i++) {
+        logRing[i].Seq = i;
+        logRing[i].Len = 0;
+    }
+    logHead = 0;
+    logTail = 0;
+    logStopping = false;
+    logSleeping = false;
+
+    logThread = new std::thread(LogWriter);
+    logAsync = true;
+}
+
+/* Flushes queue and switches to synchronous writes, not for signal handlers */
+void TLogger::StopWriter() {
+    if (!logThread)
+        return;
+
+    logAsync = false;
+
+    /* crash in writer itself */
+    if (logThread->get_id() == std::this_thread::get_id())
+        return;
+
+    logStopping = true;
+    uint64_t one = 1;
+    (void)write(logEventFd, &one, sizeof(one));
+    logThread->join();
+    delete logThread;
+    logThread = nullptr;
+
+    /* lines queued by producers which haven't seen logAsync change */
+    std::vector<uint64_t> taken;
+    TakeLogLines(taken, SIZE_MAX);
+    WriteLogLines(taken);
+
+    close(logEventFd);
+    logEventFd = -1;
+}
+
 static __thread TLogBuf *logBuf;
 static __thread std::ostream *logStream;
 
 static inline void PrepareLog() {
     if (!logBuf) {
-        logBuf = new TLogBuf(1024);
+        logBuf = new TLogBuf(LOG_LINE_MAX);
         logStream = new std::ostream(logBuf);
     }
 }
 
 void TLogger::OpenLog(bool std, const TPath &path, const unsigned int mode) {
     PrepareLog();
+    std::lock_guard<std::mutex> guard(logFdLock);
     if (std) {
         // because in task.cpp we expect that nothing should be in 0-2 fd,
         // we need to duplicate our std log somewhere else
@@ -61,6 +335,7 @@ void TLogger::OpenLog(bool std, const TPath &path, const unsigned int mode) {
 void TLogger::DisableLog() {
     PrepareLog();
     TLogger::CloseLog();
+    std::lock_guard<std::mutex> guard(logFdLock);
     logBuf->SetFd(-1);
 }
 
@@ -71,6 +346,7 @@ int TLogger::GetFd() {
 
 void TLogger::CloseLog() {
     PrepareLog();
+    std::lock_guard<std::mutex> guard(logFdLock);
     int fd = logBuf->GetFd();
     if (fd > 2)
         close(fd);
@@ -107,6 +383,14 @@ int TLogBuf::sync() {
     std::ptrdiff_t n = pptr() - pbase();
     pbump(-n);
 
+    if (!n)
+        return 0;
+
+    if (logAsync) {
+        QueueLogLine(pbase(), n);
+        return 0;
+    }
+
     int ret = write(logBufFd, pbase(), n);
     return (ret == n) ? 0 : -1;
 }
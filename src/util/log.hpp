@@ -30,6 +30,11 @@ public:
     static void CloseLog();
     static void DisableLog();
     static int GetFd();
+
+    /* Queue lines for background writer, size - queue length in lines */
+    static void StartWriter(size_t size);
+    static void StopWriter();
+    static void CrashWriter();
     static std::basic_ostream<char> &Log(ELogLevel level = LOG_NOTICE);
 };
 
@@ -251,6 +251,34 @@ TError TNlLink::ChangeNs(const std::string &newName, int nsFd) {
     return TError::Success();
 }
 
+/* Link must be down for rename, empty name and hw or mtu <= 0 are kept */
+TError TNlLink::Change(const std::string &newName, const std::string &hw, int mtu) {
+    auto change = rtnl_link_alloc();
+    if (!change)
+        return Error(-NLE_NOMEM, "Cannot allocate link");
+    if (!newName.empty())
+        rtnl_link_set_name(change, newName.c_str());
+    if (mtu > 0)
+        rtnl_link_set_mtu(change, mtu);
+    if (!hw.empty()) {
+        TNlAddr addr;
+        TError error = addr.Parse(AF_LLC, hw.c_str());
+        if (error) {
+            rtnl_link_put(change);
+            return error;
+        }
+        rtnl_link_set_addr(change, addr.Addr);
+    }
+    Dump("change", change);
+    int ret = rtnl_link_change(GetSock(), Link, change, 0);
+    rtnl_link_put(change);
+    if (ret < 0)
+        return Error(ret, "Cannot change link");
+    if (!newName.empty())
+        rtnl_link_set_name(Link, newName.c_str());
+    return TError::Success();
+}
+
 TError TNlLink::AddDirectRoute(const TNlAddr &addr) {
     struct rtnl_route *route;
     struct rtnl_nexthop *nh;
@@ -95,6 +95,7 @@ public:
     TError Up();
     TError Enslave(const std::string &name);
     TError ChangeNs(const std::string &newName, int nsFd);
+    TError Change(const std::string &newName, const std::string &hw, int mtu);
     TError AddIpVlan(const std::string &master,
                      const std::string &mode, int mtu);
     TError AddMacVlan(const std::string &master,
@@ -94,6 +94,7 @@ void Stacktrace() {
 }
 
 void Crash() {
+    TLogger::CrashWriter();
     L_ERR() << "Crashed" << std::endl;
     Stacktrace();
 
@@ -104,6 +105,7 @@ void Crash() {
 }
 
 void FatalSignal(int sig) {
+    TLogger::CrashWriter();
     L_ERR() << "Fatal signal: " << std::string(strsignal(sig)) << std::endl;
     Stacktrace();
 
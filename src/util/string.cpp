@@ -418,6 +418,67 @@ TError StringToStringMap(const std::string &value, TStringMap &result) {
     return TError::Success();
 }
 
+TError StringToBitMap(const std::string &str, TBitMap &bits, size_t limit) {
+    std::vector<std::string> ranges;
+    TError error;
+
+    bits.clear();
+
+    error = SplitString(StringTrim(str), ',', ranges);
+    if (error)
+        return error;
+
+    for (auto &range: ranges) {
+        std::vector<std::string> ends;
+        int first, last;
+
+        if (StringTrim(range).empty())
+            continue;
+
+        error = SplitString(range, '-', ends);
+        if (error || ends.size() < 1 || ends.size() > 2)
+            return TError(EError::InvalidValue, "Invalid range " + range);
+
+        error = StringToInt(StringTrim(ends[0]), first);
+        if (!error)
+            error = StringToInt(StringTrim(ends.back()), last);
+        if (error || first < 0 || last < first)
+            return TError(EError::InvalidValue, "Invalid range " + range);
+        if ((size_t)last >= limit)
+            return TError(EError::InvalidValue, "Range " + range + " is out of " +
+                          std::to_string(limit));
+
+        if (bits.size() <= (size_t)last)
+            bits.resize(last + 1, false);
+        for (int i = first; i <= last; i++)
+            bits[i] = true;
+    }
+
+    return TError::Success();
+}
+
+std::string BitMapToString(const TBitMap &bits) {
+    std::string str;
+
+    for (size_t i = 0; i < bits.size(); i++) {
+        if (!bits[i])
+            continue;
+
+        size_t last = i;
+        while (last + 1 < bits.size() && bits[last + 1])
+            last++;
+
+        if (str.size())
+            str += ",";
+        str += std::to_string(i);
+        if (last != i)
+            str += "-" + std::to_string(last);
+        i = last;
+    }
+
+    return str;
+}
+
 int CompareVersions(const std::string &a, const std::string &b) {
     return strverscmp(a.c_str(), b.c_str());
 }
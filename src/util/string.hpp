@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 
 #include "util/error.hpp"
 
@@ -52,4 +53,10 @@ TError StringToUintMap(const std::string &value, TUintMap &result);
 std::string StringMapToString(const TStringMap &map);
 TError StringToStringMap(const std::string &value, TStringMap &result);
 
+/* Kernel bitmap list format: "0-3,8" */
+typedef std::vector<bool> TBitMap;
+/* Bits at or above limit are rejected */
+TError StringToBitMap(const std::string &str, TBitMap &bits, size_t limit = SIZE_MAX);
+std::string BitMapToString(const TBitMap &bits);
+
 int CompareVersions(const std::string &a, const std::string &b);
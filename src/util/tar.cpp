@@ -0,0 +1,406 @@
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#include "util/tar.hpp"
+#include "util/unix.hpp"
+#include "util/string.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+}
+
+/* POSIX ustar header, GNU and pax extensions use the same block */
+struct TTarHeader {
+    char Name[100];
+    char Mode[8];
+    char Uid[8];
+    char Gid[8];
+    char Size[12];
+    char Mtime[12];
+    char Checksum[8];
+    char Type;
+    char Link[100];
+    char Magic[6];
+    char Version[2];
+    char Uname[32];
+    char Gname[32];
+    char DevMajor[8];
+    char DevMinor[8];
+    char Prefix[155];
+    char Pad[12];
+};
+
+static_assert(sizeof(TTarHeader) == 512, "tar header must be one block");
+
+constexpr size_t TAR_BLOCK = 512;
+
+static std::string TarString(const char *field, size_t size) {
+    return std::string(field, strnlen(field, size));
+}
+
+/* Octal with optional spaces and NULs around or GNU base-256 */
+static bool TarNumber(const char *field, size_t size, uint64_t &value) {
+    const unsigned char *ptr = (const unsigned char *)field;
+    size_t i = 0;
+
+    value = 0;
+
+    if (ptr[0] & 0x80) {
+        if (ptr[0] == 0xff)
+            return false;
+        value = ptr[0] & 0x7f;
+        for (i = 1; i < size; i++)
+            value = (value << 8) | ptr[i];
+        return true;
+    }
+
+    while (i < size && ptr[i] == ' ')
+        i++;
+    for (; i < size && ptr[i] >= '0' && ptr[i] <= '7'; i++)
+        value = value * 8 + (ptr[i] - '0');
+    for (; i < size; i++)
+        if (ptr[i] != ' ' && ptr[i] != 0)
+            return false;
+    return true;
+}
+
+static bool TarChecksum(const TTarHeader &hdr) {
+    const unsigned char *ptr = (const unsigned char *)&hdr;
+    const size_t off = offsetof(TTarHeader, Checksum);
+    uint64_t sum = 0, expected;
+    int64_t ssum = 0;
+
+    if (!TarNumber(hdr.Checksum, sizeof(hdr.Checksum), expected))
+        return false;
+
+    /* old archivers summed signed chars */
+    for (size_t i = 0; i < sizeof(hdr); i++) {
+        char c = (i >= off && i < off + sizeof(hdr.Checksum)) ? ' ' : ptr[i];
+        sum += (unsigned char)c;
+        ssum += (signed char)c;
+    }
+
+    return sum == expected || (uint64_t)ssum == expected;
+}
+
+/* Records "<length> <key>=<value>\n" */
+static TError ParsePax(const std::string &text, std::map<std::string, std::string> &pax) {
+    size_t pos = 0;
+
+    while (pos < text.size()) {
+        size_t space = text.find(' ', pos);
+        uint64_t len;
+
+        if (space == std::string::npos ||
+                StringToUint64(text.substr(pos, space - pos), len) ||
+                len <= space - pos || pos + len > text.size() ||
+                text[pos + len - 1] != '\n')
+            return TError(EError::InvalidData, "Malformed pax header");
+
+        std::string record = text.substr(space + 1, pos + len - space - 2);
+        size_t eq = record.find('=');
+        if (eq == std::string::npos)
+            return TError(EError::InvalidData, "Malformed pax record");
+
+        pax[record.substr(0, eq)] = record.substr(eq + 1);
+        pos += len;
+    }
+
+    return TError::Success();
+}
+
+TTarReader::~TTarReader() {
+    if (Decompressor) {
+        kill(Decompressor, SIGKILL);
+        (void)waitpid(Decompressor, nullptr, 0);
+    }
+}
+
+TError TTarReader::Open(const TPath &tarball) {
+    unsigned char magic[6] = {};
+    const char *command = nullptr;
+    int pfd[2];
+
+    TError error = Input.Open(tarball, O_RDONLY | O_NOCTTY | O_CLOEXEC);
+    if (error)
+        return error;
+
+    Buffer.resize(1 << 20);
+
+    ssize_t len = pread(Input.Fd, magic, sizeof(magic), 0);
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        command = "gzip";
+    else if (len >= 3 && !memcmp(magic, "BZh", 3))
+        command = "bzip2";
+    else if (len >= 6 && !memcmp(magic, "\xfd" "7zXZ", 6))
+        command = "xz";
+    else if (len >= 4 && !memcmp(magic, "\x28\xb5\x2f\xfd", 4))
+        command = "zstd";
+
+    if (!command)
+        return TError::Success();
+
+    Compression = command;
+
+    if (pipe2(pfd, O_CLOEXEC))
+        return TError(EError::Unknown, errno, "pipe2()");
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = TError(EError::Unknown, errno, "fork()");
+        close(pfd[0]);
+        close(pfd[1]);
+        return error;
+    }
+
+    if (!pid) {
+        SetDieOnParentExit(SIGKILL);
+        if (dup2(Input.Fd, STDIN_FILENO) < 0 ||
+                dup2(pfd[1], STDOUT_FILENO) < 0)
+            _exit(EXIT_FAILURE);
+        int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (null < 0 || dup2(null, STDERR_FILENO) < 0)
+            _exit(EXIT_FAILURE);
+        TFile::CloseAll({ STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO });
+        execlp(command, command, "-dc", nullptr);
+        _exit(2);
+    }
+
+    close(pfd[1]);
+    Input.Close();
+    Input.SetFd = pfd[0];
+    Decompressor = pid;
+
+    return TError::Success();
+}
+
+TError TTarReader::Close(bool failed) {
+    TError error;
+    bool eof = false;
+
+    /* decompressor dies at SIGPIPE if trailing blocks aren't read */
+    while (!failed && !eof && !error) {
+        Pos = Len = 0;
+        error = Fill(eof);
+    }
+    Input.Close();
+
+    if (Decompressor) {
+        int status;
+        pid_t pid = Decompressor;
+
+        Decompressor = 0;
+        if (failed)
+            kill(pid, SIGKILL);
+        if (waitpid(pid, &status, 0) != pid)
+            return TError(EError::Unknown, errno, "waitpid()");
+        if (failed && WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL)
+            return error;
+        if (!error && (!WIFEXITED(status) || WEXITSTATUS(status)))
+            error = TError(EError::InvalidData, Compression + " " +
+                           FormatExitStatus(status));
+    }
+
+    return error;
+}
+
+/* Appends next chunk into buffer */
+TError TTarReader::Fill(bool &eof) {
+    if (Pos == Len)
+        Pos = Len = 0;
+
+    while (true) {
+        ssize_t ret = read(Input.Fd, Buffer.data() + Len, Buffer.size() - Len);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            return TError(EError::Unknown, errno, "Cannot read archive");
+        eof = !ret;
+        Len += ret;
+        return TError::Success();
+    }
+}
+
+TError TTarReader::ReadExact(char *buf, size_t size) {
+    while (size) {
+        if (Pos == Len) {
+            bool eof;
+            TError error = Fill(eof);
+            if (error)
+                return error;
+            if (eof)
+                return TError(EError::InvalidData, "Unexpected end of archive");
+        }
+        size_t len = std::min(size, Len - Pos);
+        memcpy(buf, Buffer.data() + Pos, len);
+        Pos += len;
+        buf += len;
+        size -= len;
+    }
+    return TError::Success();
+}
+
+TError TTarReader::Discard(uint64_t size) {
+    while (size) {
+        if (Pos == Len) {
+            bool eof;
+            TError error = Fill(eof);
+            if (error)
+                return error;
+            if (eof)
+                return TError(EError::InvalidData, "Unexpected end of archive");
+        }
+        size_t len = std::min<uint64_t>(size, Len - Pos);
+        Pos += len;
+        size -= len;
+    }
+    return TError::Success();
+}
+
+/* Extension data: long name or pax records */
+TError TTarReader::ReadString(uint64_t size, std::string &text) {
+    if (size > (1 << 20))
+        return TError(EError::InvalidData, "Too big tar extension header");
+    text.resize(size);
+    TError error = ReadExact(&text[0], size);
+    if (!error)
+        error = Discard((TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+    return error;
+}
+
+TError TTarReader::Next(TTarEntry &entry, bool &eof) {
+    std::map<std::string, std::string> pax;
+    std::string longName, longLink, text;
+    TTarHeader hdr;
+    uint64_t size, value;
+
+    TError error = Discard(Left + Padding);
+    if (error)
+        return error;
+    Left = Padding = 0;
+    eof = false;
+
+    while (true) {
+        /* archive ends with zero blocks, tolerate its absence */
+        if (Pos == Len) {
+            error = Fill(eof);
+            if (error || eof)
+                return error;
+        }
+
+        error = ReadExact((char *)&hdr, sizeof(hdr));
+        if (error)
+            return error;
+
+        if (hdr.Name[0] == 0 && std::all_of((char *)&hdr, (char *)(&hdr + 1),
+                                            [](char c) { return c == 0; })) {
+            eof = true;
+            return TError::Success();
+        }
+
+        if (!TarChecksum(hdr))
+            return TError(EError::InvalidData, "Bad tar header checksum");
+
+        if (!TarNumber(hdr.Size, sizeof(hdr.Size), size))
+            return TError(EError::InvalidData, "Bad size in tar header");
+
+        if (hdr.Type == 'L') {
+            error = ReadString(size, longName);
+            longName = TarString(longName.c_str(), longName.size());
+        } else if (hdr.Type == 'K') {
+            error = ReadString(size, longLink);
+            longLink = TarString(longLink.c_str(), longLink.size());
+        } else if (hdr.Type == 'x') {
+            error = ReadString(size, text);
+            if (!error)
+                error = ParsePax(text, pax);
+        } else if (hdr.Type == 'g') {
+            error = ReadString(size, text);
+        } else
+            break;
+
+        if (error)
+            return error;
+    }
+
+    entry.Type = hdr.Type;
+    if (entry.Type == '\0' || entry.Type == '7')
+        entry.Type = '0';
+    if (!strchr("0123456", entry.Type))
+        return TError(EError::NotSupported, std::string("Tar entry type '") +
+                      entry.Type + "' is not supported");
+
+    entry.Path = TarString(hdr.Name, sizeof(hdr.Name));
+    if (!memcmp(hdr.Magic, "ustar", 5) && hdr.Prefix[0])
+        entry.Path = TarString(hdr.Prefix, sizeof(hdr.Prefix)) + "/" + entry.Path;
+    entry.Link = TarString(hdr.Link, sizeof(hdr.Link));
+
+    if (!TarNumber(hdr.Mode, sizeof(hdr.Mode), value))
+        return TError(EError::InvalidData, "Bad mode in tar header");
+    entry.Mode = value & 07777;
+    if (!TarNumber(hdr.Uid, sizeof(hdr.Uid), value))
+        return TError(EError::InvalidData, "Bad uid in tar header");
+    entry.Uid = value;
+    if (!TarNumber(hdr.Gid, sizeof(hdr.Gid), value))
+        return TError(EError::InvalidData, "Bad gid in tar header");
+    entry.Gid = value;
+    if (!TarNumber(hdr.Mtime, sizeof(hdr.Mtime), entry.Mtime))
+        return TError(EError::InvalidData, "Bad mtime in tar header");
+    if (!TarNumber(hdr.DevMajor, sizeof(hdr.DevMajor), value))
+        return TError(EError::InvalidData, "Bad device in tar header");
+    entry.DevMajor = value;
+    if (!TarNumber(hdr.DevMinor, sizeof(hdr.DevMinor), value))
+        return TError(EError::InvalidData, "Bad device in tar header");
+    entry.DevMinor = value;
+    entry.Size = size;
+    entry.Xattrs.clear();
+
+    if (!longName.empty())
+        entry.Path = longName;
+    if (!longLink.empty())
+        entry.Link = longLink;
+
+    for (auto &it: pax) {
+        const std::string &key = it.first;
+        const std::string &val = it.second;
+
+        if (key == "path")
+            entry.Path = val;
+        else if (key == "linkpath")
+            entry.Link = val;
+        else if (key == "size")
+            error = StringToUint64(val, entry.Size);
+        else if (key == "uid" && !(error = StringToUint64(val, value)))
+            entry.Uid = value;
+        else if (key == "gid" && !(error = StringToUint64(val, value)))
+            entry.Gid = value;
+        else if (key == "mtime")
+            error = StringToUint64(val.substr(0, val.find('.')), entry.Mtime);
+        else if (StringStartsWith(key, "SCHILY.xattr."))
+            entry.Xattrs[key.substr(13)] = val;
+        else if (StringStartsWith(key, "GNU.sparse."))
+            return TError(EError::NotSupported, "Sparse files in tar are not supported");
+        if (error)
+            return TError(EError::InvalidData, "Bad pax record " + key + "=" + val);
+    }
+
+    /* links and special files have no data unless pax says so */
+    Left = (entry.Type == '0' || (entry.Type == '1' && pax.count("size"))) ?
+           entry.Size : 0;
+    Padding = (TAR_BLOCK - Left % TAR_BLOCK) % TAR_BLOCK;
+
+    return TError::Success();
+}
+
+TError TTarReader::Read(char *buf, size_t size, size_t &len) {
+    len = std::min<uint64_t>(size, Left);
+    TError error = ReadExact(buf, len);
+    if (error)
+        return error;
+    Left -= len;
+    return TError::Success();
+}
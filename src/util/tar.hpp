@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "common.hpp"
+#include "util/path.hpp"
+
+struct TTarEntry {
+    std::string Path;
+    std::string Link;       /* target of symlink or hardlink */
+    char Type;              /* ustar typeflag, '7' and '\0' become '0' */
+    mode_t Mode;
+    uid_t Uid;
+    gid_t Gid;
+    uint64_t Size;
+    uint64_t Mtime;
+    unsigned DevMajor;
+    unsigned DevMinor;
+    std::map<std::string, std::string> Xattrs;
+};
+
+/*
+ * Streaming reader for ustar archives with GNU long names and pax headers.
+ * Compressed archive is unpacked by external decompressor which works in
+ * parallel and feeds reader through pipe. Sparse files, multi-volume and
+ * unknown entries are reported as NotSupported.
+ */
+class TTarReader : public TNonCopyable {
+    TFile Input;
+    pid_t Decompressor = 0;
+    std::string Compression;
+    std::vector<char> Buffer;
+    size_t Pos = 0;
+    size_t Len = 0;
+    uint64_t Left = 0;      /* data of current entry */
+    uint64_t Padding = 0;
+
+    TError Fill(bool &eof);
+    TError ReadExact(char *buf, size_t size);
+    TError Discard(uint64_t size);
+    TError ReadString(uint64_t size, std::string &text);
+
+public:
+    ~TTarReader();
+
+    TError Open(const TPath &tarball);
+
+    /*
+     * Drains input and checks decompressor exit status. After failure
+     * rest isn't read: decompressor is killed, its own failure is reported.
+     */
+    TError Close(bool failed = false);
+
+    /* Skips rest of current entry, sets eof at end of archive */
+    TError Next(TTarEntry &entry, bool &eof);
+
+    /* Reads data of current entry, len is zero at its end */
+    TError Read(char *buf, size_t size, size_t &len);
+
+    const std::string &GetCompression() const { return Compression; }
+};
@@ -63,6 +63,41 @@ bool TTask::IsZombie() const {
     return state == 'Z';
 }
 
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+/* Wait until task exits or becomes zombie, pidfd is polled when supported */
+TError TTask::WaitExit(uint64_t deadline) const {
+    int fd = syscall(__NR_pidfd_open, Pid, 0);
+
+    if (fd >= 0) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ret;
+
+        do {
+            int64_t timeout = deadline - GetCurrentTimeMs();
+            ret = poll(&pfd, 1, timeout > 0 ? timeout : 0);
+        } while (ret < 0 && errno == EINTR);
+
+        close(fd);
+        if (ret > 0)
+            return TError::Success();
+        if (ret < 0)
+            return TError(EError::Unknown, errno, "poll(pidfd)");
+        return TError(EError::Busy, "Task " + std::to_string(Pid) + " still running");
+    }
+
+    if (errno == ESRCH)
+        return TError::Success();
+
+    for (uint64_t wait = 1; Exists() && !IsZombie(); wait = std::min(wait * 2, (uint64_t)100))
+        if (WaitDeadline(deadline, wait))
+            return TError(EError::Busy, "Task " + std::to_string(Pid) + " still running");
+
+    return TError::Success();
+}
+
 pid_t TTask::GetPPid() const {
     std::string path = "/proc/" + std::to_string(Pid) + "/stat";
     int res, ppid;
@@ -145,6 +180,12 @@ uint64_t GetCurrentTimeMs() {
     return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+uint64_t GetCurrentTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 bool WaitDeadline(uint64_t deadline, uint64_t wait) {
     uint64_t now = GetCurrentTimeMs();
     if (!deadline || int64_t(deadline - now) < 0)
@@ -374,6 +415,88 @@ TUnixSocket& TUnixSocket::operator=(TUnixSocket&& Sock) {
     return *this;
 }
 
+static bool IsPipe(int fd) {
+    struct stat st;
+    return !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+}
+
+TFdForwarder::TFdForwarder(int from, int to, bool splice) :
+        From(from), To(to), Splice(splice) {
+    if (!Splice)
+        return;
+    Direct = IsPipe(From) || IsPipe(To);
+    if (!Direct && pipe2(Pipe, O_CLOEXEC))
+        Splice = false;
+}
+
+TFdForwarder::~TFdForwarder() {
+    if (Pipe[0] >= 0)
+        close(Pipe[0]);
+    if (Pipe[1] >= 0)
+        close(Pipe[1]);
+}
+
+/* Buffered read/write, short writes are retried */
+ssize_t TFdForwarder::Copy(int from, size_t size) {
+    Buffer.resize(size);
+
+    ssize_t len = read(from, Buffer.data(), size);
+    if (len <= 0)
+        return len;
+
+    for (ssize_t off = 0; off < len; ) {
+        ssize_t ret = write(To, Buffer.data() + off, len - off);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        off += ret;
+    }
+
+    return len;
+}
+
+ssize_t TFdForwarder::Forward(size_t size) {
+    ssize_t len;
+
+    if (!Splice)
+        return Copy(From, size);
+
+    if (Direct) {
+        len = splice(From, nullptr, To, nullptr, size, SPLICE_F_MOVE);
+        if (len >= 0 || errno != EINVAL)
+            return len;
+        Splice = false;
+        return Copy(From, size);
+    }
+
+    len = splice(From, nullptr, Pipe[1], nullptr, size, SPLICE_F_MOVE);
+    if (len < 0 && errno == EINVAL) {
+        Splice = false;
+        return Copy(From, size);
+    }
+    if (len <= 0)
+        return len;
+
+    /* Drain everything from pipe, output might not support splice */
+    for (ssize_t left = len; left > 0; ) {
+        ssize_t ret = Splice ? splice(Pipe[0], nullptr, To, nullptr, left, SPLICE_F_MOVE) :
+                               Copy(Pipe[0], left);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EINVAL || !Splice)
+                return -1;
+            Splice = false;
+            continue;
+        }
+        left -= ret;
+    }
+
+    return len;
+}
+
 TError TUnixSocket::SocketPair(TUnixSocket &sock1, TUnixSocket &sock2) {
     int sockfds[2];
     int ret, one = 1;
@@ -568,6 +691,106 @@ TError TUnixSocket::RecvFd(int &fd) const {
     return TError(EError::Unknown, "no rights after recvmsg");
 }
 
+/* Message is length and data, fds are attached to the first byte */
+static constexpr size_t MaxRightsFds = 253; /* SCM_MAX_FD */
+
+TError TUnixSocket::SendFds(const std::string &data, const std::vector<int> &fds) const {
+    uint32_t len = data.size();
+    struct iovec iovec[2] = {
+        { .iov_base = &len, .iov_len = sizeof(len) },
+        { .iov_base = (void *)data.data(), .iov_len = data.size() },
+    };
+    std::vector<char> buffer(CMSG_SPACE(sizeof(int) * fds.size()));
+    struct msghdr msghdr = {
+        .msg_name = NULL,
+        .msg_namelen = 0,
+        .msg_iov = iovec,
+        .msg_iovlen = 2,
+        .msg_control = fds.size() ? buffer.data() : NULL,
+        .msg_controllen = fds.size() ? buffer.size() : 0,
+        .msg_flags = 0,
+    };
+
+    if (fds.size() > MaxRightsFds)
+        return TError(EError::Unknown, "too many fds: " + std::to_string(fds.size()));
+
+    if (fds.size()) {
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    ssize_t ret = sendmsg(SockFd, &msghdr, MSG_NOSIGNAL);
+    if (ret < 0)
+        return TError(EError::Unknown, errno, "cannot send fds");
+    if (ret != (ssize_t)(sizeof(len) + data.size()))
+        return TError(EError::Unknown, "partial sendmsg: " + std::to_string(ret));
+
+    return TError::Success();
+}
+
+TError TUnixSocket::RecvFds(std::string &data, std::vector<int> &fds) const {
+    uint32_t len;
+    struct iovec iovec = {
+        .iov_base = &len,
+        .iov_len = sizeof(len),
+    };
+    std::vector<char> buffer(CMSG_SPACE(sizeof(int) * MaxRightsFds));
+    struct msghdr msghdr = {
+        .msg_name = NULL,
+        .msg_namelen = 0,
+        .msg_iov = &iovec,
+        .msg_iovlen = 1,
+        .msg_control = buffer.data(),
+        .msg_controllen = buffer.size(),
+        .msg_flags = 0,
+    };
+
+    fds.clear();
+
+    ssize_t ret = recvmsg(SockFd, &msghdr, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    if (ret < 0)
+        return TError(EError::Unknown, errno, "cannot receive fds");
+    if (ret == 0)
+        return TError(EError::Unknown, EPIPE, "connection closed");
+    if (ret != sizeof(len))
+        return TError(EError::Unknown, "partial recvmsg: " + std::to_string(ret));
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr); cmsg;
+         cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t nr = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            size_t off = fds.size();
+            fds.resize(off + nr);
+            memcpy(fds.data() + off, CMSG_DATA(cmsg), sizeof(int) * nr);
+        }
+    }
+
+    TError error;
+
+    if (msghdr.msg_flags & MSG_CTRUNC)
+        error = TError(EError::Unknown, "truncated rights after recvmsg");
+
+    data.resize(len);
+    for (size_t done = 0; !error && done < len; ) {
+        ret = read(SockFd, &data[done], len - done);
+        if (ret <= 0)
+            error = TError(EError::Unknown, errno, "cannot receive message");
+        else
+            done += ret;
+    }
+
+    if (error) {
+        for (int fd: fds)
+            close(fd);
+        fds.clear();
+    }
+
+    return error;
+}
+
 TError TUnixSocket::SetRecvTimeout(int timeout_ms) const {
     struct timeval tv;
 
@@ -17,6 +17,7 @@ struct TTask {
     bool IsZombie() const;
     pid_t GetPPid() const;
     TError Kill(int signal) const;
+    TError WaitExit(uint64_t deadline) const;
 };
 
 pid_t ForkFromThread(void);
@@ -28,6 +29,7 @@ pid_t GetTid();
 TError GetTaskChildrens(pid_t pid, std::vector<pid_t> &childrens);
 
 uint64_t GetCurrentTimeMs();
+uint64_t GetCurrentTimeUs();
 bool WaitDeadline(uint64_t deadline, uint64_t sleep = 10);
 uint64_t GetTotalMemory();
 void SetProcessName(const std::string &name);
@@ -50,6 +52,30 @@ TError UnpackTarball(const TPath &tar, const TPath &path);
 TError CopyRecursive(const TPath &src, const TPath &dst);
 void DumpMallocInfo();
 
+/*
+ * Moves data from one descriptor into another without copying it through
+ * userspace: splice() directly if either side is a pipe, otherwise through
+ * intermediate pipe. Falls back to read/write if descriptors don't support
+ * splice, for example terminals on old kernels.
+ */
+class TFdForwarder : public TNonCopyable {
+    int From, To;
+    int Pipe[2] = { -1, -1 };
+    bool Direct = false;
+    bool Splice;
+    std::vector<char> Buffer;
+
+    ssize_t Copy(int from, size_t size);
+
+public:
+    TFdForwarder(int from, int to, bool splice = true);
+    ~TFdForwarder();
+    bool IsSplice() const { return Splice; }
+
+    /* Returns bytes moved, 0 at end of input and -1 at error */
+    ssize_t Forward(size_t size = 65536);
+};
+
 class TUnixSocket : public TNonCopyable {
     int SockFd;
 public:
@@ -70,5 +96,7 @@ public:
     TError RecvError() const;
     TError SendFd(int fd) const;
     TError RecvFd(int &fd) const;
+    TError SendFds(const std::string &data, const std::vector<int> &fds) const;
+    TError RecvFds(std::string &data, std::vector<int> &fds) const;
     TError SetRecvTimeout(int timeout_ms) const;
 };
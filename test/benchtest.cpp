@@ -0,0 +1,410 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <thread>
+
+#include "config.hpp"
+#include "util/idmap.hpp"
+#include "util/unix.hpp"
+#include "util/string.hpp"
+#include "util/log.hpp"
+#include "test.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+}
+
+namespace test {
+
+static void Report(const std::string &what, uint64_t count, uint64_t ms) {
+    Say() << what << ": " << count << " in " << ms << " ms";
+    if (ms)
+        std::cout << ", " << count * 1000 / ms << " per second";
+    std::cout << std::endl;
+}
+
+/*
+ * Container registry: id allocation and create/destroy churn.
+ * Containers are never started thus cgroups are not touched, porto
+ * only maintains its registry and key-value nodes.
+ */
+static void BenchRegistry(int count) {
+    uint64_t start;
+
+    TIdMap ids(1, count);
+    std::vector<int> allocated(count);
+
+    start = GetCurrentTimeMs();
+    for (int i = 0; i < count; i++)
+        ExpectSuccess(ids.Get(allocated[i]));
+    Report("IdMap get", count, GetCurrentTimeMs() - start);
+
+    start = GetCurrentTimeMs();
+    for (int i = 0; i < count; i += 2)
+        ExpectSuccess(ids.Put(allocated[i]));
+    for (int i = 0; i < count; i += 2)
+        ExpectSuccess(ids.Get(allocated[i]));
+    Report("IdMap put/get", count, GetCurrentTimeMs() - start);
+
+    Porto::Connection api;
+    std::vector<std::string> list;
+    std::string parent = "bench-registry";
+
+    ExpectApiSuccess(api.List(list));
+    int window = (int)config().container().max_total() - (int)list.size() - 2;
+    Expect(window > 0);
+
+    ExpectApiSuccess(api.Create(parent));
+
+    std::deque<std::string> live;
+    uint64_t createMs = 0, destroyMs = 0, listMs = 0, lists = 0;
+
+    for (int i = 0; i < count; i++) {
+        if ((int)live.size() == window) {
+            start = GetCurrentTimeMs();
+            ExpectApiSuccess(api.List(list));
+            listMs += GetCurrentTimeMs() - start;
+            lists++;
+
+            start = GetCurrentTimeMs();
+            while (live.size() > (size_t)window / 2) {
+                ExpectApiSuccess(api.Destroy(live.front()));
+                live.pop_front();
+            }
+            destroyMs += GetCurrentTimeMs() - start;
+        }
+
+        std::string name = parent + "/" + std::to_string(i);
+        start = GetCurrentTimeMs();
+        ExpectApiSuccess(api.Create(name));
+        createMs += GetCurrentTimeMs() - start;
+        live.push_back(name);
+    }
+
+    start = GetCurrentTimeMs();
+    ExpectApiSuccess(api.Destroy(parent));
+    destroyMs += GetCurrentTimeMs() - start;
+
+    Say() << "Window: " << window << " containers" << std::endl;
+    Report("Create", count, createMs);
+    Report("Destroy", count, destroyMs);
+    if (lists)
+        Report("List", lists, listMs);
+}
+
+static uint64_t CgroupReads(Porto::Connection &api, uint64_t &memoized) {
+    std::string value;
+    uint64_t reads;
+
+    ExpectApiSuccess(api.GetData("/", "porto_stat[cgroup_reads]", value));
+    ExpectSuccess(StringToUint64(value, reads));
+    ExpectApiSuccess(api.GetData("/", "porto_stat[cgroup_reads_memoized]", value));
+    ExpectSuccess(StringToUint64(value, memoized));
+    return reads;
+}
+
+/*
+ * Monitoring: portotop column set fetched by one combined get per round
+ * versus one request per value. Reports cgroup knob reads per container.
+ */
+static void BenchGet(int containers, int rounds) {
+    Porto::Connection api;
+    std::string parent = "bench-get";
+    std::vector<std::string> names;
+    std::vector<std::string> columns = {
+        "state", "cpu_usage", "memory_usage", "memory_limit_total",
+        "memory_guarantee_total", "major_faults", "minor_faults", "max_rss",
+        "io_read[fs]", "io_write[fs]", "io_read", "io_write", "io_ops",
+        "net_bytes",
+    };
+
+    ExpectApiSuccess(api.Create(parent));
+    for (int i = 0; i < containers; i++) {
+        std::string name = parent + "/" + std::to_string(i);
+        ExpectApiSuccess(api.Create(name));
+        ExpectApiSuccess(api.SetProperty(name, "command", "sleep 1000"));
+        ExpectApiSuccess(api.Start(name));
+        names.push_back(name);
+    }
+
+    std::map<std::string, std::map<std::string, Porto::GetResponse>> result;
+    uint64_t reads, memoized, memoizedAfter, start, ms;
+    std::string value;
+
+    reads = CgroupReads(api, memoized);
+    start = GetCurrentTimeMs();
+    for (int r = 0; r < rounds; r++)
+        ExpectApiSuccess(api.Get(names, columns, result));
+    ms = GetCurrentTimeMs() - start;
+    reads = CgroupReads(api, memoizedAfter) - reads;
+    Report("Combined get", rounds, ms);
+    Say() << "Knob reads per container: " << (double)reads / rounds / containers
+          << ", memoized: " << (double)(memoizedAfter - memoized) / rounds / containers
+          << std::endl;
+
+    reads = CgroupReads(api, memoized);
+    start = GetCurrentTimeMs();
+    for (int r = 0; r < rounds; r++)
+        for (auto &name: names)
+            for (auto &column: columns)
+                (void)api.GetData(name, column, value);
+    ms = GetCurrentTimeMs() - start;
+    reads = CgroupReads(api, memoized) - reads;
+    Report("Separate gets", rounds, ms);
+    Say() << "Knob reads per container: " << (double)reads / rounds / containers
+          << std::endl;
+
+    ExpectApiSuccess(api.Destroy(parent));
+}
+
+static uint64_t Percentile(std::vector<uint64_t> &samples, int percent) {
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * percent / 100];
+}
+
+/*
+ * Task start latency: create, start and wait short-living container
+ * with default isolation. Such containers are spawned by zygote unless
+ * daemon.spawner is false, reported spawner starts tell which path was used.
+ */
+static void BenchStart(int count) {
+    Porto::Connection api;
+    std::string name = "bench-start";
+    std::vector<uint64_t> startUs, totalUs;
+    std::string value, result;
+    uint64_t spawned, start, started;
+
+    ExpectApiSuccess(api.GetData("/", "porto_stat[spawner_starts]", value));
+    ExpectSuccess(StringToUint64(value, spawned));
+
+    for (int i = 0; i < count; i++) {
+        start = GetCurrentTimeUs();
+        ExpectApiSuccess(api.Create(name));
+        ExpectApiSuccess(api.SetProperty(name, "command", "true"));
+        started = GetCurrentTimeUs();
+        ExpectApiSuccess(api.Start(name));
+        startUs.push_back(GetCurrentTimeUs() - started);
+        ExpectApiSuccess(api.WaitContainers({name}, result, -1));
+        ExpectApiSuccess(api.Destroy(name));
+        totalUs.push_back(GetCurrentTimeUs() - start);
+    }
+
+    ExpectApiSuccess(api.GetData("/", "porto_stat[spawner_starts]", value));
+    ExpectSuccess(StringToUint64(value, start));
+
+    Say() << "Start p50: " << Percentile(startUs, 50) << " us, p99: "
+          << Percentile(startUs, 99) << " us" << std::endl;
+    Say() << "Create-start-wait-destroy p50: " << Percentile(totalUs, 50)
+          << " us, p99: " << Percentile(totalUs, 99) << " us" << std::endl;
+    Say() << "Spawner starts: " << start - spawned << " of " << count << std::endl;
+}
+
+/*
+ * Start phases: short-living containers with different isolation,
+ * phase durations are taken from start_profile of each start.
+ */
+static void BenchProfile(int count, const std::string &root) {
+    std::vector<std::pair<std::string, std::map<std::string, std::string>>> variants = {
+        { "isolate=false", { { "isolate", "false" } } },
+        { "isolate=true", { { "isolate", "true" } } },
+        { "isolate=true net=none", { { "isolate", "true" }, { "net", "none" } } },
+    };
+    Porto::Connection api;
+    std::string name = "bench-profile";
+    std::string value, result;
+
+    if (!root.empty())
+        variants.push_back({ "isolate=true root=" + root,
+                             { { "isolate", "true" }, { "root", root } } });
+
+    for (auto &variant: variants) {
+        std::map<std::string, std::vector<uint64_t>> phases;
+
+        for (int i = 0; i < count; i++) {
+            TUintMap profile;
+
+            ExpectApiSuccess(api.Create(name));
+            ExpectApiSuccess(api.SetProperty(name, "command", "true"));
+            for (auto &prop: variant.second)
+                ExpectApiSuccess(api.SetProperty(name, prop.first, prop.second));
+            ExpectApiSuccess(api.Start(name));
+            ExpectApiSuccess(api.WaitContainers({name}, result, -1));
+            ExpectApiSuccess(api.GetData(name, "start_profile", value));
+            ExpectSuccess(StringToUintMap(value, profile));
+            ExpectApiSuccess(api.Destroy(name));
+
+            for (auto &it: profile)
+                phases[it.first].push_back(it.second);
+        }
+
+        Say() << variant.first << ", " << count << " starts" << std::endl;
+        for (auto &it: phases)
+            Say() << "  " << it.first << " p50: " << Percentile(it.second, 50)
+                  << " us, p99: " << Percentile(it.second, 99) << " us" << std::endl;
+    }
+}
+
+/*
+ * Stream forwarding as in portoctl exec: data written by child into
+ * pipe or socket is moved into /dev/null with splice or read/write.
+ */
+static void BenchForward(int megabytes) {
+    for (std::string source: { "pipe", "socket" }) {
+        for (bool splice: { false, true }) {
+            int fds[2];
+
+            if (source == "pipe")
+                Expect(!pipe2(fds, O_CLOEXEC));
+            else
+                Expect(!socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds));
+
+            pid_t pid = fork();
+            Expect(pid >= 0);
+            if (!pid) {
+                std::vector<char> buf(1 << 20, 'x');
+                close(fds[0]);
+                for (int i = 0; i < megabytes; i++) {
+                    for (size_t off = 0; off < buf.size(); ) {
+                        ssize_t ret = write(fds[1], buf.data() + off, buf.size() - off);
+                        if (ret < 0)
+                            _exit(EXIT_FAILURE);
+                        off += ret;
+                    }
+                }
+                _exit(EXIT_SUCCESS);
+            }
+            close(fds[1]);
+
+            int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+            Expect(null >= 0);
+
+            uint64_t total = 0, start = GetCurrentTimeUs();
+            bool spliced;
+            {
+                TFdForwarder forwarder(fds[0], null, splice);
+                ssize_t len;
+
+                while ((len = forwarder.Forward()) > 0)
+                    total += len;
+                Expect(len == 0);
+                spliced = forwarder.IsSplice();
+            }
+            uint64_t us = GetCurrentTimeUs() - start;
+
+            int status;
+            Expect(waitpid(pid, &status, 0) == pid);
+            Expect(status == 0);
+            close(fds[0]);
+            close(null);
+
+            ExpectEq(total, (uint64_t)megabytes << 20);
+            Say() << source << (spliced ? " splice" : " copy") << ": "
+                  << (total >> 20) << " MB in " << us / 1000 << " ms";
+            if (us)
+                std::cout << ", " << total / us << " MB/s";
+            std::cout << std::endl;
+        }
+    }
+}
+
+/*
+ * Daemon logging: request-like lines from several threads into file,
+ * synchronous write per line versus background writer queue.
+ * Lines dropped at queue overflow are lines written minus lines in file.
+ */
+static void BenchLog(int count, int threads) {
+    TPath path("/tmp/portotest-bench.log");
+
+    for (size_t queue: { 0, 4096, 65536 }) {
+        (void)path.Unlink();
+        TLogger::OpenLog(false, path, 0600);
+        TLogger::StartWriter(queue);
+
+        uint64_t start = GetCurrentTimeUs();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([count, t] {
+                for (int i = 0; i < count; i++)
+                    L_REQ() << "get /porto/bench-" << t << " state cpu_usage memory_usage " << i << std::endl;
+            });
+        for (auto &worker: workers)
+            worker.join();
+        uint64_t us = GetCurrentTimeUs() - start;
+
+        TLogger::StopWriter();
+        TLogger::CloseLog();
+
+        std::string text;
+        ExpectSuccess(path.ReadAll(text, 1 << 30));
+        uint64_t lines = std::count(text.begin(), text.end(), '\n');
+        uint64_t total = (uint64_t)count * threads;
+
+        Say() << (queue ? "queue " + std::to_string(queue) : std::string("sync"))
+              << ": " << total << " lines in " << us / 1000 << " ms, "
+              << (total ? us * 1000 / total : 0) << " ns per line, lost "
+              << total - lines << std::endl;
+    }
+
+    (void)path.Unlink();
+}
+
+int BenchTest(std::vector<std::string> args) {
+    try {
+        config.Load();
+
+        std::string what = args.size() ? args[0] : "";
+        int count;
+
+        if (what == "registry") {
+            count = 100000;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            BenchRegistry(count);
+        } else if (what == "get") {
+            int rounds = 1000;
+            count = 10;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            if (args.size() > 2)
+                ExpectSuccess(StringToInt(args[2], rounds));
+            BenchGet(count, rounds);
+        } else if (what == "start") {
+            count = 1000;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            BenchStart(count);
+        } else if (what == "profile") {
+            count = 100;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            BenchProfile(count, args.size() > 2 ? args[2] : "");
+        } else if (what == "forward") {
+            count = 4096;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            BenchForward(count);
+        } else if (what == "log") {
+            int threads = 4;
+            count = 100000;
+            if (args.size() > 1)
+                ExpectSuccess(StringToInt(args[1], count));
+            if (args.size() > 2)
+                ExpectSuccess(StringToInt(args[2], threads));
+            BenchLog(count, threads);
+        } else {
+            std::cerr << "Unknown benchmark: " << what << std::endl;
+            return EXIT_FAILURE;
+        }
+    } catch (std::string e) {
+        std::cerr << "ERROR: " << e << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+}
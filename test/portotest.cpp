@@ -49,9 +49,24 @@ static int Fuzzytest(int argc, char *argv[]) {
     return test::FuzzyTest(threads, iter);
 }
 
+static int Benchtest(int argc, char *argv[]) {
+    std::vector<std::string> args;
+
+    for (int i = 0; i < argc; i++)
+        args.push_back(argv[i]);
+
+    return test::BenchTest(args);
+}
+
 static void Usage() {
     std::cout << "usage: " << program_invocation_short_name << " [--except] <selftest>..." << std::endl;
     std::cout << "       " << program_invocation_short_name << " stress [threads] [iterations] [kill=on/off]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench registry [count]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench get [containers] [rounds]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench start [count]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench profile [count] [root]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench forward [megabytes]" << std::endl;
+    std::cout << "       " << program_invocation_short_name << " bench log [lines] [threads]" << std::endl;
 }
 
 static int TestConnectivity() {
@@ -118,6 +133,8 @@ int main(int argc, char *argv[])
             return Stresstest(argc - 2, argv + 2);
         if (what == "fuzzy")
             return Fuzzytest(argc - 2, argv + 2);
+        if (what == "bench")
+            return Benchtest(argc - 2, argv + 2);
         else
             return Selftest(argc - 1, argv + 1);
     } catch (string err) {
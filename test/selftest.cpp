@@ -5,6 +5,8 @@
 #include <climits>
 #include <algorithm>
 
+#include <google/protobuf/text_format.h>
+
 #include "version.hpp"
 #include "libporto.hpp"
 #include "config.hpp"
@@ -17,6 +19,8 @@
 #include "protobuf.hpp"
 #include "test.hpp"
 #include "rpc.hpp"
+#include "reqlog.hpp"
+#include "pool.hpp"
 
 const std::string TMPDIR = "/tmp/porto/selftest";
 
@@ -24,6 +28,7 @@ extern "C" {
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <grp.h>
 #include <linux/capability.h>
 }
@@ -771,6 +776,51 @@ static void TestMeta(Porto::Connection &api) {
 
         ExpectApiSuccess(api.Destroy("a"));
     }
+
+    Say() << "Test recursive start with sibling dependencies" << std::endl;
+
+    std::vector<Porto::StartResult> results;
+
+    ExpectApiSuccess(api.Create("a"));
+    ExpectApiSuccess(api.Create("a/b"));
+    ExpectApiSuccess(api.Create("a/c"));
+    ExpectApiSuccess(api.Create("a/c/d"));
+    ExpectApiSuccess(api.SetProperty("a/b", "command", "sleep 1000"));
+    ExpectApiSuccess(api.SetProperty("a/c/d", "command", "sleep 1000"));
+
+    ExpectApiFailure(api.StartRecursive("a", {{"a/b", {"a/c"}}, {"a/c", {"a/b"}}}, results),
+                     EError::InvalidValue);
+    ExpectApiFailure(api.StartRecursive("a", {{"a/b", {"a/c/d"}}}, results),
+                     EError::InvalidValue);
+
+    ExpectApiSuccess(api.StartRecursive("a", {{"a/b", {"a/c"}}}, results));
+    ExpectEq(results.size(), 3);
+    ExpectEq(results[0].Name, "a/c");
+    ExpectApiSuccess(api.GetData("a", "state", state));
+    ExpectEq(state, "meta");
+    ExpectApiSuccess(api.GetData("a/c", "state", state));
+    ExpectEq(state, "meta");
+    ExpectApiSuccess(api.GetData("a/c/d", "state", state));
+    ExpectEq(state, "running");
+    ExpectApiSuccess(api.GetData("a/b", "state", state));
+    ExpectEq(state, "running");
+
+    Say() << "Test failure in recursive start is confined to dependents" << std::endl;
+    ExpectApiSuccess(api.Stop("a/c"));
+    ExpectApiSuccess(api.Stop("a/b"));
+    ExpectApiSuccess(api.SetProperty("a/c/d", "command", "/nonexistent"));
+    ExpectApiFailure(api.StartRecursive("a", {{"a/b", {"a/c"}}}, results), EError::InvalidValue);
+    ExpectEq(results.size(), 3);
+    for (auto &result: results)
+        ExpectEq(result.Error, result.Name == "a/c/d" ? (int)EError::InvalidValue : (int)EError::Success);
+    ExpectApiSuccess(api.GetData("a/c/d", "state", state));
+    ExpectEq(state, "stopped");
+    ExpectApiSuccess(api.GetData("a/c", "state", state));
+    ExpectEq(state, "meta");
+    ExpectApiSuccess(api.GetData("a/b", "state", state));
+    ExpectEq(state, "running");
+
+    ExpectApiSuccess(api.Destroy("a"));
 }
 
 static void TestEmpty(Porto::Connection &api) {
@@ -792,6 +842,63 @@ static bool TaskZombie(const string &pid) {
     return GetState(pid) == "Z";
 }
 
+static void TestExec(Porto::Connection &api) {
+    std::map<std::string, std::string> config;
+    std::string name = "a";
+    std::string ret;
+    int pid, status;
+
+    ExpectApiSuccess(api.Create(name));
+
+    Say() << "Check exec into stopped container" << std::endl;
+    ExpectApiFailure(api.Exec(name, "true", config, true, pid, status), EError::InvalidState);
+
+    ExpectApiSuccess(api.SetProperty(name, "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start(name));
+
+    Say() << "Check exit status of exec" << std::endl;
+    ExpectApiSuccess(api.Exec(name, "true", config, true, pid, status));
+    Expect(pid > 0);
+    ExpectEq(status, 0);
+    ExpectApiSuccess(api.Exec(name, "false", config, true, pid, status));
+    ExpectEq(status, 256);
+    ExpectApiSuccess(api.GetData(name, "exec_status[" + std::to_string(pid) + "]", ret));
+    ExpectEq(ret, "256");
+
+    Say() << "Check exec environment" << std::endl;
+    config["env"] = "EXEC_TEST=1";
+    ExpectApiSuccess(api.Exec(name, "sh -c '[ $PORTO_NAME = a -a $EXEC_TEST = 1 ]'",
+                              config, true, pid, status));
+    ExpectEq(status, 0);
+
+    Say() << "Check exit of short exec is not lost" << std::endl;
+    int child = fork();
+    if (!child) {
+        /* exec with wait has no timeout: lost reply hangs this child */
+        Porto::Connection conn;
+        for (int i = 0; i < 200; i++) {
+            if (conn.Exec(name, "true", config, true, pid, status) || status)
+                _exit(EXIT_FAILURE);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+    Expect(child > 0);
+    uint64_t deadline = GetCurrentTimeMs() + 60000;
+    while (waitpid(child, &status, WNOHANG) == 0) {
+        if (WaitDeadline(deadline, 100)) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            break;
+        }
+    }
+    ExpectEq(status, 0);
+
+    ExpectApiSuccess(api.GetData(name, "state", ret));
+    ExpectEq(ret, "running");
+
+    ExpectApiSuccess(api.Destroy(name));
+}
+
 static void TestExitStatus(Porto::Connection &api) {
     string pid;
     string ret;
@@ -864,6 +971,21 @@ static void TestExitStatus(Porto::Connection &api) {
     ExpectApiSuccess(api.GetData(name, "oom_killed", ret));
     ExpectEq(ret, string("true"));
 
+    if (HaveCgKnob("memory", "memory.pressure_level")) {
+        std::string waited, event;
+
+        Say() << "Check memory pressure notification" << std::endl;
+        ExpectApiSuccess(api.Stop(name));
+        ExpectApiSuccess(api.Start(name));
+        ExpectApiSuccess(api.WaitContainers({ name }, { "memory_pressure" },
+                                            waited, event, 60));
+        ExpectEq(waited, name);
+        ExpectEq(event, "memory_pressure");
+        WaitContainer(api, name, 60);
+        ExpectApiSuccess(api.GetData(name, "memory_pressure[medium]", ret));
+        Expect(stoull(ret) > 0);
+    }
+
     ExpectApiSuccess(api.Destroy(name));
 }
 
@@ -983,6 +1105,15 @@ static void TestNsCgTc(Porto::Connection &api) {
     ExpectApiSuccess(api.Destroy(name));
 }
 
+static uint64_t PortoStat(Porto::Connection &api, const std::string &name) {
+    std::string v;
+    uint64_t val;
+
+    ExpectApiSuccess(api.GetData("/", "porto_stat[" + name + "]", v));
+    ExpectSuccess(StringToUint64(v, val));
+    return val;
+}
+
 static void TestIsolateProperty(Porto::Connection &api) {
     string ret;
 
@@ -1007,6 +1138,7 @@ static void TestIsolateProperty(Porto::Connection &api) {
     ExpectApiSuccess(api.Stop(name));
 
 
+    uint64_t spawned = PortoStat(api, "spawner_starts");
     ExpectApiSuccess(api.SetProperty(name, "isolate", "true"));
     ExpectApiSuccess(api.SetProperty(name, "command", "bash -c 'echo $BASHPID'"));
     ExpectApiSuccess(api.Start(name));
@@ -1015,6 +1147,10 @@ static void TestIsolateProperty(Porto::Connection &api) {
     Expect(ret == "1\n" || ret == "2\n");
     ExpectApiSuccess(api.Stop(name));
 
+    Say() << "Make sure isolated container is started by spawner" << std::endl;
+    if (config().daemon().spawner())
+        ExpectEq(PortoStat(api, "spawner_starts"), spawned + 1);
+
     ExpectApiSuccess(api.SetProperty(name, "command", "ps aux"));
     ExpectApiSuccess(api.Start(name));
     WaitContainer(api, name);
@@ -2731,6 +2867,23 @@ static void TestStateMachine(Porto::Connection &api) {
 
     ExpectApiSuccess(api.Destroy(name));
     AsAlice(api);
+
+    Say() << "Make sure stop kills tasks ignoring SIGTERM within timeout" << std::endl;
+    ExpectApiSuccess(api.Create(name));
+    ExpectApiSuccess(api.SetProperty(name, "command",
+                "bash -c 'trap \"\" TERM; for i in 1 2 3 4; do sleep 1000 & done; wait'"));
+    ExpectApiSuccess(api.Start(name));
+    ExpectApiSuccess(api.GetData(name, "root_pid", pid));
+    ExpectEq(TaskRunning(pid), true);
+
+    uint64_t stopTime = GetCurrentTimeMs();
+    ExpectApiSuccess(api.Stop(name, 1));
+    stopTime = GetCurrentTimeMs() - stopTime;
+    ExpectState(api, name, "stopped");
+    ExpectEq(TaskRunning(pid), false);
+    Expect(stopTime >= 1000 && stopTime < 5000);
+
+    ExpectApiSuccess(api.Destroy(name));
 }
 
 static void TestPath(Porto::Connection &api) {
@@ -2880,9 +3033,11 @@ static void TestRoot(Porto::Connection &api) {
         "env",
         "cwd",
         "memory_limit",
+        "memory_threshold",
         "cpu_policy",
         "cpu_limit",
         "cpu_guarantee",
+        "cpu_set",
         "devices",
         "io_policy",
         "respawn",
@@ -2891,6 +3046,7 @@ static void TestRoot(Porto::Connection &api) {
         "stdout_path",
         "stderr_path",
         "stdout_limit",
+        "stream_memory",
         "private",
         "ulimit",
         "hostname",
@@ -2945,12 +3101,16 @@ static void TestRoot(Porto::Connection &api) {
         "cpu_usage",
         "cpu_usage_system",
         "memory_usage",
+        "memory_pressure",
+        "cpu_set_affinity",
         "minor_faults",
         "major_faults",
         "io_read",
         "io_write",
         "io_ops",
         "time",
+        "start_profile",
+        "exec_status",
     };
 
     if (NetworkEnabled()) {
@@ -3325,6 +3485,23 @@ static void TestLimits(Porto::Connection &api) {
         ExpectApiSuccess(api.SetProperty(name, "cpu_guarantee", "1.5c"));
     }
 
+    Say() << "Check cpu_set" << std::endl;
+    string v;
+    ExpectApiFailure(api.SetProperty(name, "cpu_set", "test"), EError::InvalidValue);
+    ExpectApiFailure(api.SetProperty(name, "cpu_set", "node 1000"), EError::InvalidValue);
+    ExpectApiFailure(api.SetProperty(name, "cpu_set", "0-2000000000"), EError::InvalidValue);
+    ExpectApiSuccess(api.SetProperty(name, "cpu_set", "0"));
+    ExpectApiSuccess(api.Start(name));
+    ExpectEq(GetCgKnob("cpuset", name, "cpuset.cpus"), "0");
+    ExpectApiSuccess(api.GetData(name, "cpu_set_affinity[cpus]", v));
+    ExpectEq(v, "0");
+    ExpectApiSuccess(api.SetProperty(name, "cpu_set", "node 0"));
+    ExpectApiSuccess(api.GetData(name, "cpu_set_affinity[node]", v));
+    ExpectEq(v, "0");
+    ExpectEq(GetCgKnob("cpuset", name, "cpuset.mems"), "0");
+    ExpectApiSuccess(api.Stop(name));
+    ExpectApiSuccess(api.SetProperty(name, "cpu_set", ""));
+
     Say() << "Check cpu_policy" << std::endl;
     string smart;
 
@@ -3518,6 +3695,32 @@ static void TestLimits(Porto::Connection &api) {
     ExpectApiSuccess(api.Destroy(name));
 }
 
+static void TestMemThreshold(Porto::Connection &api) {
+    std::string name = "a", waited, event, before, after, v;
+
+    Say() << "Check memory_threshold property" << std::endl;
+    ExpectApiSuccess(api.Create(name));
+    ExpectApiFailure(api.SetProperty(name, "memory_threshold", "0"), EError::InvalidValue);
+    ExpectApiFailure(api.SetProperty(name, "memory_threshold", "test"), EError::InvalidValue);
+    ExpectApiSuccess(api.SetProperty(name, "memory_threshold", "64M; 32M; 32M"));
+    ExpectApiSuccess(api.GetProperty(name, "memory_threshold", v));
+    ExpectEq(v, std::to_string(32 << 20) + ";" + std::to_string(64 << 20));
+
+    Say() << "Check memory_threshold waiter wakes when usage crosses threshold" << std::endl;
+    ExpectApiSuccess(api.SetProperty(name, "memory_threshold", "32M"));
+    ExpectApiSuccess(api.SetProperty(name, "command",
+                "bash -c 'sleep 1; dd if=/dev/zero of=/dev/null bs=64M count=1; sleep 1000'"));
+    ExpectApiSuccess(api.GetData("/", "porto_stat[memory_threshold_events]", before));
+    ExpectApiSuccess(api.Start(name));
+    ExpectApiSuccess(api.WaitContainers({ name }, { "memory_threshold" }, waited, event, 30));
+    ExpectEq(waited, name);
+    ExpectEq(event, "memory_threshold");
+    ExpectApiSuccess(api.GetData("/", "porto_stat[memory_threshold_events]", after));
+    Expect(stoull(after) > stoull(before));
+
+    ExpectApiSuccess(api.Destroy(name));
+}
+
 static void TestUlimitProperty(Porto::Connection &api) {
     string name = "a";
     ExpectApiSuccess(api.Create(name));
@@ -3937,6 +4140,24 @@ static void TestLimitsHierarchy(Porto::Connection &api) {
     ExpectApiSuccess(api.Pause("a"));
     ExpectApiSuccess(api.Destroy("a"));
 
+    Say() << "Test stop with paused child" << std::endl;
+    ExpectApiSuccess(api.Create(parent));
+    ExpectApiSuccess(api.SetProperty(parent, "command", "sleep 1000"));
+    ExpectApiSuccess(api.Create(child));
+    ExpectApiSuccess(api.SetProperty(child, "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start(child));
+    ExpectApiSuccess(api.Pause(child));
+    ExpectState(api, parent, "running");
+    ExpectState(api, child, "paused");
+
+    uint64_t stopTime = GetCurrentTimeMs();
+    ExpectApiSuccess(api.Stop(parent, 30));
+    stopTime = GetCurrentTimeMs() - stopTime;
+    ExpectState(api, parent, "stopped");
+    ExpectState(api, child, "stopped");
+    Expect(stopTime < 10000);
+    ExpectApiSuccess(api.Destroy(parent));
+
     Say() << "Test property propagation" << std::endl;
     std::string val;
 
@@ -4564,6 +4785,62 @@ static void TestVolumeImpl(Porto::Connection &api) {
     ExpectEq(TPath(b).Exists(), false);
 }
 
+/* Foreign task keeps memory cgroup of container busy after destroy */
+static pid_t BusyCgroup(Porto::Connection &api, const std::string &name) {
+    ExpectApiSuccess(api.Create(name));
+    ExpectApiSuccess(api.SetProperty(name, "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start(name));
+
+    pid_t pid = fork();
+    if (!pid) {
+        execlp("sleep", "sleep", "1000", nullptr);
+        _exit(EXIT_FAILURE);
+    }
+    Expect(pid > 0);
+    ExpectSuccess(TPath(CgRoot("memory", name) + "tasks").WriteAll(std::to_string(pid)));
+
+    ExpectApiSuccess(api.Destroy(name));
+    ExpectEq(CgExists("memory", name), true);
+
+    return pid;
+}
+
+static void TestCgroupReaper(Porto::Connection &api) {
+    uint64_t timeout = config().daemon().cgroup_reaper_timeout_s() * 1000;
+    uint64_t deferred, reaped, leaked, deadline;
+    pid_t pid;
+
+    AsRoot(api);
+
+    Say() << "Busy cgroup is removed in background" << std::endl;
+    deferred = PortoStat(api, "cgroups_deferred");
+    reaped = PortoStat(api, "cgroups_reaped");
+    pid = BusyCgroup(api, "a");
+    ExpectEq(PortoStat(api, "cgroups_deferred"), deferred + 1);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    deadline = GetCurrentTimeMs() + 5000;
+    while (CgExists("memory", "a") && !WaitDeadline(deadline, 100));
+    ExpectEq(CgExists("memory", "a"), false);
+    ExpectEq(PortoStat(api, "cgroups_reaped"), reaped + 1);
+
+    Say() << "Cgroup busy longer than reaper timeout is leaked" << std::endl;
+    leaked = PortoStat(api, "cgroups_leaked");
+    pid = BusyCgroup(api, "a");
+
+    deadline = GetCurrentTimeMs() + timeout + 5000;
+    while (PortoStat(api, "cgroups_leaked") == leaked && !WaitDeadline(deadline, 1000));
+    ExpectEq(PortoStat(api, "cgroups_leaked"), leaked + 1);
+    expectedErrors++; // Cannot remove cgroup
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    ExpectSuccess(TPath(CgRoot("memory", "a")).Rmdir());
+
+    AsAlice(api);
+}
+
 static void TestSigPipe(Porto::Connection &api) {
     std::string before;
     ExpectApiSuccess(api.GetData("/", "porto_stat[spawned]", before));
@@ -4642,6 +4919,53 @@ static void KillSlave(Porto::Connection &api, int sig, int times = 10) {
     CheckErrorCounters(api);
 }
 
+/*
+ * Restarts portod in place with config changed by caller,
+ * without argument original config file is put back.
+ */
+static void ReloadConfig(Porto::Connection &api, const cfg::TCfg *cfg = nullptr) {
+    static std::string original;
+    static bool changed = false, existed = false;
+    TPath path("/etc/portod.conf");
+
+    if (cfg) {
+        std::string text;
+        if (!changed) {
+            existed = path.Exists();
+            if (existed)
+                ExpectSuccess(path.ReadAll(original));
+        }
+        Expect(google::protobuf::TextFormat::PrintToString(*cfg, &text));
+        ExpectSuccess(path.WriteAll(text));
+        changed = true;
+    } else if (changed) {
+        if (existed)
+            ExpectSuccess(path.WriteAll(original));
+        else
+            ExpectSuccess(path.Unlink());
+        changed = false;
+    } else
+        return;
+
+    int slavePid = ReadPid(config().slave_pid().path());
+    int masterPid = ReadPid(config().master_pid().path());
+    config.Load();
+
+    if (kill(masterPid, SIGHUP))
+        throw string("Can't send SIGHUP to master");
+    WaitProcessExit(std::to_string(slavePid));
+    WaitPortod(api);
+
+    /* master reexecutes itself and starts statistics from scratch */
+    loggedRespawns += expectedRespawns;
+    loggedErrors += expectedErrors;
+    loggedWarns += expectedWarns;
+
+    expectedRespawns = 1;
+    expectedErrors = expectedWarns = 0;
+    CheckErrorCounters(api);
+}
+
 static bool RespawnTicks(Porto::Connection &api, const std::string &name, int maxTries = 3) {
     std::string respawnCount, v;
     ExpectApiSuccess(api.GetData(name, "respawn_count", respawnCount));
@@ -4779,6 +5103,45 @@ static void TestWaitRecovery(Porto::Connection &api) {
     ExpectApiSuccess(api.Destroy(c));
 }
 
+static void TestDestroyDeferred(Porto::Connection &api) {
+    std::string v;
+
+    AsRoot(api);
+
+    Say() << "Destroy parent while child waits for teardown" << std::endl;
+    for (int i = 0; i < 10; i++) {
+        ExpectApiSuccess(api.Create("a"));
+        ExpectApiSuccess(api.Create("a/b"));
+        ExpectApiSuccess(api.SetProperty("a/b", "command", "sleep 1000"));
+        ExpectApiSuccess(api.Start("a/b"));
+        ExpectApiSuccess(api.Destroy("a/b"));
+        ExpectApiSuccess(api.Destroy("a"));
+    }
+
+    Say() << "Destroy parent while gc removes dead child" << std::endl;
+    for (int i = 0; i < 5; i++) {
+        ExpectApiSuccess(api.Create("a"));
+        ExpectApiSuccess(api.Create("a/b"));
+        ExpectApiSuccess(api.SetProperty("a/b", "command", "true"));
+        ExpectApiSuccess(api.SetProperty("a/b", "aging_time", "1"));
+        ExpectApiSuccess(api.Start("a/b"));
+        WaitContainer(api, "a/b");
+        usleep(800000 + i * 100000);
+        ExpectApiSuccess(api.Destroy("a"));
+    }
+
+    Say() << "Shutdown with pending teardown" << std::endl;
+    ExpectApiSuccess(api.Create("a"));
+    ExpectApiSuccess(api.SetProperty("a", "command", "sleep 1000"));
+    ExpectApiSuccess(api.Create("a/b"));
+    ExpectApiSuccess(api.SetProperty("a/b", "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start("a/b"));
+    ExpectApiSuccess(api.Destroy("a/b"));
+    KillSlave(api, SIGTERM);
+    ExpectApiFailure(api.GetData("a/b", "state", v), EError::ContainerDoesNotExist);
+    ExpectApiSuccess(api.Destroy("a"));
+}
+
 static void TestRecovery(Porto::Connection &api) {
     string pid, v;
     string name = "a:b";
@@ -5132,6 +5495,165 @@ static void TestCgroups(Porto::Connection &api) {
     ExpectEq(cpuCg.Exists(), false);
 }
 
+/* Get request with max_age_ms, not exposed in client library */
+static uint64_t GetSampled(Porto::Connection &api, const std::string &name,
+                           const std::string &variable, uint64_t maxAgeMs) {
+    rpc::TContainerResponse rsp;
+    std::string text;
+    uint64_t val;
+
+    ExpectApiSuccess(api.Raw("get { name: \"" + name + "\" variable: \"" + variable +
+                             "\" max_age_ms: " + std::to_string(maxAgeMs) + " }", text));
+    Expect(google::protobuf::TextFormat::ParseFromString(text, &rsp));
+    ExpectEq(rsp.get().list_size(), 1);
+    ExpectEq(rsp.get().list(0).keyval_size(), 1);
+    auto &keyval = rsp.get().list(0).keyval(0);
+    ExpectEq((int)keyval.error(), (int)EError::Success);
+    ExpectSuccess(StringToUint64(keyval.value(), val));
+    return val;
+}
+
+static void TestSampler(Porto::Connection &api) {
+    uint64_t interval = 1000, hits, cached, live;
+    std::string name = "a";
+
+    AsRoot(api);
+    cfg::TCfg cfg = config();
+    cfg.mutable_daemon()->set_stat_sample_interval_ms(interval);
+    ReloadConfig(api, &cfg);
+    AsAlice(api);
+
+    ExpectApiSuccess(api.Create(name));
+    ExpectApiSuccess(api.SetProperty(name, "command", "bash -c 'while true; do :; done'"));
+    ExpectApiSuccess(api.Start(name));
+    usleep(interval * 2 * 1000);
+
+    Say() << "Check sampled value is returned within max_age_ms" << std::endl;
+    hits = PortoStat(api, "stat_sample_hits");
+    cached = GetSampled(api, name, "cpu_usage", interval * 10);
+    ExpectEq(PortoStat(api, "stat_sample_hits"), hits + 1);
+
+    live = GetSampled(api, name, "cpu_usage", 0);
+    ExpectEq(PortoStat(api, "stat_sample_hits"), hits + 1);
+    ExpectLess(cached, live);
+
+    Say() << "Check sample is refreshed after interval" << std::endl;
+    usleep(interval * 2 * 1000);
+    ExpectLess(cached, GetSampled(api, name, "cpu_usage", interval * 10));
+    ExpectEq(PortoStat(api, "stat_sample_hits"), hits + 2);
+
+    Say() << "Check counter rate and history" << std::endl;
+    std::vector<std::string> samples;
+    std::string v;
+    uint64_t rate;
+
+    ExpectApiSuccess(api.GetData(name, "cpu_usage[rate:10s]", v));
+    ExpectSuccess(StringToUint64(v, rate));
+    Expect(rate > 0);
+    ExpectApiSuccess(api.GetData(name, "cpu_usage[history:2s]", v));
+    ExpectSuccess(SplitString(v, ';', samples));
+    Expect(samples.size() >= 2);
+    for (auto &sample: samples) {
+        uint64_t age;
+        ExpectSuccess(StringToUint64(StringTrim(sample.substr(0, sample.find(':'))), age));
+        ExpectLessEq(age, 2000 + interval * 2);
+    }
+
+    Say() << "Check period without unit is rejected" << std::endl;
+    ExpectApiFailure(api.GetData(name, "cpu_usage[rate:60]", v), EError::InvalidValue);
+    ExpectApiFailure(api.GetData(name, "cpu_usage[history:60]", v), EError::InvalidValue);
+
+    ExpectApiSuccess(api.Destroy(name));
+
+    AsRoot(api);
+    ReloadConfig(api);
+}
+
+static void TestWarmPool(Porto::Connection &api) {
+    uint64_t hits, misses, deadline;
+    std::string pid, v;
+
+    AsRoot(api);
+    cfg::TCfg cfg = config();
+    cfg.mutable_daemon()->set_warm_cgroups(2);
+    cfg.mutable_daemon()->set_warm_netns(NetworkEnabled() ? 2 : 0);
+    ReloadConfig(api, &cfg);
+
+    /* pools are filled in background */
+    usleep(1000000);
+
+    Say() << "Check warm cgroup of first-level container" << std::endl;
+    hits = PortoStat(api, "warm_cgroup_hits");
+    ExpectApiSuccess(api.Create("a"));
+    ExpectApiSuccess(api.SetProperty("a", "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start("a"));
+    Expect(PortoStat(api, "warm_cgroup_hits") > hits);
+    ExpectApiSuccess(api.GetData("a", "root_pid", pid));
+    ExpectCorrectCgroups(pid, "a");
+
+    Say() << "Check warm cgroup of nested container" << std::endl;
+    misses = PortoStat(api, "warm_cgroup_misses");
+    ExpectApiSuccess(api.Create("a/b"));
+    ExpectApiSuccess(api.SetProperty("a/b", "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start("a/b"));
+    Expect(PortoStat(api, "warm_cgroup_misses") > misses);
+    ExpectApiSuccess(api.GetData("a/b", "root_pid", pid));
+    ExpectCorrectCgroups(pid, "a/b");
+
+    usleep(1000000);
+    hits = PortoStat(api, "warm_cgroup_hits");
+    ExpectApiSuccess(api.Create("a/c"));
+    ExpectApiSuccess(api.SetProperty("a/c", "command", "sleep 1000"));
+    ExpectApiSuccess(api.Start("a/c"));
+    Expect(PortoStat(api, "warm_cgroup_hits") > hits);
+    ExpectApiSuccess(api.GetData("a/c", "root_pid", pid));
+    ExpectCorrectCgroups(pid, "a/c");
+
+    Say() << "Check pooled cgroups don't keep parent" << std::endl;
+    ExpectApiSuccess(api.Destroy("a"));
+    deadline = GetCurrentTimeMs() + 10000;
+    while (CgExists("memory", "a") && !WaitDeadline(deadline, 100));
+    ExpectEq(CgExists("memory", "a"), false);
+
+    if (NetworkEnabled()) {
+        Say() << "Check warm netns with veth" << std::endl;
+        if (system("ip link | grep portobr0") == 0)
+            ExpectEq(system("ip link delete portobr0"), 0);
+        ExpectEq(system("ip link add portobr0 type bridge"), 0);
+        ExpectEq(system("ip link set portobr0 up"), 0);
+
+        hits = PortoStat(api, "warm_netns_hits");
+        ExpectApiSuccess(api.Create("a"));
+        ExpectApiSuccess(api.SetProperty("a", "net", "veth eth0 portobr0 1400"));
+        ExpectApiSuccess(api.SetProperty("a", "command", "ip -o link show"));
+        ExpectApiSuccess(api.Start("a"));
+        WaitContainer(api, "a");
+        Expect(PortoStat(api, "warm_netns_hits") > hits);
+        ExpectApiSuccess(api.GetData("a", "stdout", v));
+        Expect(v.find("eth0") != std::string::npos);
+        Expect(v.find("mtu 1400") != std::string::npos);
+        ExpectEq(v.find(WARM_VETH_NAME), std::string::npos);
+        ExpectApiSuccess(api.Destroy("a"));
+
+        Say() << "Check unused warm veth is removed" << std::endl;
+        usleep(1000000);
+        hits = PortoStat(api, "warm_netns_hits");
+        ExpectApiSuccess(api.Create("a"));
+        ExpectApiSuccess(api.SetProperty("a", "net", "none"));
+        ExpectApiSuccess(api.SetProperty("a", "command", "ip -o link show"));
+        ExpectApiSuccess(api.Start("a"));
+        WaitContainer(api, "a");
+        Expect(PortoStat(api, "warm_netns_hits") > hits);
+        ExpectApiSuccess(api.GetData("a", "stdout", v));
+        ExpectEq(v.find(WARM_VETH_NAME), std::string::npos);
+        ExpectApiSuccess(api.Destroy("a"));
+
+        ExpectEq(system("ip link delete portobr0"), 0);
+    }
+
+    ReloadConfig(api);
+}
+
 static void TestVersion(Porto::Connection &api) {
     string version, revision;
     ExpectApiSuccess(api.GetVersion(version, revision));
@@ -5220,6 +5742,74 @@ static void TestStdoutLimit(Porto::Connection &api) {
     ExpectLessEq(st.st_size, limit);
 
     ExpectApiSuccess(api.Destroy(name));
+
+    Say() << "Check stdout captured in memory" << std::endl;
+    ExpectApiSuccess(api.Create(name));
+    ExpectApiSuccess(api.SetProperty(name, "stream_memory", "true"));
+    ExpectApiSuccess(api.SetProperty(name, "stdout_limit", "1M"));
+    ExpectApiSuccess(api.SetProperty(name, "command", "dd if=/dev/zero bs=1M count=100"));
+
+    ExpectApiSuccess(api.Start(name));
+    WaitContainer(api, name);
+
+    ExpectSuccess(stdoutPath.StatFollow(st));
+    Expect(S_ISFIFO(st.st_mode));
+    ExpectApiSuccess(api.GetData(name, "stdout", v));
+    ExpectEq(v.size(), 1 << 20);
+    ExpectApiSuccess(api.GetData(name, "stdout_offset", v));
+    ExpectEq(v, std::to_string(99 << 20));
+    ExpectApiSuccess(api.GetData(name, "stdout[" + std::to_string(100 << 20) + "]", v));
+    ExpectEq(v, "");
+
+    ExpectApiSuccess(api.Destroy(name));
+}
+
+static void TestReadStream(Porto::Connection &api) {
+    std::string name = "a";
+    std::string data, text;
+    uint64_t offset = 0;
+    bool eof = false;
+
+    ExpectApiSuccess(api.Create(name));
+
+    Say() << "Check read from stopped container" << std::endl;
+    ExpectApiFailure(api.ReadStream(name, "stdout", offset, 0, 0, data, eof), EError::InvalidState);
+    ExpectApiFailure(api.ReadStream(name, "stdin", offset, 0, 0, data, eof), EError::InvalidValue);
+
+    for (auto memory: { "false", "true" }) {
+        Say() << "Check follow stdout, stream_memory=" << memory << std::endl;
+        ExpectApiSuccess(api.SetProperty(name, "stream_memory", memory));
+        ExpectApiSuccess(api.SetProperty(name, "command", "bash -c 'echo a; sleep 1; echo b; sleep 1; echo c'"));
+        ExpectApiSuccess(api.Start(name));
+
+        offset = 0;
+        text = "";
+        int replies = 0;
+        do {
+            ExpectApiSuccess(api.ReadStream(name, "stdout", offset, 0, 10, data, eof));
+            text += data;
+            replies++;
+        } while (!eof);
+
+        ExpectEq(text, "a\nb\nc\n");
+        ExpectEq(offset, 6);
+        Expect(replies >= 3);
+
+        ExpectApiSuccess(api.ReadStream(name, "stdout", offset, 0, 10, data, eof));
+        ExpectEq(data, "");
+        Expect(eof);
+
+        Say() << "Check limit and offset" << std::endl;
+        offset = 2;
+        ExpectApiSuccess(api.ReadStream(name, "stdout", offset, 2, 0, data, eof));
+        ExpectEq(data, "b\n");
+        ExpectEq(offset, 4);
+        Expect(!eof);
+
+        ExpectApiSuccess(api.Stop(name));
+    }
+
+    ExpectApiSuccess(api.Destroy(name));
 }
 
 static void TestStats(Porto::Connection &api) {
@@ -5241,6 +5831,35 @@ static void TestStats(Porto::Connection &api) {
     AsAlice(api);
 }
 
+static void TestRequestLog(Porto::Connection &api) {
+    TPath path(config().request_log().file().path());
+    TRequestRecord record;
+    std::string text;
+
+    if (path.IsEmpty())
+        return;
+
+    AsRoot(api);
+
+    Say() << "Check failed request in request log" << std::endl;
+    ExpectApiFailure(api.Start("request-log-test"), EError::ContainerDoesNotExist);
+
+    ExpectSuccess(path.ReadAll(text, 1 << 30));
+    Expect(text.size() >= sizeof(REQUEST_LOG_MAGIC) + sizeof(record));
+    ExpectEq(text.substr(0, sizeof(REQUEST_LOG_MAGIC)),
+             std::string(REQUEST_LOG_MAGIC, sizeof(REQUEST_LOG_MAGIC)));
+    ExpectEq((text.size() - sizeof(REQUEST_LOG_MAGIC)) % sizeof(record), 0);
+
+    memcpy(&record, text.data() + text.size() - sizeof(record), sizeof(record));
+    ExpectEq(record.Method, rpc::TContainerRequest::kStartFieldNumber);
+    ExpectEq(record.Error, EError::ContainerDoesNotExist);
+    Expect(record.Flags & REQUEST_LOG_ERROR);
+    ExpectEq(record.ContainerId, -1);
+    ExpectEq(record.ClientPid, getpid());
+
+    AsAlice(api);
+}
+
 static void TestConvertPath(Porto::Connection &api) {
     ExpectApiSuccess(api.Create("abc"));
     ExpectApiSuccess(api.SetProperty("abc", "root", "/root_abc"));
@@ -5325,6 +5944,7 @@ int SelfTest(std::vector<std::string> args) {
         { "state_machine", TestStateMachine },
         { "wait", TestWait },
         { "exit_status", TestExitStatus },
+        { "exec", TestExec },
         { "streams", TestStreams },
         { "ns_cg_tc", TestNsCgTc },
         { "isolate_property", TestIsolateProperty },
@@ -5336,6 +5956,7 @@ int SelfTest(std::vector<std::string> args) {
         { "cwd_property", TestCwdProperty },
         { "stdpath_property", TestStdPathProperty },
         { "stdout_limit", TestStdoutLimit },
+        { "read_stream", TestReadStream },
         { "root_property", TestRootProperty },
         { "root_readonly", TestRootRdOnlyProperty },
         { "hostname_property", TestHostnameProperty },
@@ -5343,6 +5964,7 @@ int SelfTest(std::vector<std::string> args) {
         { "capabilities_property", TestCapabilitiesProperty },
         { "enable_porto_property", TestEnablePortoProperty },
         { "limits", TestLimits },
+        { "memory_threshold", TestMemThreshold },
         { "ulimit_property", TestUlimitProperty },
         { "virt_mode_property", TestVirtModeProperty },
         { "alias", TestAlias },
@@ -5352,8 +5974,10 @@ int SelfTest(std::vector<std::string> args) {
         { "hierarchy", TestLimitsHierarchy },
         { "vholder", TestVolumeHolder },
         { "volume_impl", TestVolumeImpl },
+        { "cgroup_reaper", TestCgroupReaper },
         { "sigpipe", TestSigPipe },
         { "stats", TestStats },
+        { "request_log", TestRequestLog },
         { "daemon", TestDaemon },
         { "convert", TestConvertPath },
         { "leaks", TestLeaks },
@@ -5361,10 +5985,13 @@ int SelfTest(std::vector<std::string> args) {
 
         // the following tests will restart porto several times
         { "bad_client", TestBadClient },
+        { "destroy_deferred", TestDestroyDeferred },
         { "recovery", TestRecovery },
         { "wait_recovery", TestWaitRecovery },
         { "volume_recovery", TestVolumeRecovery },
         { "cgroups", TestCgroups },
+        { "sampler", TestSampler },
+        { "warm_pool", TestWarmPool },
         { "version", TestVersion },
         // { "remove_dead", TestRemoveDead }, FIXME
         { "stats", TestStats },
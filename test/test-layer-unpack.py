@@ -0,0 +1,119 @@
+import porto
+import os
+import io
+import tarfile
+import subprocess
+
+from test_common import *
+
+c = porto.Connection()
+
+prefix = "test-layer-unpack.py-"
+layer_name = prefix + "layer"
+layer_path = "/place/porto_layers/" + layer_name
+tarball_path = "/tmp/" + prefix + "layer.tar.gz"
+long_name = "dir/" + "x" * 200
+
+def AddFile(t, name, data="", mode=0644, xattrs={}):
+    info = tarfile.TarInfo(name)
+    info.size = len(data)
+    info.mode = mode
+    info.pax_headers = { "SCHILY.xattr." + k: v for k, v in xattrs.items() }
+    t.addfile(info, io.BytesIO(data))
+
+def GetXattr(path, name):
+    p = subprocess.Popen(["getfattr", "--only-values", "-h", "-n", name, path],
+                         stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    value = p.communicate()[0]
+    return value if p.returncode == 0 else None
+
+def AddEntry(t, name, kind, link="", mode=0755):
+    info = tarfile.TarInfo(name)
+    info.type = kind
+    info.linkname = link
+    info.mode = mode
+    t.addfile(info)
+
+def MakeTarball(entries, fmt=tarfile.PAX_FORMAT):
+    t = tarfile.open(tarball_path, mode="w:gz", format=fmt)
+    entries(t)
+    t.close()
+
+# CLEANUP
+
+if not Catch(c.FindLayer, layer_name):
+    c.RemoveLayer(layer_name)
+
+# IMPORT
+
+def Base(t):
+    AddEntry(t, "dir", tarfile.DIRTYPE)
+    AddFile(t, "dir/file", "data")
+    AddFile(t, "dir/suid", "suid", 04755)
+    AddFile(t, long_name, "long")
+    AddEntry(t, "dir/hardlink", tarfile.LNKTYPE, "dir/file")
+    AddEntry(t, "dir/symlink", tarfile.SYMTYPE, "/etc/passwd")
+    AddEntry(t, "fifo", tarfile.FIFOTYPE, mode=0600)
+    AddEntry(t, "opaque", tarfile.DIRTYPE)
+    AddFile(t, "opaque/.wh..wh..opq")
+    AddFile(t, "nodir/file", "implicit parent")
+    AddFile(t, ".wh.gone")
+    AddFile(t, "xattrs", "xattrs", xattrs={ "user.porto": "test",
+                                             "security.capability": "\x01\x00\x00\x02",
+                                             "trusted.overlay.opaque": "y" })
+
+MakeTarball(Base)
+c.ImportLayer(layer_name, tarball_path)
+
+assert open(layer_path + "/dir/file").read() == "data"
+assert os.stat(layer_path + "/dir/suid").st_mode & 07777 == 04755
+assert open(layer_path + "/" + long_name).read() == "long"
+assert os.stat(layer_path + "/dir/hardlink").st_ino == os.stat(layer_path + "/dir/file").st_ino
+assert os.readlink(layer_path + "/dir/symlink") == "/etc/passwd"
+assert os.path.exists(layer_path + "/fifo")
+assert not os.path.exists(layer_path + "/opaque/.wh..wh..opq")
+assert open(layer_path + "/nodir/file").read() == "implicit parent"
+assert not os.path.exists(layer_path + "/.wh.gone")
+assert os.stat(layer_path + "/gone").st_rdev == 0
+assert GetXattr(layer_path + "/xattrs", "user.porto") == "test"
+assert GetXattr(layer_path + "/xattrs", "security.capability") is None
+assert GetXattr(layer_path + "/xattrs", "trusted.overlay.opaque") is None
+
+# MERGE, whiteouts remove entries
+
+def Upper(t):
+    AddFile(t, "dir/.wh.file")
+    AddFile(t, "dir/symlink", "not a link")
+    AddFile(t, ".wh.fifo")
+
+MakeTarball(Upper, tarfile.GNU_FORMAT)
+c.MergeLayer(layer_name, tarball_path)
+
+assert not os.path.lexists(layer_path + "/dir/file")
+assert not os.path.lexists(layer_path + "/dir/.wh.file")
+assert open(layer_path + "/dir/symlink").read() == "not a link"
+assert not os.path.lexists(layer_path + "/fifo")
+assert open(layer_path + "/dir/hardlink").read() == "data"
+
+c.RemoveLayer(layer_name)
+
+# ESCAPE
+
+def Escape(t):
+    AddFile(t, "../escape", "pwned")
+
+MakeTarball(Escape)
+assert Catch(c.ImportLayer, layer_name, tarball_path) == porto.exceptions.InvalidData
+assert not os.path.exists("/place/porto_layers/_tmp_/escape")
+
+def EscapeSymlink(t):
+    AddEntry(t, "link", tarfile.SYMTYPE, "/tmp")
+    AddFile(t, "link/escape", "pwned")
+
+MakeTarball(EscapeSymlink)
+assert Catch(c.ImportLayer, layer_name, tarball_path) == porto.exceptions.InvalidData
+assert not os.path.exists("/tmp/escape")
+
+assert Catch(c.FindLayer, layer_name) == porto.exceptions.LayerNotFound
+
+os.unlink(tarball_path)
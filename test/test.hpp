@@ -71,6 +71,7 @@ namespace test {
     int SelfTest(std::vector<std::string> args);
     int StressTest(int threads, int iter, bool killPorto);
     int FuzzyTest(int threads, int iter);
+    int BenchTest(std::vector<std::string> args);
 
     enum class KernelFeature {
         SMART,